@@ -153,7 +153,7 @@ template<class C> struct array_t {
     
     make_unique();
     
-    if ((before<0)||(before>=len0)) before=len0;
+    if ((before<0)||((size_t)before>=len0)) before=len0;
     else {
       memmove(ptr+before+count,ptr+before,(len0-before)*sizeof(C));
     }
@@ -244,8 +244,8 @@ template<class C> struct array_t {
     char buf[sizeof(C)];
     if (idx0<0) idx0=0;
     if (idx1<0) idx1=0;
-    if (idx0>=len) idx0=len-1;
-    if (idx1>=len) idx1=len-1;
+    if ((size_t)idx0>=len) idx0=len-1;
+    if ((size_t)idx1>=len) idx1=len-1;
     
     if (idx0==idx1) return;
     
@@ -3,6 +3,20 @@
 
 namespace alp {
 
+unittest_t::registration_t *unittest_t::_first=NULL;
+unittest_t::registration_t *unittest_t::_last=NULL;
+
+unittest_t::registration_t::registration_t(const char *name, run_t run) :
+  name(name), run(run), next(NULL) {
+  // the list heads are zero-initialized before any registration runs
+  if (_last) {
+    _last->next=this;
+  } else {
+    _first=this;
+  }
+  _last=this;
+}
+
 void unittest_t::_finalize() {
   if (_nFailed) {
     logf(
@@ -31,7 +31,28 @@
 namespace alp {
 
 struct unittest_t {
+  public:
+    /** Runs a unit test, returning true iff all of its asserts held */
+    typedef bool (*run_t)();
+
+    /** Entry of the registry of all unit tests linked into the program */
+    struct registration_t {
+      const char *name;
+      run_t run;
+      registration_t *next;
+
+      registration_t(const char *name, run_t run);
+    };
+
+    /** Returns the first registered unit test, NULL if there is none. 
+      * Unit tests are listed in the order they were registered.
+      */
+    static registration_t *First() { return _first; }
+
   protected:
+    static registration_t *_first;
+    static registration_t *_last;
+
     int _nFailed;
     int _nSucceeded;
     void _finalize();
@@ -46,17 +67,29 @@ struct unittest_t {
 
 #define unittest_concat_id(a,b) a##b
 #define unittest_stringify(a) #a
+#define unittest_name(id,ln) \
+  "unittest # " unittest_stringify(id) \
+  " (" __FILE__ ":" unittest_stringify(ln) ")"
+/* Unit tests are only registered at startup. They are run by a test runner
+   iterating over unittest_t::First(). */
 #define unittest_with_id(id,ln,...) \
 namespace { \
 struct unittest_concat_id(unittest_,id) : public alp::unittest_t { \
   unittest_concat_id(unittest_,id)() : \
-    alp::unittest_t( \
-      "unittest # " unittest_stringify(id) \
-      " (" __FILE__ ":" unittest_stringify(ln) ")") { \
+    alp::unittest_t(unittest_name(id,ln)) { \
+  } \
+  void _run() { \
     __VA_ARGS__ \
-    _finalize(); \
   } \
-} unittest_concat_id(_unittest_,id); \
+  static bool Run() { \
+    unittest_concat_id(unittest_,id) t; \
+    t._run(); \
+    t._finalize(); \
+    return t._nFailed==0; \
+  } \
+}; \
+alp::unittest_t::registration_t unittest_concat_id(_unittest_,id)( \
+  unittest_name(id,ln),unittest_concat_id(unittest_,id)::Run); \
 }
 #if ALPHA_UNITTESTS
 #define unittest(...) unittest_with_id(__COUNTER__,__LINE__,__VA_ARGS__)
@@ -0,0 +1,235 @@
+#!/usr/bin/env python3
+"""Benchmark suite of the LUT compiler.
+
+Compiles every target in targets/ for every architecture preset in presets/
+into a bitstream dump, collecting the statistics reported by --stats: wall
+and CPU time of each phase, event counters and the approximation error.
+Each case is run several times and the fastest run is kept.
+
+The results can be written as CSV and JSON. A JSON result file can be
+stored as baseline; later runs are compared against it and fail if a case
+got slower, needed more evaluations or approximates worse than the
+thresholds allow.
+"""
+
+import argparse
+import csv
+import glob
+import json
+import os
+import shutil
+import subprocess as sp
+import sys
+import tempfile
+import time
+
+VERSION = 1
+
+# phases whose time is spent outside of the compiler itself
+EXTERNAL_PHASES = {"target-compile"}
+
+
+def case_name(target, preset):
+    return "%s/%s" % (
+        os.path.splitext(os.path.basename(target))[0],
+        os.path.splitext(os.path.basename(preset))[0])
+
+
+def run_case(compiler, target, preset, workdir):
+    """Compiles target once, returning its statistics or None on errors."""
+    fn_stats = os.path.join(workdir, "stats.json")
+    cmd = [
+        compiler, "-D", "--arch", preset, target,
+        "-o", os.path.join(workdir, "out.dump"), "--stats=" + fn_stats]
+
+    t0 = time.monotonic()
+    p = sp.run(cmd, stdout=sp.PIPE, stderr=sp.PIPE)
+    wall = time.monotonic() - t0
+    if p.returncode != 0:
+        sys.stderr.write(p.stderr.decode("utf8", "replace"))
+        return None
+
+    with open(fn_stats) as f:
+        stats = json.load(f)
+    external = sum(
+        v["wall"] for k, v in stats["phases"].items() if k in EXTERNAL_PHASES)
+    return {
+        "wall": wall,
+        "compiler_wall": wall - external,
+        "phases": stats["phases"],
+        "counters": stats["counters"],
+        "rms_error": stats["approximation-error"]["rms"],
+    }
+
+
+def run_suite(args):
+    here = os.path.dirname(os.path.abspath(__file__))
+    compiler = os.path.abspath(args.compiler)
+    targets = sorted(glob.glob(os.path.join(here, "targets", "*.input")))
+    presets = sorted(glob.glob(os.path.join(here, "presets", "*.arch")))
+
+    results = {}
+    workdir = tempfile.mkdtemp(prefix="riscv-lut-bench-")
+    try:
+        for preset in presets:
+            for target in targets:
+                name = case_name(target, preset)
+                if args.filter and not any(s in name for s in args.filter):
+                    continue
+                best = None
+                for i in range(args.repeat):
+                    r = run_case(compiler, target, preset, workdir)
+                    if r is None:
+                        break
+                    if (best is None) or (r["compiler_wall"] <
+                                          best["compiler_wall"]):
+                        best = r
+                if best is None:
+                    print("%-32s FAILED" % name)
+                    results[name] = None
+                    continue
+                print("%-32s %8.3f s %12d evaluations  rms error %g" % (
+                    name, best["compiler_wall"],
+                    best["counters"]["target-evaluations"],
+                    best["rms_error"]))
+                sys.stdout.flush()
+                results[name] = best
+    finally:
+        shutil.rmtree(workdir, ignore_errors=True)
+    return results
+
+
+def write_csv(fn, results):
+    phases = []
+    counters = []
+    for r in results.values():
+        if r is None:
+            continue
+        phases = [p for p in r["phases"]]
+        counters = [c for c in r["counters"]]
+        break
+
+    with open(fn, "w", newline="") as f:
+        w = csv.writer(f)
+        w.writerow(
+            ["case", "wall", "compiler_wall", "rms_error"] + counters +
+            ["%s.%s" % (p, k) for p in phases for k in ("calls", "wall", "cpu")])
+        for name, r in sorted(results.items()):
+            if r is None:
+                w.writerow([name])
+                continue
+            w.writerow(
+                [name, r["wall"], r["compiler_wall"], r["rms_error"]] +
+                [r["counters"][c] for c in counters] +
+                [r["phases"][p][k] for p in phases
+                 for k in ("calls", "wall", "cpu")])
+
+
+def write_json(fn, results):
+    with open(fn, "w") as f:
+        json.dump(
+            {"version": VERSION, "cases": results}, f, indent=2, sort_keys=True)
+        f.write("\n")
+
+
+def compare(results, baseline, args):
+    """Prints the regressions against baseline, returning their number."""
+    n = 0
+
+    def regression(name, what, old, new):
+        nonlocal n
+        print("\x1b[31;1mREGRESSION\x1b[30;0m %s: %s %g -> %g" % (
+            name, what, old, new))
+        n += 1
+
+    for name, r in sorted(results.items()):
+        old = baseline.get(name)
+        if old is None:
+            continue
+        if r is None:
+            regression(name, "failed, took", old["compiler_wall"], 0)
+            continue
+        if r["compiler_wall"] > (old["compiler_wall"] * (1 + args.time_threshold) +
+                                 args.time_slack):
+            regression(name, "time", old["compiler_wall"], r["compiler_wall"])
+        for c in ("target-evaluations", "weight-evaluations"):
+            if r["counters"][c] > old["counters"][c] * (1 + args.count_threshold):
+                regression(name, c, old["counters"][c], r["counters"][c])
+        if r["rms_error"] > (old["rms_error"] * (1 + args.error_threshold) +
+                             args.error_slack):
+            regression(name, "rms error", old["rms_error"], r["rms_error"])
+    return n
+
+
+def main():
+    p = argparse.ArgumentParser(description=__doc__.split("\n")[0])
+    p.add_argument(
+        "--compiler", default="../riscv-lut-compiler",
+        help="compiler executable to benchmark (default: %(default)s)")
+    p.add_argument(
+        "--repeat", type=int, default=3,
+        help="number of runs per case, the fastest is kept (default: "
+             "%(default)s)")
+    p.add_argument(
+        "--filter", action="append",
+        help="only run cases named target/preset containing this, may be "
+             "given multiple times")
+    p.add_argument("--csv", help="write the results to this CSV file")
+    p.add_argument("--json", help="write the results to this JSON file")
+    p.add_argument(
+        "--baseline",
+        help="compare the results against this JSON result file")
+    p.add_argument(
+        "--update-baseline", action="store_true",
+        help="store the results as baseline instead of comparing them")
+    p.add_argument(
+        "--time-threshold", type=float, default=0.25,
+        help="relative increase of a case's time considered a regression "
+             "(default: %(default)s)")
+    p.add_argument(
+        "--time-slack", type=float, default=0.02,
+        help="absolute increase of a case's time in seconds tolerated in "
+             "addition (default: %(default)s)")
+    p.add_argument(
+        "--count-threshold", type=float, default=0.05,
+        help="relative increase of evaluations considered a regression "
+             "(default: %(default)s)")
+    p.add_argument(
+        "--error-threshold", type=float, default=0.01,
+        help="relative increase of the rms error considered a regression "
+             "(default: %(default)s)")
+    p.add_argument(
+        "--error-slack", type=float, default=1e-9,
+        help="absolute increase of the rms error tolerated in addition "
+             "(default: %(default)s)")
+    args = p.parse_args()
+
+    results = run_suite(args)
+    if args.csv:
+        write_csv(args.csv, results)
+    if args.json:
+        write_json(args.json, results)
+
+    failed = sum(1 for r in results.values() if r is None)
+    if args.baseline and args.update_baseline:
+        write_json(args.baseline, results)
+        print("baseline %s updated" % args.baseline)
+    elif args.baseline:
+        if not os.path.exists(args.baseline):
+            print("no baseline %s, not comparing (see --update-baseline)" %
+                  args.baseline)
+        else:
+            with open(args.baseline) as f:
+                baseline = json.load(f)
+            if baseline.get("version") != VERSION:
+                print("baseline %s has an incompatible version" % args.baseline)
+                return 1
+            n = compare(results, baseline["cases"], args)
+            print("%d regressions against %s" % (n, args.baseline))
+            if n > 0:
+                return 1
+    return 1 if failed > 0 else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,364 @@
+#include "bitstream.h"
+#include <string.h>
+#include <algorithm>
+
+void Bitstream::fill(size_t first, size_t count, uint64_t pattern) {
+  assert(first+count<=_words.len);
+  for(size_t i=0;i<count;i++) _words[first+i]=pattern;
+}
+
+void Bitstream::write(size_t at, size_t offset, size_t bits, uint64_t data) {
+  assert(bits<=64);
+  if (bits<64) data&=(1uL<<bits)-1;
+  
+  while(bits>0) {
+    size_t w=at+offset/_word_size;
+    size_t b=offset%_word_size;
+    size_t n=std::min(bits,(size_t)_word_size-b);
+    uint64_t m=((n<64) ? (1uL<<n)-1 : ~0uL)<<b;
+    
+    assert(w<_words.len);
+    _words[w]=(_words[w]&~m)|((data<<b)&m);
+    
+    data=(n<64) ? data>>n : 0;
+    offset+=n;
+    bits-=n;
+  }
+}
+
+void Bitstream::copy(size_t at, const uint64_t *src, size_t bits) {
+  if (_word_size==64) {
+    // word-aligned: copy all full words at once
+    assert(at+nWords(bits)<=_words.len);
+    memcpy(_words.ptr+at,src,(bits/64)*sizeof(uint64_t));
+    if (bits%64) write(at+bits/64,0,bits%64,src[bits/64]);
+    return;
+  }
+  for(size_t i=0;i<bits;i+=64)
+    write(at,i,std::min(bits-i,(size_t)64),src[i/64]);
+}
+
+uint64_t Bitstream::read(size_t at, size_t offset, size_t bits) const {
+  uint64_t res=0;
+  size_t shift=0;
+
+  assert(bits<=64);
+  while(bits>0) {
+    size_t w=at+offset/_word_size;
+    size_t b=offset%_word_size;
+    size_t n=std::min(bits,(size_t)_word_size-b);
+    uint64_t m=(n<64) ? (1uL<<n)-1 : ~0uL;
+    
+    assert(w<_words.len);
+    res|=((_words[w]>>b)&m)<<shift;
+    
+    shift+=n;
+    offset+=n;
+    bits-=n;
+  }
+  return res;
+}
+
+BitstreamLayout::BitstreamLayout(const arch_config_t &arch) :
+  _word_size(arch.wordSize), _n_words(0) {
+  // sections in the order they are stored in
+  _add_section(
+    RAM,"ram",(size_t)1<<arch.segmentBits,arch.incline_bits+arch.base_bits,
+    false,true,0x5555555555555555uL);
+  _add_section(
+    OR_PLANE,"or",arch.segmentBits,arch.plaInterconnects,true,false,0);
+  _add_section(
+    AND_PLANE,"and",arch.plaInterconnects,2*arch.selectorBits,true,false,0);
+  _add_section(
+    CONNECTION,"connection",arch.selectorBits+arch.interpolationBits,
+    3*arch.wordSize,true,false,0);
+
+  _add_field(RAM_INCLINE,"incline",RAM,0,arch.incline_bits);
+  _add_field(RAM_BASE,"base",RAM,arch.incline_bits,arch.base_bits);
+  _add_field(OR_LINE,"or",OR_PLANE,0,arch.plaInterconnects);
+  _add_field(AND_INVERTED,"inverted",AND_PLANE,0,arch.selectorBits);
+  _add_field(
+    AND_NORMAL,"normal",AND_PLANE,arch.selectorBits,arch.selectorBits);
+  _add_field(CONNECTION_LINE,"connection",CONNECTION,0,3*arch.wordSize);
+}
+
+void BitstreamLayout::_add_section(
+  section_id_t id, const char *name, size_t lines, size_t bits, 
+  bool reversed, bool addressable, uint64_t pattern) {
+  section_t &s=_sections[id];
+  s.name=name;
+  s.lines=lines;
+  s.bits=bits;
+  s.stride=(bits+_word_size-1)/_word_size;
+  s.first=_n_words;
+  s.reversed=reversed;
+  s.addressable=addressable;
+  s.pattern=pattern;
+  _n_words+=s.lines*s.stride;
+}
+
+void BitstreamLayout::_add_field(
+  field_id_t id, const char *name, section_id_t section, size_t offset,
+  size_t bits) {
+  field_t &f=_fields[id];
+  assert(offset+bits<=_sections[section].bits);
+  f.name=name;
+  f.section=section;
+  f.offset=offset;
+  f.bits=bits;
+}
+
+bool BitstreamLayout::delta(
+  const alp::array_t<uint64_t> &ref, const alp::array_t<uint64_t> &cur,
+  alp::array_t<run_t> &runs) const {
+  bool chain=false;
+  
+  assert((ref.len==_n_words) && (cur.len==_n_words));
+  runs.clear();
+  for(int s=0;s<NUM_SECTIONS;) {
+    const section_t &sec=_sections[s];
+    size_t first=sec.first, last=sec.first+sec.lines*sec.stride;
+
+    if (!sec.addressable) {
+      // extend to all following sections shifted in with this one
+      for(s++;(s<NUM_SECTIONS) && !_sections[s].addressable;s++)
+        last=_sections[s].first+_sections[s].lines*_sections[s].stride;
+      if (memcmp(
+        ref.ptr+first,cur.ptr+first,(last-first)*sizeof(uint64_t))!=0) {
+        run_t r={ first, last-first };
+        runs.insert(r);
+        chain=true;
+      }
+      continue;
+    }
+
+    for(size_t i=first;i<last;i++) {
+      if (ref[i]==cur[i]) continue;
+      if (runs.len && (runs[runs.len-1].first+runs[runs.len-1].count+1>=i)) {
+        runs[runs.len-1].count=i+1-runs[runs.len-1].first;
+      } else {
+        run_t r={ i, 1 };
+        runs.insert(r);
+      }
+    }
+    s++;
+  }
+  return chain;
+}
+
+BitstreamImage::BitstreamImage(const BitstreamLayout &layout) :
+  _layout(layout) {
+  size_t n=0;
+  for(int s=0;s<BitstreamLayout::NUM_SECTIONS;s++) {
+    const BitstreamLayout::section_t &sec=
+      _layout.section((BitstreamLayout::section_id_t)s);
+    _first[s]=n;
+    _stride[s]=(sec.bits+63)/64;
+    n+=sec.lines*_stride[s];
+  }
+  _data.setlen(n);
+  clear();
+}
+
+void BitstreamImage::clear() {
+  for(int s=0;s<BitstreamLayout::NUM_SECTIONS;s++) {
+    const BitstreamLayout::section_t &sec=
+      _layout.section((BitstreamLayout::section_id_t)s);
+    for(size_t i=0;i<sec.lines;i++) {
+      uint64_t *l=_data.ptr+_first[s]+i*_stride[s];
+      memset(l,0,_stride[s]*sizeof(uint64_t));
+      if (!sec.pattern) continue;
+      // the pattern repeats in every word of the encoded line
+      for(size_t j=0;j<sec.bits;j+=_layout.wordSize()) {
+        write(
+          (BitstreamLayout::section_id_t)s,i,j,
+          std::min(sec.bits-j,(size_t)_layout.wordSize()),sec.pattern);
+      }
+    }
+  }
+}
+
+void BitstreamImage::write(
+  BitstreamLayout::section_id_t s, size_t i, size_t offset, size_t bits,
+  uint64_t data) {
+  assert(offset+bits<=_layout.section(s).bits);
+  Bitstream(_data,64).write(line(s,i)-_data.ptr,offset,bits,data);
+}
+
+uint64_t BitstreamImage::read(
+  BitstreamLayout::section_id_t s, size_t i, size_t offset, size_t bits)
+  const {
+  assert(offset+bits<=_layout.section(s).bits);
+  return Bitstream(const_cast<alp::array_t<uint64_t>&>(_data),64).read(
+    line(s,i)-_data.ptr,offset,bits);
+}
+
+bool BitstreamImage::operator==(const BitstreamImage &o) const {
+  if (_data.len!=o._data.len) return false;
+  return memcmp(_data.ptr,o._data.ptr,_data.len*sizeof(uint64_t))==0;
+}
+
+void BitstreamImage::encode(alp::array_t<uint64_t> &words) const {
+  Bitstream bs(words,_layout.wordSize());
+  
+  words.setlen(_layout.nWords());
+  bs.fill(0,words.len,0);
+  for(int s=0;s<BitstreamLayout::NUM_SECTIONS;s++) {
+    BitstreamLayout::section_id_t id=(BitstreamLayout::section_id_t)s;
+    const BitstreamLayout::section_t &sec=_layout.section(id);
+    for(size_t i=0;i<sec.lines;i++)
+      bs.copy(_layout.line(id,i),line(id,i),sec.bits);
+  }
+}
+
+bool BitstreamImage::decode(const alp::array_t<uint64_t> &words) {
+  alp::array_t<uint64_t> &w=const_cast<alp::array_t<uint64_t>&>(words);
+  Bitstream bs(w,_layout.wordSize());
+  uint64_t word_mask=(_layout.wordSize()<64) 
+    ? (1uL<<_layout.wordSize())-1 : ~0uL;
+  
+  if (words.len!=_layout.nWords()) return false;
+  for(int s=0;s<BitstreamLayout::NUM_SECTIONS;s++) {
+    BitstreamLayout::section_id_t id=(BitstreamLayout::section_id_t)s;
+    const BitstreamLayout::section_t &sec=_layout.section(id);
+    for(size_t i=0;i<sec.lines;i++) {
+      size_t at=_layout.line(id,i);
+      uint64_t *l=line(id,i);
+      for(size_t j=0;j<sec.bits;j+=64)
+        l[j/64]=bs.read(at,j,std::min(sec.bits-j,(size_t)64));
+      // padding must be clear
+      size_t used=sec.bits%_layout.wordSize();
+      for(size_t j=0;j<sec.stride;j++) {
+        uint64_t m=word_mask;
+        if ((j==sec.stride-1) && used) m=(1uL<<used)-1;
+        if (words[at+j]&~m) return false;
+      }
+    }
+  }
+  return true;
+}
+
+unittest(
+  /*
+    testing:
+      Bitstream::write
+      Bitstream::read
+      Bitstream::copy
+  */
+  alp::array_t<uint64_t> words;
+  words.setlen(4);
+  
+  Bitstream bs(words,32);
+  bs.fill(0,4,0);
+  bs.write(0,28,8,0xab);
+  Assertf(words[0]==0xb0000000uL, "unexpected low word %lx", words[0]);
+  Assertf(words[1]==0xauL, "unexpected high word %lx", words[1]);
+  Assertf(bs.read(0,28,8)==0xab, "read back %lx", bs.read(0,28,8));
+  
+  uint64_t v[]={ 0x0123456789abcdefuL, 0x5uL };
+  bs.copy(1,v,67);
+  Assertf(words[1]==0x89abcdefuL, "unexpected word 1 %lx", words[1]);
+  Assertf(words[2]==0x01234567uL, "unexpected word 2 %lx", words[2]);
+  Assertf(words[3]==0x5uL, "unexpected word 3 %lx", words[3]);
+
+  Bitstream bs64(words,64);
+  bs64.fill(0,4,~0uL);
+  bs64.copy(1,v,67);
+  Assertf(words[1]==v[0], "unexpected word 1 %lx", words[1]);
+  Assertf(words[2]==0xfffffffffffffffduL, "unexpected word 2 %lx", words[2]);
+  bs64.write(0,60,8,0);
+  Assertf(
+    (words[0]==0x0fffffffffffffffuL) && (words[1]==(v[0]&~0xfuL)),
+    "unexpected words after write across boundary %lx %lx", 
+    words[0],words[1]);
+  bs64.set(3,3,false);
+  Assertf(words[3]==~0x8uL, "unexpected word after clearing bit %lx", words[3]);
+);
+
+unittest(
+  /*
+    testing:
+      BitstreamLayout::BitstreamLayout
+      BitstreamImage::encode
+      BitstreamImage::decode
+  */
+  arch_config_t arch;
+  arch.wordSize=32;
+  BitstreamLayout layout(arch);
+  
+  // chain registers are stored back to front after the RAM records
+  const BitstreamLayout::section_t &ram=layout.section(BitstreamLayout::RAM);
+  const BitstreamLayout::section_t &conn=
+    layout.section(BitstreamLayout::CONNECTION);
+  Assertf(
+    (ram.first==0) && (ram.stride==2) && (ram.lines==16),
+    "unexpected RAM section at %zu, %zu lines of %zu words",
+    ram.first,ram.lines,ram.stride);
+  Assertf(
+    layout.line(BitstreamLayout::CONNECTION,0)==layout.nWords()-conn.stride,
+    "unexpected first connection line at %zu", 
+    layout.line(BitstreamLayout::CONNECTION,0));
+  Assertf(
+    layout.line(BitstreamLayout::OR_PLANE,arch.segmentBits-1)==
+    ram.lines*ram.stride,
+    "unexpected last OR line at %zu", 
+    layout.line(BitstreamLayout::OR_PLANE,arch.segmentBits-1));
+
+  BitstreamImage img(layout), img2(layout);
+  img.setField(BitstreamLayout::RAM_BASE,3,0x12345678);
+  img.setField(BitstreamLayout::RAM_INCLINE,3,0x9a);
+  img.set(BitstreamLayout::OR_PLANE,1,63);
+  img.setField(BitstreamLayout::AND_NORMAL,5,0x5);
+  img.set(BitstreamLayout::CONNECTION,10,95);
+
+  alp::array_t<uint64_t> words;
+  img.encode(words);
+  Assertf(words.len==layout.nWords(), "unexpected length %zu", words.len);
+  Assertf(
+    (words[6]==0x3456789auL) && (words[7]==0x12uL), 
+    "unexpected RAM record %lx %lx", words[6], words[7]);
+  Assertf(
+    words[0]==0x55555555uL, "unexpected unused RAM record %lx", words[0]);
+  Assertf(img2.decode(words), "decoding failed");
+  Assertf(img==img2, "decoded image differs");
+  Assertf(
+    img2.getField(BitstreamLayout::RAM_BASE,3)==0x12345678, 
+    "unexpected decoded base %lx", 
+    img2.getField(BitstreamLayout::RAM_BASE,3));
+  
+  words[0]|=1uL<<32;
+  Assertf(!img2.decode(words), "accepted bits beyond word size");
+);
+
+unittest(
+  /*
+    testing:
+      BitstreamLayout::delta
+  */
+  arch_config_t arch;
+  BitstreamLayout layout(arch);
+  BitstreamImage img(layout);
+  alp::array_t<uint64_t> ref, cur;
+  alp::array_t<BitstreamLayout::run_t> runs;
+
+  img.encode(ref);
+  img.setField(BitstreamLayout::RAM_BASE,2,1);
+  img.setField(BitstreamLayout::RAM_BASE,4,1);
+  img.setField(BitstreamLayout::RAM_BASE,9,1);
+  img.encode(cur);
+  Assertf(!layout.delta(ref,cur,runs), "chain changed with RAM only");
+  Assertf(
+    (runs.len==2) && (runs[0].first==2) && (runs[0].count==3) &&
+    (runs[1].first==9) && (runs[1].count==1),
+    "unexpected RAM runs (%zu runs)", runs.len);
+
+  img.set(BitstreamLayout::AND_PLANE,0,0);
+  img.encode(cur);
+  Assertf(layout.delta(ref,cur,runs), "chain change not detected");
+  const BitstreamLayout::section_t &orp=
+    layout.section(BitstreamLayout::OR_PLANE);
+  Assertf(
+    (runs.len==3) && (runs[2].first==orp.first) && 
+    (runs[2].first+runs[2].count==layout.nWords()),
+    "chain not written as a whole");
+);
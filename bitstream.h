@@ -0,0 +1,268 @@
+/** \file bitstream.h
+  * \brief Packed representation of LUT configuration bitstreams.
+  */
+#ifndef RISCV_LUT_COMPULER_BITSTREAM_H
+#define RISCV_LUT_COMPULER_BITSTREAM_H
+
+#include <alpha/alpha.h>
+#include "arch-config.h"
+#include <stdint.h>
+#include <assert.h>
+
+/** Writer for LUT configuration bitstreams.
+  *
+  * Operates in place on an array of words, each holding wordSize bits in its
+  * least significant bits. Values wider than a word are stored with their 
+  * least significant word first, i.e. bit i of a value at word index at is 
+  * found in bit i%wordSize of word at+i/wordSize.
+  *
+  * The array is referenced, not copied, so it may be resized while the 
+  * writer exists.
+  */
+class Bitstream {
+  protected:
+    alp::array_t<uint64_t> &_words;
+    int _word_size;
+    
+    uint64_t _word_mask() const {
+      return (_word_size<64) ? (1uL<<_word_size)-1 : ~0uL;
+    }
+
+  public:
+    Bitstream(alp::array_t<uint64_t> &words, int word_size) :
+      _words(words), _word_size(word_size) {
+      
+    }
+    
+    int wordSize() const { return _word_size; }
+
+    /** Number of words required to store a value of the given width */
+    size_t nWords(size_t bits) const {
+      return (bits+_word_size-1)/_word_size;
+    }
+
+    /** Sets count words starting at word first to pattern. */
+    void fill(size_t first, size_t count, uint64_t pattern);
+
+    /** Writes the bits least significant bits of data to bits offset to
+      * offset+bits-1 of the value at word index at. 
+      */
+    void write(size_t at, size_t offset, size_t bits, uint64_t data);
+
+    /** Sets (or clears) a single bit of the value at word index at. */
+    void set(size_t at, size_t bit, bool state=true) {
+      size_t w=at+bit/_word_size;
+      uint64_t m=1uL<<(bit%_word_size);
+      assert(w<_words.len);
+      if (state) _words[w]|=m;
+      else _words[w]&=~m;
+    }
+    
+    /** Copies a value of the given width from src, packed into 64-bit words
+      * least significant word first, to word index at.
+      */
+    void copy(size_t at, const uint64_t *src, size_t bits);
+
+    /** Reads bits (up to 64) bits of the value at word index at, starting at
+      * bit offset.
+      */
+    uint64_t read(size_t at, size_t offset, size_t bits) const;
+};
+
+/** Describes how a LUT configuration is laid out in a bitstream.
+  *
+  * The configuration consists of sections, each a vector of lines of equal
+  * width: the RAM records of all slots, followed by the chain registers. 
+  * Each line takes an integral number of words. The chain registers are 
+  * shifted in back to front, so their lines are stored in reverse order 
+  * from the end of the bitstream: the connection plane last, preceded by 
+  * the PLA AND plane and the PLA OR plane.
+  *
+  * All widths and word offsets are derived from the architecture once, 
+  * when the layout is constructed.
+  */
+class BitstreamLayout {
+  public:
+    /** Sections, in the order they are stored in */
+    enum section_id_t {
+      RAM=0,
+      OR_PLANE,
+      AND_PLANE,
+      CONNECTION,
+      NUM_SECTIONS
+    };
+
+    /** Fields of the lines of a section */
+    enum field_id_t {
+      RAM_INCLINE=0,   ///< incline of a segment
+      RAM_BASE,        ///< base value of a segment
+      OR_LINE,         ///< interconnects driving a RAM address bit
+      AND_INVERTED,    ///< inverted selector inputs of an interconnect
+      AND_NORMAL,      ///< selector inputs of an interconnect
+      CONNECTION_LINE, ///< input bit connected to an interpolation line
+      NUM_FIELDS
+    };
+
+    struct section_t {
+      const char *name;
+      size_t lines;     ///< number of lines
+      size_t bits;      ///< width of each line
+      size_t stride;    ///< words taken by each line
+      size_t first;     ///< word index of the first word of the section
+      bool reversed;    ///< lines stored in reverse order
+      /** Words can be written individually. Otherwise the section is part of
+        * the chain registers, which are shifted in as a whole.
+        */
+      bool addressable;
+      uint64_t pattern; ///< initial content of each word of unused lines
+    };
+
+    struct field_t {
+      const char *name;
+      section_id_t section;
+      size_t offset;    ///< bit offset within the line
+      size_t bits;
+    };
+
+  protected:
+    int _word_size;
+    size_t _n_words;
+    section_t _sections[NUM_SECTIONS];
+    field_t _fields[NUM_FIELDS];
+
+    void _add_section(
+      section_id_t id, const char *name, size_t lines, size_t bits, 
+      bool reversed, bool addressable, uint64_t pattern);
+    void _add_field(
+      field_id_t id, const char *name, section_id_t section, size_t offset,
+      size_t bits);
+
+  public:
+    BitstreamLayout(const arch_config_t &arch);
+
+    int wordSize() const { return _word_size; }
+    
+    /** Total number of words of the bitstream */
+    size_t nWords() const { return _n_words; }
+    
+    const section_t &section(section_id_t id) const { 
+      assert(id<NUM_SECTIONS);
+      return _sections[id]; 
+    }
+    const field_t &field(field_id_t id) const { 
+      assert(id<NUM_FIELDS);
+      return _fields[id]; 
+    }
+
+    /** Returns the word index of line i of the given section */
+    size_t line(section_id_t id, size_t i) const {
+      const section_t &s=_sections[id];
+      assert(i<s.lines);
+      return s.first+(s.reversed ? s.lines-1-i : i)*s.stride;
+    }
+
+    /** Run of consecutive words of a bitstream */
+    struct run_t {
+      size_t first;
+      size_t count;
+    };
+
+    /** Determines the words in which two bitstreams of this layout differ.
+      *
+      * Words of addressable sections are compared individually, runs 
+      * separated by a single unchanged word are merged. Consecutive 
+      * sections which are not addressable can only be written as a whole, 
+      * so they are covered by a single run if any of their words differ.
+      *
+      * \param ref Reference bitstream, e.g. the configuration currently 
+      * loaded.
+      * \param cur Bitstream to be loaded instead.
+      * \param runs Receives the runs of words to write, in ascending order.
+      * \return true if the chain registers need to be written.
+      */
+    bool delta(
+      const alp::array_t<uint64_t> &ref, const alp::array_t<uint64_t> &cur,
+      alp::array_t<run_t> &runs) const;
+};
+
+/** Decoded content of a LUT configuration bitstream.
+  *
+  * Holds the lines of every section of a layout independently of word size
+  * and word order, each packed into 64-bit words least significant word 
+  * first. Bits beyond the width of a line are always clear. 
+  * 
+  * The translators fill an image, which is then serialized by encode. The
+  * decoder recovers the image from a bitstream, e.g. for verification.
+  */
+class BitstreamImage {
+  protected:
+    BitstreamLayout _layout;
+    size_t _first[BitstreamLayout::NUM_SECTIONS];
+    size_t _stride[BitstreamLayout::NUM_SECTIONS];
+    alp::array_t<uint64_t> _data;
+
+  public:
+    BitstreamImage(const BitstreamLayout &layout);
+
+    const BitstreamLayout &layout() const { return _layout; }
+
+    /** Resets all lines to the pattern of their section */
+    void clear();
+
+    uint64_t *line(BitstreamLayout::section_id_t s, size_t i) {
+      assert(i<_layout.section(s).lines);
+      return _data.ptr+_first[s]+i*_stride[s];
+    }
+    const uint64_t *line(BitstreamLayout::section_id_t s, size_t i) const {
+      assert(i<_layout.section(s).lines);
+      return _data.ptr+_first[s]+i*_stride[s];
+    }
+
+    /** Writes the bits least significant bits of data to bits offset to
+      * offset+bits-1 of line i of section s.
+      */
+    void write(
+      BitstreamLayout::section_id_t s, size_t i, size_t offset, size_t bits,
+      uint64_t data);
+    
+    /** Reads bits (up to 64) bits of line i of section s, starting at bit
+      * offset.
+      */
+    uint64_t read(
+      BitstreamLayout::section_id_t s, size_t i, size_t offset, size_t bits)
+      const;
+
+    /** Sets (or clears) a single bit of line i of section s. */
+    void set(
+      BitstreamLayout::section_id_t s, size_t i, size_t bit, bool state=true) {
+      assert(bit<_layout.section(s).bits);
+      uint64_t m=1uL<<(bit%64);
+      if (state) line(s,i)[bit/64]|=m;
+      else line(s,i)[bit/64]&=~m;
+    }
+
+    /** Sets field f (of at most 64 bits) of line i of its section */
+    void setField(BitstreamLayout::field_id_t f, size_t i, uint64_t data) {
+      const BitstreamLayout::field_t &fd=_layout.field(f);
+      write(fd.section,i,fd.offset,fd.bits,data);
+    }
+    uint64_t getField(BitstreamLayout::field_id_t f, size_t i) const {
+      const BitstreamLayout::field_t &fd=_layout.field(f);
+      return read(fd.section,i,fd.offset,fd.bits);
+    }
+
+    bool operator==(const BitstreamImage &o) const;
+    bool operator!=(const BitstreamImage &o) const { return !(*this==o); }
+
+    /** Serializes the image into words, according to its layout. */
+    void encode(alp::array_t<uint64_t> &words) const;
+    
+    /** Recovers the image from words.
+      *
+      * \return false if words do not hold a bitstream of this layout, i.e.
+      * its length differs or it has bits set outside of lines.
+      */
+    bool decode(const alp::array_t<uint64_t> &words);
+};
+
+#endif
@@ -0,0 +1,145 @@
+#include "build-manifest.h"
+#include "error.h"
+#include "util.h"
+#include <stdio.h>
+#include <string.h>
+
+#if defined(__linux)
+#include <sys/stat.h>
+
+/** Hashes the identity of the running compiler, i.e. the size and
+  * modification time of its executable, false if it is unknown.
+  */
+static bool _hash_compiler(uint64_t &h) {
+  struct stat st;
+  if (stat("/proc/self/exe",&st)!=0) return false;
+  alp::string s=alp::string::Format(
+    "%lu %li.%09li",(unsigned long)st.st_size,
+    (long)st.st_mtim.tv_sec,(long)st.st_mtim.tv_nsec);
+  h=hash_fnv1a(s.ptr,s.len);
+  return true;
+}
+
+static bool _exists(const alp::string &fn) {
+  struct stat st;
+  return stat(fn.ptr,&st)==0;
+}
+
+#else
+#error "BuildManifest not implemented for this OS"
+#endif
+
+void BuildManifest::_add(const char *key, const char *fn) {
+  uint64_t h;
+  if (hash_file(fn,h)) {
+    _entries+=alp::string::Format("%s %.16lx %s\n",key,(unsigned long)h,fn);
+  } else {
+    _entries+=alp::string::Format("%s missing %s\n",key,fn);
+  }
+}
+
+BuildManifest::BuildManifest(const options_t &options) :
+  _output(options.outputName) {
+  const arch_config_t &arch=options.arch;
+  uint64_t h;
+  alp::string s;
+
+  _entries=alp::string::Format("riscv-lut-compiler manifest %i\n",Version);
+  if (_hash_compiler(h)) {
+    _entries+=alp::string::Format("compiler %.16lx\n",(unsigned long)h);
+  } else {
+    _entries+="compiler missing\n";
+  }
+
+  _add("input",options.fnInput.ptr);
+  if (options.fnDeltaReference.len>0)
+    _add("reference",options.fnDeltaReference.ptr);
+
+  s=alp::string::Format(
+    "%i %i %i %i %i %i %i %i %i %a %a",
+    arch.numSegments,arch.wordSize,arch.inputWords,arch.segmentBits,
+    arch.selectorBits,arch.interpolationBits,arch.plaInterconnects,
+    arch.base_bits,arch.incline_bits,
+    arch.domainCutoffThreshold,arch.resolutionWarnThreshold);
+  _entries+=alp::string::Format(
+    "arch %.16lx\n",(unsigned long)hash_fnv1a(s.ptr,s.len));
+
+  // options affecting the output only
+  s=alp::string::Format(
+    "%i %i %i %i %i %i %i %i %i %i %i %u %i %i %i %i\n%s\n%s\n%s\n%s\n",
+    options.fInputIntermediate,options.fOutputIntermediate,
+    options.fOutputC,options.fOutputDump,options.fOutputBinary,
+    options.fOutputHex,options.fBigEndian,options.fGenerateGnuplot,
+    options.fExternalCompile,options.elfClass,options.elfFlags,
+    options.fPlaSlotSearch,
+    options.plaExactMaxInputs,options.plaCoverTimeLimit,
+    options.fDeterministic,options.maxWeightSteps,
+    options.lutName.ptr,options.outputName.ptr,
+    options.cmdCompileSO.ptr,options.cmdCompileTargetO.ptr);
+  _entries+=alp::string::Format(
+    "options %.16lx\n",(unsigned long)hash_fnv1a(s.ptr,s.len));
+}
+
+void BuildManifest::setWeights(
+  const alp::string &name, const alp::string &fn) {
+  uint64_t h;
+  _weights=alp::string::Format("weights-name %s\n",name.ptr);
+  if (hash_file(fn.ptr,h)) {
+    _weights+=alp::string::Format(
+      "weights %.16lx %s\n",(unsigned long)h,fn.ptr);
+  } else {
+    _weights+=alp::string::Format("weights missing %s\n",fn.ptr);
+  }
+}
+
+bool BuildManifest::upToDate(const char *fn, VFS &vfs) const {
+  // entries of files which could not be hashed never match
+  if (strstr(_entries.ptr," missing ") ||
+      strstr(_entries.ptr,"compiler missing\n"))
+    return false;
+
+  FILE *f=fopen(fn,"rb");
+  if (!f) return false;
+
+  alp::string content;
+  char buf[4096];
+  size_t n;
+  while((n=fread(buf,1,sizeof(buf),f))>0) content.append(buf,n);
+  fclose(f);
+
+  if ((content.len<_entries.len) ||
+      (memcmp(content.ptr,_entries.ptr,_entries.len)!=0))
+    return false;
+
+  // the remainder records the weights, if any, and the output
+  const char *p=content.ptr+_entries.len;
+  const char *prefix="weights-name ";
+  if (strncmp(p,prefix,strlen(prefix))==0) {
+    const char *e=strchr(p,'\n');
+    if (!e) return false;
+    alp::string name(p+strlen(prefix),(size_t)(e-p-strlen(prefix)));
+    alp::string located=vfs.locate(name);
+    if (located.len<1) return false;
+
+    BuildManifest current(*this);
+    current.setWeights(name,located);
+    if (strncmp(p,current._weights.ptr,current._weights.len)!=0)
+      return false;
+    if (strstr(current._weights.ptr,"weights missing ")) return false;
+    p+=current._weights.len;
+  }
+
+  alp::string output=alp::string::Format("output %s\n",_output.ptr);
+  return (strcmp(p,output.ptr)==0) && _exists(_output);
+}
+
+void BuildManifest::save(const char *fn) const {
+  FILE *f=fopen(fn,"wb");
+  if (!f) throw FileIOException(fn);
+
+  alp::string content=_entries+_weights+
+    alp::string::Format("output %s\n",_output.ptr);
+  bool ok=fwrite(content.ptr,1,content.len,f)==content.len;
+  ok=(fclose(f)==0) && ok;
+  if (!ok) throw FileIOException(fn);
+}
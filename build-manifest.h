@@ -0,0 +1,71 @@
+/** \file build-manifest.h
+  * \brief Manifests recording what an output was built from.
+  */
+#ifndef RISCV_LUT_COMPULER_BUILD_MANIFEST_H
+#define RISCV_LUT_COMPULER_BUILD_MANIFEST_H
+
+#include "options.h"
+
+#include <alpha/alpha.h>
+#include <stdint.h>
+
+/** Record of everything an output of the LUT compilation depends on.
+  *
+  * The manifest is a text file written next to the output, holding one
+  * entry per line: the content hashes of the input file, of the delta
+  * reference if any and of the weights file located for the LUT, as well
+  * as hashes of the architecture, of the options affecting the output and
+  * of the compiler itself. If all of these are unchanged and the output
+  * still exists, building the output again would produce the same result.
+  *
+  * The weights file is only known once the input was parsed, so its entry
+  * records the name given by the input as well. When checking a manifest,
+  * the name is located again, so that a different file being found in the
+  * weights search paths is detected.
+  */
+class BuildManifest {
+  public:
+    enum {
+      Version = 1
+    };
+
+  protected:
+    /** Entries known before building */
+    alp::string _entries;
+    /** Entry of the weights file, empty if none was used */
+    alp::string _weights;
+    alp::string _output;
+
+    void _add(const char *key, const char *fn);
+
+  public:
+    /** Records the input files, architecture and options of options, whose
+      * output name needs to be computed already.
+      */
+    BuildManifest(const options_t &options);
+
+    /** Records the weights file, named name in the input and located at
+      * fn.
+      */
+    void setWeights(const alp::string &name, const alp::string &fn);
+
+    /** Checks whether the manifest file fn matches this manifest and the
+      * output it records still exists.
+      *
+      * \param vfs Search paths to locate the weights file recorded in fn.
+      */
+    bool upToDate(const char *fn, VFS &vfs) const;
+
+    /** Writes the manifest.
+      *
+      * \throw FileIOException The file could not be written to.
+      */
+    void save(const char *fn) const;
+
+    /** Returns the name of the manifest file of the output of options */
+    static alp::string FileName(const options_t &options) {
+      return options.outputName+".manifest";
+    }
+};
+
+#endif
@@ -0,0 +1,342 @@
+#include "disassembler.h"
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+/** Sign-extends the bits least significant bits of v */
+static int64_t _sign_extend(uint64_t v, int bits) {
+  if ((bits<1) || (bits>=64)) return (int64_t)v;
+  uint64_t m=1uL<<(bits-1);
+  v&=(1uL<<bits)-1;
+  return (int64_t)((v^m)-m);
+}
+
+/** Input bit connected to each connection line if the segment space is
+  * segment_space_width bits wide, -1 if none.
+  */
+static int _connected_bit(
+  const arch_config_t &arch, int segment_space_width, int line) {
+  int bit=segment_space_width-arch.interpolationBits-arch.selectorBits+line;
+  if ((bit<0) || (bit>=3*arch.wordSize)) return -1;
+  return bit;
+}
+
+BitstreamDisassembler::BitstreamDisassembler(const arch_config_t &arch) :
+  _arch(arch), _layout(arch), _n_words(0), _segment_space_width(-1) {
+
+}
+
+void BitstreamDisassembler::decode(const alp::array_t<uint64_t> &words) {
+  BitstreamImage img(_layout);
+  const BitstreamLayout::section_t &conn=
+    _layout.section(BitstreamLayout::CONNECTION);
+  uint64_t input_mask=(_arch.selectorBits<64)
+    ? (1uL<<_arch.selectorBits)-1 : ~0uL;
+
+  if (!img.decode(words))
+    throw RuntimeError("bitstream does not match the architecture");
+  _n_words=words.len;
+
+  // connection plane
+  _connection.clear();
+  _segment_space_width=-1;
+  for(size_t i=0;i<conn.lines;i++) {
+    int bit=-1;
+    for(size_t j=0;(j<conn.bits) && (bit<0);j++)
+      if (img.read(BitstreamLayout::CONNECTION,i,j,1)) bit=j;
+    _connection.insert(bit);
+    if ((bit>=0) && (_segment_space_width<0)) {
+      _segment_space_width=
+        bit+_arch.interpolationBits+_arch.selectorBits-i;
+    }
+  }
+
+  // PLA planes
+  _implicants.clear();
+  for(int i=0;i<_arch.plaInterconnects;i++) {
+    implicant_t m;
+    m.impl=0;
+    for(int j=0;j<_arch.segmentBits;j++)
+      m.impl|=(uint64_t)img.read(BitstreamLayout::OR_PLANE,j,i,1)<<j;
+    if (!m.impl) continue;
+
+    uint64_t inverted=img.getField(BitstreamLayout::AND_INVERTED,i);
+    uint64_t normal=img.getField(BitstreamLayout::AND_NORMAL,i);
+    m.value=normal;
+    m.care=(inverted|normal)&input_mask;
+    m.impossible=(inverted&normal)!=0;
+    _implicants.insert(m);
+  }
+
+  // RAM
+  _ram.clear();
+  for(size_t i=0;i<((size_t)1<<_arch.segmentBits);i++) {
+    ram_record_t r;
+    r.base=_sign_extend(
+      img.getField(BitstreamLayout::RAM_BASE,i),_arch.base_bits);
+    r.incline=_sign_extend(
+      img.getField(BitstreamLayout::RAM_INCLINE,i),_arch.incline_bits);
+    _ram.insert(r);
+  }
+
+  // evaluate the PLA, unaddressed selector values select slot 0
+  _address.setlen((size_t)1<<_arch.selectorBits);
+  for(size_t x=0;x<_address.len;x++) {
+    uint32_t a=0;
+    for(size_t j=0;j<_implicants.len;j++) {
+      const implicant_t &m=_implicants[j];
+      if (!m.impossible && ((x&m.care)==m.value)) a|=m.impl;
+    }
+    _address[x]=a;
+  }
+
+  // segments from runs of selector values addressing the same slot
+  _segments.clear();
+  _slots.clear();
+  int64_t step=(int64_t)1<<_arch.interpolationBits;
+  for(size_t x=0;x<_address.len;) {
+    size_t e=x+1;
+    while((e<_address.len) && (_address[e]==_address[x])) e++;
+
+    const ram_record_t &r=_ram[_address[x]];
+    int64_t y0=r.base+r.incline*step*(int64_t)x;
+    _segments.insert(segment_t(
+      x,e-x,seg_data_t(y0),seg_data_t(y0+r.incline*step*(int64_t)(e-x))));
+    _slots.insert(_address[x]);
+    x=e;
+  }
+}
+
+void BitstreamDisassembler::listing(OutputStream &out) const {
+  alp::array_t<char> used;
+  used.setlen(_ram.len);
+  for(size_t i=0;i<used.len;i++) used[i]=0;
+  for(size_t i=0;i<_slots.len;i++) used[_slots[i]]=1;
+
+  out.puts(alp::string::Format(
+    "; %zu words of %i bits\n",_n_words,_arch.wordSize).ptr);
+  if (_segment_space_width<0) {
+    out.puts("; segment space width unknown\n");
+  } else {
+    out.puts(alp::string::Format(
+      "; segment space width %i bits\n",_segment_space_width).ptr);
+  }
+
+  out.puts("\nconnection plane:\n");
+  for(size_t i=0;i<_connection.len;i++) {
+    if (_connection[i]<0) {
+      out.puts(alp::string::Format("  line %2zu: -\n",i).ptr);
+    } else {
+      out.puts(alp::string::Format(
+        "  line %2zu: input bit %i\n",i,_connection[i]).ptr);
+    }
+  }
+
+  out.puts(alp::string::Format(
+    "\nPLA, %zu of %i interconnects used:\n",
+    _implicants.len,_arch.plaInterconnects).ptr);
+  for(size_t i=0;i<_implicants.len;i++) {
+    const implicant_t &m=_implicants[i];
+    alp::string cube, addr;
+    for(int j=_arch.selectorBits-1;j>=0;j--) {
+      if (!((m.care>>j)&1)) cube+="-";
+      else cube+=((m.value>>j)&1) ? "1" : "0";
+    }
+    for(int j=_arch.segmentBits-1;j>=0;j--)
+      addr+=((m.impl>>j)&1) ? "1" : "0";
+    out.puts(alp::string::Format(
+      "  %3zu: %s -> %s%s\n",i,cube.ptr,addr.ptr,
+      m.impossible ? " (never selected)" : "").ptr);
+  }
+
+  out.puts("\nRAM:\n");
+  for(size_t i=0;i<_ram.len;i++) {
+    if (!used[i]) {
+      out.puts(alp::string::Format("  slot %3zu: unused\n",i).ptr);
+      continue;
+    }
+    out.puts(alp::string::Format(
+      "  slot %3zu: base %lli incline %lli\n",
+      i,(long long)_ram[i].base,(long long)_ram[i].incline).ptr);
+  }
+
+  out.puts("\nsegments:\n");
+  for(size_t i=0;i<_segments.len;i++) {
+    const segment_t &seg=_segments[i];
+    out.puts(alp::string::Format(
+      "  %lu %lu slot %u: %lli %lli\n",
+      (unsigned long)seg.prefix,(unsigned long)seg.width,_slots[i],
+      (long long)seg.y0.data_i,(long long)seg.y1.data_i).ptr);
+  }
+}
+
+bool BitstreamDisassembler::validate(
+  const LookupTable &lut, alp::string &report) const {
+  size_t n_errors=0;
+  alp::array_t<char> slot_owner;
+
+  #define MISMATCH(...) { \
+    report+=alp::string::Format(__VA_ARGS__); \
+    report+="\n"; \
+    n_errors++; \
+  }
+
+  for(size_t i=0;i<_connection.len;i++) {
+    int bit=_connected_bit(_arch,lut.segment_space_width(),i);
+    if (bit!=_connection[i])
+      MISMATCH(
+        "connection line %zu: input bit %i expected, %i found",
+        i,bit,_connection[i]);
+  }
+
+  slot_owner.setlen(_ram.len);
+  for(size_t i=0;i<slot_owner.len;i++) slot_owner[i]=0;
+
+  const alp::array_t<segment_t> &segments=lut.segments();
+  uint64_t base_mask=(_arch.base_bits<64)
+    ? (1uL<<_arch.base_bits)-1 : ~0uL;
+  uint64_t incline_mask=(_arch.incline_bits<64)
+    ? (1uL<<_arch.incline_bits)-1 : ~0uL;
+  for(size_t i=0;i<segments.len;i++) {
+    const segment_t &seg=segments[i];
+    if ((size_t)seg.prefix+seg.width>_address.len) {
+      MISMATCH(
+        "segment %zu: [%u,%u) beyond selector space",
+        i,seg.prefix,seg.prefix+seg.width);
+      continue;
+    }
+
+    uint32_t slot=_address[seg.prefix];
+    bool consistent=true;
+    for(size_t x=seg.prefix;x<(size_t)seg.prefix+seg.width;x++) {
+      if (_address[x]!=slot) {
+        MISMATCH(
+          "segment %zu: selector value %zu addresses slot %u instead of %u",
+          i,x,_address[x],slot);
+        consistent=false;
+        break;
+      }
+    }
+    if (!consistent) continue;
+
+    if (slot_owner[slot]) {
+      MISMATCH("segment %zu: slot %u shared with another segment",i,slot);
+      continue;
+    }
+    slot_owner[slot]=1;
+
+    uint64_t base,incline;
+    LookupTable::RamRecord(_arch,seg,base,incline);
+    if (
+      ((uint64_t)_ram[slot].base&base_mask)!=(base&base_mask) ||
+      ((uint64_t)_ram[slot].incline&incline_mask)!=(incline&incline_mask)) {
+      MISMATCH(
+        "segment %zu: slot %u holds base %lli incline %lli, expected "
+        "%lli and %lli",
+        i,slot,(long long)_ram[slot].base,(long long)_ram[slot].incline,
+        (long long)_sign_extend(base,_arch.base_bits),
+        (long long)_sign_extend(incline,_arch.incline_bits));
+    }
+  }
+
+  #undef MISMATCH
+  return n_errors==0;
+}
+
+bool BitstreamDisassembler::ParseDump(
+  const char *ptr, size_t cb, alp::array_t<uint64_t> &words) {
+  words.clear();
+  for(size_t i=0;i<cb;) {
+    if (isspace(ptr[i])) {
+      i++;
+      continue;
+    }
+    if (!isdigit(ptr[i])) return false;
+
+    uint64_t w=0;
+    for(;(i<cb) && isdigit(ptr[i]);i++) w=w*10+(ptr[i]-'0');
+    words.insert(w);
+  }
+  return true;
+}
+
+void BitstreamDisassembler::LoadDumpFile(
+  const char *fn, alp::array_t<uint64_t> &words) {
+  FILE *f=fopen(fn,"rb");
+  char *buf;
+  size_t cb;
+  if (!f) throw FileIOException(fn);
+
+  fseek(f,0,SEEK_END);
+  cb=ftell(f);
+  fseek(f,0,SEEK_SET);
+
+  buf=(char*)malloc(cb);
+  if ((buf==NULL) && (cb>0)) {
+    fclose(f);
+    throw FileIOException(fn);
+  }
+
+  if (fread(buf,1,cb,f)<cb) {
+    fclose(f);
+    free((void*)buf);
+    throw FileIOException(fn);
+  }
+  fclose(f);
+
+  bool ok=ParseDump(buf,cb,words);
+  free((void*)buf);
+  if (!ok)
+    throw SyntaxError(alp::string::Format("%s is not a bitstream dump",fn));
+}
+
+unittest(
+  /*
+    testing:
+      BitstreamDisassembler::decode
+      BitstreamDisassembler::ParseDump
+  */
+  arch_config_t arch;
+  BitstreamLayout layout(arch);
+  BitstreamImage img(layout);
+  alp::array_t<uint64_t> words;
+
+  // two segments: selector values 0-3 at slot 2, 4-7 at slot 1
+  img.setField(BitstreamLayout::AND_INVERTED,0,0x4);
+  img.set(BitstreamLayout::OR_PLANE,1,0);
+  img.setField(BitstreamLayout::AND_NORMAL,1,0x4);
+  img.set(BitstreamLayout::OR_PLANE,0,1);
+  img.setField(BitstreamLayout::RAM_BASE,2,100);
+  img.setField(BitstreamLayout::RAM_INCLINE,2,1);
+  img.setField(BitstreamLayout::RAM_BASE,1,(uint64_t)-5);
+  img.setField(BitstreamLayout::RAM_INCLINE,1,(uint64_t)-1);
+  img.set(BitstreamLayout::CONNECTION,0,5);
+  img.encode(words);
+
+  BitstreamDisassembler dis(arch);
+  dis.decode(words);
+  Assertf(
+    dis.segment_space_width()==16,
+    "unexpected segment space width %i", dis.segment_space_width());
+  Assertf(
+    (dis.segments().len==2) && (dis.slots()[0]==2) && (dis.slots()[1]==1) &&
+    (dis.segments()[1].prefix==4) && (dis.segments()[1].width==4),
+    "unexpected segments (%zu)", dis.segments().len);
+  Assertf(
+    (dis.ram()[1].base==-5) && (dis.ram()[1].incline==-1),
+    "unexpected RAM record %lli %lli",
+    (long long)dis.ram()[1].base,(long long)dis.ram()[1].incline);
+  Assertf(
+    dis.segments()[0].y1.data_i==100+4*256,
+    "unexpected segment value %lli", (long long)dis.segments()[0].y1.data_i);
+
+  alp::array_t<uint64_t> dump;
+  Assertf(
+    BitstreamDisassembler::ParseDump(
+      "1 22\n18446744073709551615\n",26,dump) &&
+    (dump.len==3) && (dump[2]==~0uL),
+    "unexpected dump parse result");
+  Assertf(
+    !BitstreamDisassembler::ParseDump("name \"x\"\n",9,dump),
+    "intermediate file accepted as dump");
+);
@@ -0,0 +1,110 @@
+/** \file disassembler.h
+  * \brief Decoding of LUT configuration bitstreams.
+  */
+#ifndef RISCV_LUT_COMPULER_DISASSEMBLER_H
+#define RISCV_LUT_COMPULER_DISASSEMBLER_H
+
+#include "lut.h"
+#include "bitstream.h"
+#include "output-stream.h"
+
+#include <alpha/alpha.h>
+
+/** Recovers the configuration of a LUT from its bitstream.
+  *
+  * Decodes the connection plane, the PLA implicants and the RAM records of a
+  * bitstream for a given architecture. The segment table is then rebuilt by
+  * evaluating the PLA for every selector value: consecutive selector values
+  * addressing the same RAM slot form a segment.
+  *
+  * The decoded configuration can be listed in human-readable form or
+  * checked against the LUT it was translated from.
+  */
+class BitstreamDisassembler {
+  public:
+    /** PLA interconnect, decoded from the AND and OR plane */
+    struct implicant_t {
+      uint64_t value;    ///< selector bits required to be set
+      uint64_t care;     ///< selector bits connected
+      uint64_t impl;     ///< RAM address bits driven
+      bool impossible;   ///< both polarities of a selector bit connected
+    };
+
+    struct ram_record_t {
+      int64_t base;
+      int64_t incline;
+    };
+
+  protected:
+    arch_config_t _arch;
+    BitstreamLayout _layout;
+    size_t _n_words;
+
+    /** Selector bits per connection line, -1 if not connected */
+    alp::array_t<int> _connection;
+    int _segment_space_width;
+
+    /** Used interconnects, i.e. those driving any RAM address bit */
+    alp::array_t<implicant_t> _implicants;
+    alp::array_t<ram_record_t> _ram;
+    /** RAM slot addressed by each selector value */
+    alp::array_t<uint32_t> _address;
+
+    alp::array_t<segment_t> _segments;
+    alp::array_t<uint32_t> _slots;
+
+  public:
+    BitstreamDisassembler(const arch_config_t &arch);
+
+    /** Decodes a bitstream.
+      *
+      * \throw RuntimeError words do not hold a bitstream for the
+      * architecture.
+      */
+    void decode(const alp::array_t<uint64_t> &words);
+
+    /** Returns the segment space width derived from the connection plane,
+      * -1 if no line is connected.
+      */
+    int segment_space_width() const { return _segment_space_width; }
+    const alp::array_t<implicant_t> &implicants() const {
+      return _implicants;
+    }
+    const alp::array_t<ram_record_t> &ram() const { return _ram; }
+    /** Returns the segments, with values computed from their RAM records.
+      */
+    const alp::array_t<segment_t> &segments() const { return _segments; }
+    /** Returns the RAM slot of each segment */
+    const alp::array_t<uint32_t> &slots() const { return _slots; }
+
+    /** Writes a human-readable listing of the decoded configuration */
+    void listing(OutputStream &out) const;
+
+    /** Checks the decoded configuration against a LUT.
+      *
+      * Every segment of lut needs to be addressed by exactly its selector
+      * values, at a RAM slot of its own holding its RAM record. The
+      * connection plane needs to match the segment space width of lut.
+      *
+      * \param report Receives a description of each mismatch, one per line.
+      * \return true if the configuration matches.
+      */
+    bool validate(const LookupTable &lut, alp::string &report) const;
+
+    /** Parses a bitstream dump, i.e. decimal words separated by white
+      * space.
+      *
+      * \return false if the buffer is not a dump.
+      */
+    static bool ParseDump(
+      const char *ptr, size_t cb, alp::array_t<uint64_t> &words);
+
+    /** Loads a bitstream dump file using ParseDump.
+      *
+      * \throw FileIOException The file could not be read.
+      * \throw SyntaxError The file is not a bitstream dump.
+      */
+    static void LoadDumpFile(const char *fn, alp::array_t<uint64_t> &words);
+};
+
+#endif
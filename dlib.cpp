@@ -1,5 +1,6 @@
 
 #include "dlib.h"
+#include "stats.h"
 #include <stdlib.h>
 
 #if defined(__linux)
@@ -12,6 +13,7 @@ struct dynamic_library_t {
 
 
 dynamic_library_t *dlib_open(const char *fn) {
+  Stats::Timer timer(Stats::TargetLoad);
   void *handle;
   
   handle=dlopen(fn,RTLD_LAZY);
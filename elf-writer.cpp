@@ -0,0 +1,293 @@
+#include "elf-writer.h"
+#include <stdio.h>
+#include <string.h>
+
+// section indices
+enum {
+  SEC_NULL=0,
+  SEC_TEXT,
+  SEC_RODATA,
+  SEC_NOTE_GNU_STACK,
+  SEC_SYMTAB,
+  SEC_STRTAB,
+  SEC_SHSTRTAB,
+  NUM_SECTIONS
+};
+
+// number of local symbols: null, file, .text and .rodata section symbols
+#define NUM_LOCAL_SYMBOLS 4
+
+/** Appends the n least significant bytes of v, little endian */
+static void _put(alp::array_t<uint8_t> &res, uint64_t v, int n) {
+  for(int i=0;i<n;i++) res.insert((uint8_t)(v>>(8*i)));
+}
+
+/** Appends an address-sized value, i.e. 4 or 8 bytes depending on class */
+static void _put_addr(alp::array_t<uint8_t> &res, uint64_t v, int elf_class) {
+  _put(res,v,elf_class/8);
+}
+
+static void _align(alp::array_t<uint8_t> &res, size_t align) {
+  while(res.len%align) res.insert(0);
+}
+
+/** Appends s to a string table, returning its offset */
+static size_t _add_string(alp::array_t<uint8_t> &tbl, const char *s) {
+  size_t res=tbl.len;
+  tbl.insert((uint8_t*)s,strlen(s)+1);
+  return res;
+}
+
+static void _put_symbol(
+  alp::array_t<uint8_t> &res, int elf_class, size_t name, uint8_t info,
+  uint16_t shndx, uint64_t value, uint64_t size) {
+  _put(res,name,4);
+  if (elf_class==64) {
+    _put(res,info,1);
+    _put(res,0,1);
+    _put(res,shndx,2);
+    _put(res,value,8);
+    _put(res,size,8);
+  } else {
+    _put(res,value,4);
+    _put(res,size,4);
+    _put(res,info,1);
+    _put(res,0,1);
+    _put(res,shndx,2);
+  }
+}
+
+static void _put_section_header(
+  alp::array_t<uint8_t> &res, int elf_class, size_t name, uint32_t type,
+  uint64_t flags, size_t offset, size_t size, uint32_t link, uint32_t info,
+  size_t align, size_t entsize) {
+  _put(res,name,4);
+  _put(res,type,4);
+  _put_addr(res,flags,elf_class);
+  _put_addr(res,0,elf_class); // address
+  _put_addr(res,offset,elf_class);
+  _put_addr(res,size,elf_class);
+  _put(res,link,4);
+  _put(res,info,4);
+  _put_addr(res,align,elf_class);
+  _put_addr(res,entsize,elf_class);
+}
+
+bool ElfWriter::AbiFlags(const char *abi, int elf_class, uint32_t &flags) {
+  static const struct {
+    const char *name;
+    int elf_class;
+    uint32_t flags;
+  } abis[]={
+    { "ilp32", 32, EF_RISCV_FLOAT_ABI_SOFT },
+    { "ilp32f", 32, EF_RISCV_FLOAT_ABI_SINGLE },
+    { "ilp32d", 32, EF_RISCV_FLOAT_ABI_DOUBLE },
+    { "ilp32e", 32, EF_RISCV_FLOAT_ABI_SOFT|EF_RISCV_RVE },
+    { "lp64", 64, EF_RISCV_FLOAT_ABI_SOFT },
+    { "lp64f", 64, EF_RISCV_FLOAT_ABI_SINGLE },
+    { "lp64d", 64, EF_RISCV_FLOAT_ABI_DOUBLE }
+  };
+  for(size_t i=0;i<sizeof(abis)/sizeof(abis[0]);i++) {
+    if (strcmp(abis[i].name,abi)!=0) continue;
+    if (abis[i].elf_class!=elf_class) return false;
+    flags=EF_RISCV_RVC|abis[i].flags;
+    return true;
+  }
+  return false;
+}
+
+ElfWriter::ElfWriter(int elf_class, const char *source, uint32_t flags) :
+  _elf_class(elf_class), _flags(flags), _source(source), _rodata_align(1) {
+  assert(((elf_class==32) || (elf_class==64)) && "unsupported ELF class");
+}
+
+void ElfWriter::addArray(
+  const char *name, const uint64_t *words, size_t n, int word_size) {
+  assert(((word_size==32) || (word_size==64)) && "unsupported word size");
+  size_t align=word_size/8;
+  symbol_t sym;
+
+  if (align>_rodata_align) _rodata_align=align;
+  _align(_rodata,align);
+  sym.name=name;
+  sym.offset=_rodata.len;
+  sym.size=n*align;
+  for(size_t i=0;i<n;i++) _put(_rodata,words[i],align);
+  _symbols.push_back(sym);
+}
+
+void ElfWriter::generate(alp::array_t<uint8_t> &res) const {
+  const uint32_t SHT_PROGBITS=1, SHT_SYMTAB=2, SHT_STRTAB=3;
+  const uint64_t SHF_ALLOC=0x2, SHF_EXECINSTR=0x4;
+  const uint8_t STB_LOCAL=0, STB_GLOBAL=1;
+  const uint8_t STT_OBJECT=1, STT_SECTION=3, STT_FILE=4;
+  const uint16_t SHN_ABS=0xfff1;
+  size_t addr_size=_elf_class/8;
+  size_t ehsize=(_elf_class==64) ? 64 : 52;
+  size_t shentsize=(_elf_class==64) ? 64 : 40;
+  size_t symentsize=(_elf_class==64) ? 24 : 16;
+  alp::array_t<uint8_t> strtab, shstrtab, symtab;
+  size_t sh_name[NUM_SECTIONS], sh_offset[NUM_SECTIONS];
+
+  // section names
+  shstrtab.insert(0);
+  sh_name[SEC_NULL]=0;
+  sh_name[SEC_TEXT]=_add_string(shstrtab,".text");
+  sh_name[SEC_RODATA]=_add_string(shstrtab,".rodata");
+  sh_name[SEC_NOTE_GNU_STACK]=_add_string(shstrtab,".note.GNU-stack");
+  sh_name[SEC_SYMTAB]=_add_string(shstrtab,".symtab");
+  sh_name[SEC_STRTAB]=_add_string(shstrtab,".strtab");
+  sh_name[SEC_SHSTRTAB]=_add_string(shstrtab,".shstrtab");
+
+  // symbols: locals first, as required
+  strtab.insert(0);
+  _put_symbol(symtab,_elf_class,0,0,0,0,0);
+  _put_symbol(
+    symtab,_elf_class,_add_string(strtab,_source.c_str()),
+    (STB_LOCAL<<4)|STT_FILE,SHN_ABS,0,0);
+  _put_symbol(
+    symtab,_elf_class,0,(STB_LOCAL<<4)|STT_SECTION,SEC_TEXT,0,0);
+  _put_symbol(
+    symtab,_elf_class,0,(STB_LOCAL<<4)|STT_SECTION,SEC_RODATA,0,0);
+  for(size_t i=0;i<_symbols.size();i++) {
+    _put_symbol(
+      symtab,_elf_class,_add_string(strtab,_symbols[i].name.c_str()),
+      (STB_GLOBAL<<4)|STT_OBJECT,SEC_RODATA,_symbols[i].offset,
+      _symbols[i].size);
+  }
+
+  // section contents follow the ELF header
+  res.clear();
+  res.setlen(ehsize);
+  sh_offset[SEC_NULL]=0;
+  sh_offset[SEC_TEXT]=res.len;
+  _align(res,_rodata_align);
+  sh_offset[SEC_RODATA]=res.len;
+  res.insert(_rodata.ptr,_rodata.len);
+  sh_offset[SEC_NOTE_GNU_STACK]=res.len;
+  _align(res,addr_size);
+  sh_offset[SEC_SYMTAB]=res.len;
+  res.insert(symtab.ptr,symtab.len);
+  sh_offset[SEC_STRTAB]=res.len;
+  res.insert(strtab.ptr,strtab.len);
+  sh_offset[SEC_SHSTRTAB]=res.len;
+  res.insert(shstrtab.ptr,shstrtab.len);
+  _align(res,addr_size);
+  size_t shoff=res.len;
+
+  _put_section_header(res,_elf_class,0,0,0,0,0,0,0,0,0);
+  _put_section_header(
+    res,_elf_class,sh_name[SEC_TEXT],SHT_PROGBITS,SHF_ALLOC|SHF_EXECINSTR,
+    sh_offset[SEC_TEXT],0,0,0,2,0);
+  _put_section_header(
+    res,_elf_class,sh_name[SEC_RODATA],SHT_PROGBITS,SHF_ALLOC,
+    sh_offset[SEC_RODATA],_rodata.len,0,0,_rodata_align,0);
+  _put_section_header(
+    res,_elf_class,sh_name[SEC_NOTE_GNU_STACK],SHT_PROGBITS,0,
+    sh_offset[SEC_NOTE_GNU_STACK],0,0,0,1,0);
+  _put_section_header(
+    res,_elf_class,sh_name[SEC_SYMTAB],SHT_SYMTAB,0,
+    sh_offset[SEC_SYMTAB],symtab.len,SEC_STRTAB,NUM_LOCAL_SYMBOLS,
+    addr_size,symentsize);
+  _put_section_header(
+    res,_elf_class,sh_name[SEC_STRTAB],SHT_STRTAB,0,
+    sh_offset[SEC_STRTAB],strtab.len,0,0,1,0);
+  _put_section_header(
+    res,_elf_class,sh_name[SEC_SHSTRTAB],SHT_STRTAB,0,
+    sh_offset[SEC_SHSTRTAB],shstrtab.len,0,0,1,0);
+
+  // ELF header
+  alp::array_t<uint8_t> hdr;
+  uint8_t ident[16]={
+    0x7f,'E','L','F',
+    (uint8_t)((_elf_class==64) ? 2 : 1), // class
+    1, // little endian
+    1, // version
+    0  // System V ABI, padding
+  };
+  hdr.insert(ident,16);
+  _put(hdr,1,2); // relocatable
+  _put(hdr,EM_RISCV,2);
+  _put(hdr,1,4); // version
+  _put_addr(hdr,0,_elf_class); // entry
+  _put_addr(hdr,0,_elf_class); // program headers
+  _put_addr(hdr,shoff,_elf_class);
+  _put(hdr,_flags,4);
+  _put(hdr,ehsize,2);
+  _put(hdr,0,2); // program header entry size
+  _put(hdr,0,2); // number of program headers
+  _put(hdr,shentsize,2);
+  _put(hdr,NUM_SECTIONS,2);
+  _put(hdr,SEC_SHSTRTAB,2);
+  assert(hdr.len==ehsize);
+  memcpy(res.ptr,hdr.ptr,ehsize);
+}
+
+void ElfWriter::save(const char *fn) const {
+  alp::array_t<uint8_t> data;
+  FILE *f;
+  generate(data);
+
+  f=fopen(fn,"wb");
+  if (!f) throw FileIOException(fn);
+
+  if (fwrite(data.ptr,1,data.len,f)<data.len) {
+    fclose(f);
+    throw FileIOException(fn);
+  }
+
+  fclose(f);
+}
+
+unittest(
+  /*
+    testing:
+      ElfWriter::generate
+  */
+  const uint64_t words[3]={ 0x1122334455667788uL, 0, ~0uL };
+  alp::array_t<uint8_t> obj;
+
+  ElfWriter elf64(64);
+  elf64.addArray("lut",words,3,64);
+  elf64.generate(obj);
+  Assertf(
+    (obj.len>64) && (memcmp(obj.ptr,"\x7f" "ELF\x02\x01\x01",7)==0) &&
+    (obj[18]==243),
+    "unexpected ELF64 header");
+  // e_flags: lp64d with compressed instructions
+  Assertf(
+    (obj[48]==0x5) && (obj[49]==0) && (obj[50]==0) && (obj[51]==0),
+    "unexpected ELF64 flags %02x",obj[48]);
+  // .rodata follows the header, aligned
+  Assertf(
+    (obj[64]==0x88) && (obj[71]==0x11) && (obj[87]==0xff),
+    "unexpected ELF64 .rodata");
+
+  ElfWriter elf32(32);
+  elf32.addArray("lut",words,3,32);
+  elf32.generate(obj);
+  Assertf(
+    (obj.len>52) && (obj[4]==1) && (obj[40]==52) && (obj[46]==40),
+    "unexpected ELF32 header");
+  // e_flags: soft-float ilp32 with compressed instructions
+  Assertf(
+    (obj[36]==0x1) && (obj[37]==0) && (obj[38]==0) && (obj[39]==0),
+    "unexpected ELF32 flags %02x",obj[36]);
+  Assertf(
+    (obj[52]==0x88) && (obj[55]==0x55) && (obj[56]==0),
+    "unexpected ELF32 .rodata");
+
+  uint32_t flags;
+  Assertf(
+    ElfWriter::AbiFlags("ilp32d",32,flags) && 
+    (flags==(ElfWriter::EF_RISCV_RVC|ElfWriter::EF_RISCV_FLOAT_ABI_DOUBLE)),
+    "unexpected flags of ilp32d");
+  Assertf(
+    !ElfWriter::AbiFlags("lp64d",32,flags) && 
+    !ElfWriter::AbiFlags("foo",64,flags),
+    "expected invalid ABIs to be rejected");
+  ElfWriter elf32d(32,"lut.c",flags);
+  elf32d.addArray("lut",words,3,32);
+  elf32d.generate(obj);
+  Assertf(obj[36]==0x5, "unexpected ELF32 flags %02x",obj[36]);
+);
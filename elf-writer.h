@@ -0,0 +1,103 @@
+/** \file elf-writer.h
+  * \brief Generation of relocatable ELF objects holding LUT configurations.
+  */
+#ifndef RISCV_LUT_COMPULER_ELF_WRITER_H
+#define RISCV_LUT_COMPULER_ELF_WRITER_H
+
+#include "error.h"
+
+#include <alpha/alpha.h>
+#include <stdint.h>
+#include <assert.h>
+#include <string>
+#include <vector>
+
+/** Writer for RISC-V relocatable ELF objects holding constant data.
+  *
+  * Produces the object the target compiler generates from a C file
+  * defining constant arrays only: each array becomes a global object symbol
+  * in .rodata, together with an empty .text section, the .note.GNU-stack
+  * marker and a file symbol naming the C source. As the data contains no
+  * addresses, no relocations are required.
+  *
+  * Objects are little endian, in 32 or 64-bit ELF class. The header flags
+  * select the RISC-V ABI the object may be linked with. As the data 
+  * contains no code, only the floating-point ABI matters: the linker 
+  * refuses to mix objects of different ones. By default, these are the 
+  * flags gcc uses for its default ABI of the class, lp64d for rv64gc and 
+  * ilp32 for soft-float rv32imac, both with compressed instructions.
+  */
+class ElfWriter {
+  public:
+    enum {
+      EM_RISCV = 243,
+      EF_RISCV_RVC = 0x1,
+      EF_RISCV_FLOAT_ABI_SOFT = 0x0,
+      EF_RISCV_FLOAT_ABI_SINGLE = 0x2,
+      EF_RISCV_FLOAT_ABI_DOUBLE = 0x4,
+      EF_RISCV_RVE = 0x8
+    };
+
+  protected:
+    struct symbol_t {
+      std::string name;
+      size_t offset;
+      size_t size;
+    };
+
+    int _elf_class;
+    uint32_t _flags;
+    std::string _source;
+    std::vector<symbol_t> _symbols;
+    alp::array_t<uint8_t> _rodata;
+    size_t _rodata_align;
+
+  public:
+    /** Constructor.
+      *
+      * \param elf_class 32 or 64, the ELF class of the object
+      * \param source Name of the file symbol, i.e. the source file the
+      * object is pretended to have been compiled from.
+      * \param flags Header flags, see AbiFlags.
+      */
+    ElfWriter(int elf_class, const char *source, uint32_t flags);
+    /** Constructor, using the DefaultFlags of elf_class. */
+    ElfWriter(int elf_class=64, const char *source="lut.c") :
+      ElfWriter(elf_class,source,DefaultFlags(elf_class)) {
+      
+    }
+
+    /** Returns the header flags of the default ABI of an ELF class, lp64d
+      * for 64 and ilp32 for 32, with compressed instructions.
+      */
+    static uint32_t DefaultFlags(int elf_class) {
+      return EF_RISCV_RVC | 
+        ((elf_class==64) ? EF_RISCV_FLOAT_ABI_DOUBLE : EF_RISCV_FLOAT_ABI_SOFT);
+    }
+
+    /** Computes the header flags of an ABI given by its gcc name (-mabi),
+      * e.g. ilp32d, with compressed instructions.
+      *
+      * \return false if abi is unknown or does not belong to elf_class.
+      */
+    static bool AbiFlags(const char *abi, int elf_class, uint32_t &flags);
+
+    /** Adds a constant array of n words to .rodata as a global symbol.
+      *
+      * \param word_size Bits per word, 32 or 64. Each word is stored in this
+      * many bits, little endian.
+      */
+    void addArray(
+      const char *name, const uint64_t *words, size_t n, int word_size);
+
+    /** Generates the object file. */
+    void generate(alp::array_t<uint8_t> &res) const;
+
+    /** Writes the object file.
+      *
+      * \throw FileIOException The file could not be written to.
+      */
+    void save(const char *fn) const;
+};
+
+#endif
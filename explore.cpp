@@ -0,0 +1,313 @@
+#include "explore.h"
+#include "bitstream.h"
+#include <algorithm>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+/** Parameters which may be explored */
+static const DesignSpace::range_t _parameters[]={
+  { &arch_config_t::segmentBits, "segmentBits", 0, 0, 0 },
+  { &arch_config_t::selectorBits, "selectorBits", 0, 0, 0 },
+  { &arch_config_t::interpolationBits, "interpolationBits", 0, 0, 0 },
+  { &arch_config_t::plaInterconnects, "plaInterconnects", 0, 0, 0 },
+  { &arch_config_t::base_bits, "base_bits", 0, 0, 0 },
+  { &arch_config_t::incline_bits, "incline_bits", 0, 0, 0 }
+};
+
+/** Parses a positive number at s, advancing s past it */
+static bool _parse_number(const char *&s, int &res) {
+  char *e;
+  long v=strtol(s,&e,10);
+  if ((e==s) || (v<1) || (v>(1<<20))) return false;
+  s=e;
+  res=(int)v;
+  return true;
+}
+
+static int64_t _sign_extend(uint64_t v, int bits) {
+  if ((bits<1) || (bits>=64)) return (int64_t)v;
+  uint64_t m=1uL<<(bits-1);
+  v&=(1uL<<bits)-1;
+  return (int64_t)((v^m)-m);
+}
+
+bool DesignSpace::parse(const char *spec, alp::string &error) {
+  _ranges.clear();
+
+  for(const char *s=spec;*s;) {
+    const char *e=strchr(s,'=');
+    if (!e) {
+      error=alp::string::Format("'=' expected in design space at '%s'",s);
+      return false;
+    }
+
+    range_t r;
+    size_t i;
+    for(i=0;i<sizeof(_parameters)/sizeof(_parameters[0]);i++) {
+      if ((strlen(_parameters[i].name)==(size_t)(e-s)) &&
+          !strncmp(_parameters[i].name,s,e-s))
+        break;
+    }
+    if (i==sizeof(_parameters)/sizeof(_parameters[0])) {
+      error=alp::string::Format(
+        "unknown design space parameter '%s'",
+        alp::string(s,(size_t)(e-s)).ptr);
+      return false;
+    }
+    r=_parameters[i];
+    for(i=0;i<_ranges.size();i++) {
+      if (_ranges[i].field==r.field) {
+        error=alp::string::Format(
+          "design space parameter '%s' given twice",r.name);
+        return false;
+      }
+    }
+
+    s=e+1;
+    bool ok=_parse_number(s,r.first);
+    r.last=r.first;
+    r.step=1;
+    if (ok && (*s==':')) ok=_parse_number(++s,r.last);
+    if (ok && (*s==':')) ok=_parse_number(++s,r.step);
+    if (!ok || ((*s!=',') && (*s!=0)) || (r.last<r.first)) {
+      error=alp::string::Format(
+        "invalid range of design space parameter '%s', "
+        "<first>[:<last>[:<step>]] of positive numbers expected",r.name);
+      return false;
+    }
+    if ((r.field!=&arch_config_t::plaInterconnects) && (r.last>64)) {
+      error=alp::string::Format(
+        "design space parameter '%s' must not exceed 64",r.name);
+      return false;
+    }
+    _ranges.push_back(r);
+    if (*s==',') s++;
+  }
+  return true;
+}
+
+void DesignSpace::enumerate(
+  const arch_config_t &base, std::vector<design_point_t> &res) const {
+  std::vector<int> values(_ranges.size());
+  design_point_t p;
+  bool segment_bits=false;
+
+  res.clear();
+  for(size_t i=0;i<_ranges.size();i++) {
+    values[i]=_ranges[i].first;
+    if (_ranges[i].field==&arch_config_t::segmentBits) segment_bits=true;
+  }
+  for(;;) {
+    p.arch=base;
+    for(size_t i=0;i<_ranges.size();i++) p.arch.*_ranges[i].field=values[i];
+    // the RAM holds a record for every segment address explored, otherwise
+    // its size is that of the base architecture
+    if (segment_bits) p.arch.numSegments=1<<p.arch.segmentBits;
+    p.cost=Cost(p.arch);
+    res.push_back(p);
+
+    size_t i;
+    for(i=0;i<_ranges.size();i++) {
+      values[i]+=_ranges[i].step;
+      if (values[i]<=_ranges[i].last) break;
+      values[i]=_ranges[i].first;
+    }
+    if (i==_ranges.size()) break;
+  }
+
+  std::stable_sort(
+    res.begin(),res.end(),
+    [](const design_point_t &a, const design_point_t &b) {
+      return a.cost<b.cost;
+    });
+}
+
+uint64_t DesignSpace::Cost(const arch_config_t &arch) {
+  BitstreamLayout layout(arch);
+  uint64_t res=0;
+  for(int i=0;i<BitstreamLayout::NUM_SECTIONS;i++) {
+    const BitstreamLayout::section_t &s=
+      layout.section((BitstreamLayout::section_id_t)i);
+    res+=(uint64_t)s.lines*s.bits;
+  }
+  return res;
+}
+
+void DesignSpace::Evaluate(
+  LookupTable &lut, WeightsTable *weights, design_point_t &res) {
+  const arch_config_t &arch=lut.arch();
+  int ib=lut.segment_interpolation_bits();
+  seg_data_t x_raw,y_raw,weight_raw;
+  double sum_e=0, sum_w=0;
+
+  // restrict evaluation to the domain, like min-error does
+  if (weights==NULL) weights=new WeightsTable(lut.bounds());
+  weights->grab();
+
+  res.max_error=0;
+  for(size_t i=0;i<lut.segments().len;i++) {
+    const segment_t &seg=lut.segments()[i];
+    uint64_t base,incline;
+    LookupTable::RamRecord(arch,seg,base,incline);
+    int64_t b=_sign_extend(base,arch.base_bits);
+    int64_t m=_sign_extend(incline,arch.incline_bits);
+
+    uint64_t point_count=((uint64_t)seg.width)<<ib;
+    for(uint64_t x=0;x<point_count;x++) {
+      lut.hardwareToInputSpace(seg,x,x_raw);
+      weights->evaluate(x_raw,weight_raw);
+      double w=(double)weight_raw;
+      if (!(w>0)) continue;
+
+      // address of the point in units of the interpolation bits of the
+      // architecture, like the RAM records
+      uint64_t addr=
+        (((uint64_t)seg.prefix)<<arch.interpolationBits)+
+        (x<<(arch.interpolationBits-ib));
+      lut.evaluate(seg,x,y_raw);
+      double e=fabs((double)(b+m*(int64_t)addr)-(double)y_raw);
+
+      if (e>res.max_error) res.max_error=e;
+      sum_e+=e*w;
+      sum_w+=w;
+    }
+  }
+  res.mean_error=(sum_w>0) ? sum_e/sum_w : 0;
+  weights->drop();
+}
+
+void DesignSpace::ParetoFront(
+  const std::vector<design_point_t> &points, std::vector<size_t> &res) {
+  res.clear();
+  for(size_t i=0;i<points.size();i++) {
+    if (points[i].state!=design_point_t::Feasible) continue;
+    bool dominated=false;
+    for(size_t j=0;(j<points.size()) && !dominated;j++) {
+      dominated=
+        (points[j].state==design_point_t::Feasible) &&
+        points[j].dominates(points[i]);
+    }
+    if (!dominated) res.push_back(i);
+  }
+  std::stable_sort(
+    res.begin(),res.end(),
+    [&points](size_t a, size_t b) { return points[a].cost<points[b].cost; });
+}
+
+void DesignSpace::SaveFront(
+  FILE *f, const char *name, const std::vector<design_point_t> &points) {
+  std::vector<size_t> front;
+  ParetoFront(points,front);
+
+  fprintf(f,"# pareto front of %s\n",name);
+  fprintf(
+    f,"# %10s %12s %12s %12s %12s %12s %12s %14s %14s\n",
+    "cost","segmentBits","selectorBits","interpBits","plaInterc",
+    "base_bits","incline_bits","max_error","mean_error");
+  for(size_t i=0;i<front.size();i++) {
+    const design_point_t &p=points[front[i]];
+    fprintf(
+      f,"  %10lu %12i %12i %12i %12i %12i %12i %14g %14g\n",
+      (unsigned long)p.cost,p.arch.segmentBits,p.arch.selectorBits,
+      p.arch.interpolationBits,p.arch.plaInterconnects,p.arch.base_bits,
+      p.arch.incline_bits,p.max_error,p.mean_error);
+  }
+}
+
+unittest(
+  /*
+    testing:
+      DesignSpace::parse
+      DesignSpace::enumerate
+      DesignSpace::ParetoFront
+  */
+  DesignSpace ds;
+  alp::string error;
+  Assertf(!ds.parse("segmentBits",error), "expected missing '=' to fail");
+  Assertf(!ds.parse("foo=3",error), "expected unknown parameter to fail");
+  Assertf(!ds.parse("segmentBits=5:3",error), "expected empty range to fail");
+  Assertf(
+    !ds.parse("segmentBits=3,segmentBits=4",error),
+    "expected duplicate parameter to fail");
+  Assertf(
+    ds.parse("segmentBits=3:4,plaInterconnects=16:64:16",error),
+    "unexpected error: %s",error.ptr);
+
+  arch_config_t base;
+  std::vector<design_point_t> points;
+  ds.enumerate(base,points);
+  Assertf(points.size()==8, "expected 8 points, got %zu",points.size());
+  for(size_t i=1;i<points.size();i++)
+    Assertf(points[i-1].cost<=points[i].cost, "points not ordered by cost");
+  Assertf(
+    points[0].arch.segmentBits==3 && points[0].arch.plaInterconnects==16 &&
+    points[0].arch.numSegments==8,
+    "expected the smallest architecture first");
+
+  // the RAM size is kept unless segment addresses are explored
+  Assertf(ds.parse("plaInterconnects=16:32:16",error), "unexpected error");
+  base.numSegments=5;
+  ds.enumerate(base,points);
+  Assertf(
+    points.size()==2 && 
+    points[0].arch.numSegments==5 && points[1].arch.numSegments==5,
+    "expected numSegments of the base architecture");
+
+  // cost, max and mean error of feasible points
+  const double p[][3]={
+    { 10, 5, 2 }, { 20, 5, 2 }, { 20, 3, 3 }, { 30, 1, 1 }, { 5, 9, 9 }
+  };
+  points.resize(6);
+  for(size_t i=0;i<5;i++) {
+    points[i].cost=p[i][0];
+    points[i].max_error=p[i][1];
+    points[i].mean_error=p[i][2];
+    points[i].state=design_point_t::Feasible;
+  }
+  points[5].cost=1;
+  points[5].state=design_point_t::Infeasible;
+
+  std::vector<size_t> front;
+  DesignSpace::ParetoFront(points,front);
+  Assertf(front.size()==4, "expected 4 points on the front, got %zu",
+    front.size());
+  Assertf(
+    front[0]==4 && front[1]==0 && front[2]==2 && front[3]==3,
+    "unexpected front");
+);
+
+unittest(
+  /*
+    testing:
+      DesignSpace::Evaluate
+  */
+  options_t opts;
+  opts.arch.selectorBits=4;
+  opts.arch.interpolationBits=6;
+
+  // 16 atomic segments of 64 points, hardware addresses are input values
+  LookupTable lut(opts);
+  const char *input=
+    "name=\"test\" bounds=\"(0,1023)\" "
+    "segments=\"uniform\" approximation=\"linear\" "
+    "\n%%\n"
+    "target int->int\n"
+    "\n%%\n"
+    "int target(int a) { return 2*a+3; }\n"
+    ;
+  lut.parseInput(input,strlen(input),"test lut");
+  lut.computeSegmentSpace();
+
+  // exact in the lower half, off by 5 in the upper one
+  lut.addSegment(
+    segment_t(0,8,seg_data_t((int64_t)3),seg_data_t((int64_t)1027)),false);
+  lut.addSegment(
+    segment_t(8,8,seg_data_t((int64_t)1032),seg_data_t((int64_t)2056)),false);
+
+  design_point_t p;
+  DesignSpace::Evaluate(lut,NULL,p);
+  Assertf(p.max_error==5, "expected a maximum error of 5, got %g",p.max_error);
+  Assertf(
+    p.mean_error==2.5, "expected a mean error of 2.5, got %g",p.mean_error);
+);
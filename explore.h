@@ -0,0 +1,135 @@
+/** \file explore.h
+  * \brief Design-space exploration of architecture parameters.
+  */
+#ifndef RISCV_LUT_COMPULER_EXPLORE_H
+#define RISCV_LUT_COMPULER_EXPLORE_H
+
+#include "error.h"
+#include "arch-config.h"
+#include "lut.h"
+#include "weights.h"
+
+#include <alpha/alpha.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <vector>
+
+/** Result of compiling a LUT for one architecture of a design space */
+struct design_point_t {
+  enum state_t {
+    /** Not compiled yet */
+    Pending=0,
+    /** Compiled and fits the architecture */
+    Feasible,
+    /** Does not fit the architecture, e.g. needs too many PLA
+      * interconnects
+      */
+    Infeasible,
+    /** Not translated as it is dominated by a feasible point */
+    Pruned,
+    /** Compilation failed for other reasons */
+    Failed
+  };
+
+  arch_config_t arch;
+  /** Hardware cost of arch, see DesignSpace::Cost */
+  uint64_t cost;
+  /** Maximum absolute error of the output of the LUT hardware */
+  double max_error;
+  /** Mean absolute error of the output of the LUT hardware, weighted by
+    * the weights table of the LUT
+    */
+  double mean_error;
+  state_t state;
+
+  design_point_t() :
+    cost(0), max_error(0), mean_error(0), state(Pending) {
+
+  }
+
+  /** Returns true iff this point is at least as good as p in cost and both
+    * errors, and better in at least one of them.
+    */
+  bool dominates(const design_point_t &p) const {
+    return
+      (cost<=p.cost) && (max_error<=p.max_error) &&
+      (mean_error<=p.mean_error) &&
+      ((cost<p.cost) || (max_error<p.max_error) ||
+       (mean_error<p.mean_error));
+  }
+};
+
+/** Set of architectures to compile LUTs for, given by ranges of values of
+  * the parameters sizing the LUT core.
+  *
+  * Ranges are given as a comma-separated list of <name>=<first>[:<last>
+  * [:<step>]], e.g. "segmentBits=3:5,plaInterconnects=16:64:16", name being
+  * one of segmentBits, selectorBits, interpolationBits, plaInterconnects,
+  * base_bits and incline_bits. Parameters without a range keep the value
+  * of the base architecture. So does the number of RAM records, unless
+  * segmentBits has a range: then there is one for every segment address.
+  */
+class DesignSpace {
+  public:
+    /** Values of one parameter */
+    struct range_t {
+      int arch_config_t::*field;
+      const char *name;
+      int first;
+      int last;
+      int step;
+    };
+
+  protected:
+    std::vector<range_t> _ranges;
+
+  public:
+    /** Parses ranges, replacing those given before.
+      *
+      * \param error Receives a description of the problem if the ranges
+      * are invalid.
+      * \return true iff the ranges are valid.
+      */
+    bool parse(const char *spec, alp::string &error);
+
+    const std::vector<range_t> &ranges() const { return _ranges; }
+
+    /** Returns all architectures of the design space, base providing the
+      * parameters without a range, by ascending cost.
+      */
+    void enumerate(
+      const arch_config_t &base, std::vector<design_point_t> &res) const;
+
+    /** Returns the hardware cost of an architecture, estimated by the
+      * number of bits of its configuration: the RAM records, the PLA planes
+      * and the connection plane.
+      */
+    static uint64_t Cost(const arch_config_t &arch);
+
+    /** Computes the error of the output of the LUT hardware configured
+      * for lut, whose segments are approximated already.
+      *
+      * Every point of the segments is evaluated the way the hardware does,
+      * from the RAM records truncated to the base and incline bits of the
+      * architecture. Points outside the domain of the LUT or of weight 0
+      * are not taken into account.
+      *
+      * \param weights Weights table of lut, none if NULL.
+      */
+    static void Evaluate(
+      LookupTable &lut, WeightsTable *weights, design_point_t &res);
+
+    /** Returns the indices of the feasible points not dominated by any
+      * other feasible point, by ascending cost.
+      */
+    static void ParetoFront(
+      const std::vector<design_point_t> &points, std::vector<size_t> &res);
+
+    /** Writes the Pareto front of points to f as a table, one point per
+      * line.
+      */
+    static void SaveFront(
+      FILE *f, const char *name, const std::vector<design_point_t> &points);
+};
+
+#endif
@@ -0,0 +1,145 @@
+#include "lut-bundle.h"
+#include "elf-writer.h"
+#include <string.h>
+#include <assert.h>
+#include <algorithm>
+
+LookupTableBundle::LookupTableBundle(const char *name) :
+  _name(name), _word_size(0), _n_input_words(0) {
+
+}
+
+LookupTableBundle::~LookupTableBundle() {
+  for(size_t i=0;i<_entries.len;i++) delete _entries[i];
+}
+
+size_t LookupTableBundle::_place(const uint64_t *words, size_t n) {
+  if (n==0) return 0;
+
+  const uint64_t *begin=_pool.ptr, *end=_pool.ptr+_pool.len;
+  const uint64_t *p=std::search(begin,end,words,words+n);
+  if ((_pool.len>0) && (p!=end)) return p-begin;
+
+  // reuse the longest tail of the pool the words start with
+  size_t k=std::min(n-1,(size_t)_pool.len);
+  for(;k>0;k--)
+    if (memcmp(end-k,words,k*sizeof(uint64_t))==0) break;
+
+  size_t res=_pool.len-k;
+  _pool.insert((uint64_t*)words+k,n-k);
+  return res;
+}
+
+void LookupTableBundle::add(
+  const char *ident, const arch_config_t &arch,
+  const alp::array_t<uint64_t> &words) {
+  BitstreamLayout layout(arch);
+
+  for(size_t i=0;i<_entries.len;i++)
+    if (_entries[i]->ident==ident)
+      throw RuntimeError(alp::string::Format(
+        "LUT identifier %s is not unique",ident));
+  if ((_entries.len>0) && (arch.wordSize!=_word_size))
+    throw RuntimeError(alp::string::Format(
+      "word size of LUT %s differs from previous LUTs",ident));
+  if (words.len!=layout.nWords())
+    throw RuntimeError(alp::string::Format(
+      "bitstream of LUT %s does not match the architecture",ident));
+
+  _word_size=arch.wordSize;
+  entry_t *e=new entry_t;
+  e->ident=ident;
+  for(int s=0;s<BitstreamLayout::NUM_SECTIONS;s++) {
+    const BitstreamLayout::section_t &sec=
+      layout.section((BitstreamLayout::section_id_t)s);
+    e->count[s]=sec.lines*sec.stride;
+    e->offset[s]=_place(words.ptr+sec.first,e->count[s]);
+  }
+  _entries.insert(e);
+  _n_input_words+=words.len;
+}
+
+void LookupTableBundle::_descriptor(const entry_t &e, uint64_t *res) const {
+  for(int s=0;s<BitstreamLayout::NUM_SECTIONS;s++) {
+    res[2*s]=e.offset[s];
+    res[2*s+1]=e.count[s];
+  }
+}
+
+void LookupTableBundle::writeOutputFormat(OutputStream &out) const {
+  uint64_t desc[DescriptorWords];
+
+  assert((_entries.len>0) && "empty bundle");
+  out.puts("#include <stdint.h>\n");
+  out.puts("/* ");
+  out.putDecimal(_entries.len);
+  out.puts(" LUTs, ");
+  out.putDecimal(_pool.len);
+  out.puts(" pooled words of ");
+  out.putDecimal(_n_input_words);
+  out.puts(
+    ". Each descriptor holds the pool offset and\n"
+    "   word count of the RAM, PLA OR plane, PLA AND plane and connection\n"
+    "   plane sections of a bitstream. */\n");
+  BitstreamWriter::CArray(
+    out,(_name+"_pool").ptr,_pool.ptr,_pool.len,_word_size);
+  for(size_t i=0;i<_entries.len;i++) {
+    _descriptor(*_entries[i],desc);
+    BitstreamWriter::CArray(
+      out,(_entries[i]->ident+"_desc").ptr,desc,DescriptorWords,_word_size);
+  }
+}
+
+void LookupTableBundle::saveOutputFile(const char *fn) const {
+  OutputStream out(fn);
+  writeOutputFormat(out);
+  out.close();
+}
+
+void LookupTableBundle::saveOutputObjectFile(
+  const char *fn, int elf_class, uint32_t elf_flags) const {
+  uint64_t desc[DescriptorWords];
+  ElfWriter elf(elf_class,"lut.c",elf_flags);
+
+  assert((_entries.len>0) && "empty bundle");
+  elf.addArray((_name+"_pool").ptr,_pool.ptr,_pool.len,_word_size);
+  for(size_t i=0;i<_entries.len;i++) {
+    _descriptor(*_entries[i],desc);
+    elf.addArray(
+      (_entries[i]->ident+"_desc").ptr,desc,DescriptorWords,_word_size);
+  }
+  elf.save(fn);
+}
+
+unittest(
+  /*
+    testing:
+      LookupTableBundle::add
+  */
+  arch_config_t arch;
+  BitstreamLayout layout(arch);
+  alp::array_t<uint64_t> a,b;
+  const BitstreamLayout::section_t &ram=layout.section(BitstreamLayout::RAM);
+
+  a.setlen(layout.nWords());
+  for(size_t i=0;i<a.len;i++) a[i]=i;
+  b.insert(a.ptr,a.len);
+  b[ram.first]=~0uL;
+
+  LookupTableBundle bundle("luts");
+  bundle.add("a",arch,a);
+  bundle.add("b",arch,b);
+  // only the RAM section of b differs, its chain registers are shared
+  Assertf(
+    bundle.nPoolWords()==a.len+ram.lines*ram.stride,
+    "unexpected pool size %lu", bundle.nPoolWords());
+  Assertf(bundle.nInputWords()==2*a.len, "unexpected input size");
+
+  bool unique=false;
+  try {
+    bundle.add("a",arch,b);
+  } catch(RuntimeError &e) {
+    unique=true;
+  }
+  Assertf(unique, "duplicate identifier accepted");
+);
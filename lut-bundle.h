@@ -0,0 +1,108 @@
+/** \file lut-bundle.h
+  * \brief Combined output of multiple LUT configurations.
+  */
+#ifndef RISCV_LUT_COMPULER_LUT_BUNDLE_H
+#define RISCV_LUT_COMPULER_LUT_BUNDLE_H
+
+#include "lut.h"
+#include "bitstream.h"
+#include "output-stream.h"
+
+#include <alpha/alpha.h>
+#include <stdint.h>
+
+/** Configurations of multiple LUTs, output together in a single unit.
+  *
+  * The bitstreams of all LUTs are split into their sections and stored in a
+  * common pool of words. A section identical to a sequence already in the
+  * pool is not stored again but refers to that sequence, and a section
+  * starting with the words the pool ends with is only appended by its
+  * remaining words. LUTs of the same architecture and segment layout
+  * typically share their chain registers this way.
+  *
+  * Each LUT is described by an array of words named after its identifier
+  * with a _desc suffix, holding the pool offset and the number of words of
+  * each of its sections in the order they are stored in the bitstream (see
+  * BitstreamLayout). Concatenating these ranges of the pool yields the
+  * bitstream of the LUT.
+  */
+class LookupTableBundle {
+  protected:
+    struct entry_t {
+      alp::string ident;
+      size_t offset[BitstreamLayout::NUM_SECTIONS];
+      size_t count[BitstreamLayout::NUM_SECTIONS];
+    };
+
+    alp::string _name;
+    int _word_size;
+    alp::array_t<uint64_t> _pool;
+    alp::array_t<entry_t*> _entries;
+    size_t _n_input_words;
+
+    /** Stores n words in the pool, returning their offset */
+    size_t _place(const uint64_t *words, size_t n);
+
+    /** Returns the descriptor words of an entry */
+    void _descriptor(const entry_t &e, uint64_t *res) const;
+
+  public:
+    enum {
+      DescriptorWords = 2*BitstreamLayout::NUM_SECTIONS
+    };
+
+    /** Constructor.
+      *
+      * \param name Prefix of the pool symbol, which is named name_pool.
+      */
+    LookupTableBundle(const char *name);
+    ~LookupTableBundle();
+
+    /** Adds the bitstream of a LUT built for the architecture arch.
+      *
+      * \throw RuntimeError A LUT of the same identifier was added before,
+      * the word size differs from LUTs added before, or words does not hold
+      * a bitstream of arch.
+      */
+    void add(
+      const char *ident, const arch_config_t &arch,
+      const alp::array_t<uint64_t> &words);
+
+    /** Adds a translated LUT.
+      * \see add
+      */
+    void add(const LookupTable &lut) {
+      add(lut.ident().ptr,lut.arch(),lut.config_words());
+    }
+
+    size_t size() const { return _entries.len; }
+    /** Returns the number of words in the pool */
+    size_t nPoolWords() const { return _pool.len; }
+    /** Returns the number of words of all bitstreams added */
+    size_t nInputWords() const { return _n_input_words; }
+
+    /** Writes C code defining the pool and the descriptors of all LUTs as
+      * constant arrays.
+      */
+    void writeOutputFormat(OutputStream &out) const;
+
+    /** Saves the C code output to a file.
+      *
+      * \throw FileIOException The file could not be written to.
+      */
+    void saveOutputFile(const char *fn) const;
+
+    /** Saves the pool and the descriptors of all LUTs as a RISC-V
+      * relocatable ELF object, just like compiling the output of
+      * writeOutputFormat.
+      *
+      * \param elf_class ELF class of the object, 32 or 64.
+      * \param elf_flags ELF header flags selecting the ABI, see
+      * ElfWriter::AbiFlags.
+      * \throw FileIOException The file could not be written to.
+      */
+    void saveOutputObjectFile(
+      const char *fn, int elf_class, uint32_t elf_flags) const;
+};
+
+#endif
@@ -1,5 +1,13 @@
 #include "lut.h"
 #include "qmc2.h"
+#include "pla-cache.h"
+#include "bitstream.h"
+#include "elf-writer.h"
+#include "output-stream.h"
+#include "disassembler.h"
+#include "target-cache.h"
+#include "stats.h"
+#include <math.h>
 
 #undef yyFlexLexer
 #define yyFlexLexer BaseInputFlexLexer
@@ -24,6 +32,10 @@
 
 LookupTable::LookupTable() :
   _cmdCompileSO(options_t::Default_cmdCompileSO()),
+  _pla_exact_max_inputs(options_t::Default_plaExactMaxInputs),
+  _pla_cover_time_limit(options_t::Default_plaCoverTimeLimit),
+  _pla_slot_search(false),
+  _deterministic(false),
   _num_segments(arch_config_t::Default_numSegments),
   _num_primary_segments(arch_config_t::Default_numSegments),
   _strategy1(segment_strategy::INVALID),
@@ -37,6 +49,10 @@ LookupTable::LookupTable() :
 }
 LookupTable::LookupTable(const arch_config_t &cfg) :
   _cmdCompileSO(options_t::Default_cmdCompileSO()),
+  _pla_exact_max_inputs(options_t::Default_plaExactMaxInputs),
+  _pla_cover_time_limit(options_t::Default_plaCoverTimeLimit),
+  _pla_slot_search(false),
+  _deterministic(false),
   _arch(cfg),
   _num_segments(cfg.numSegments),
   _num_primary_segments(cfg.numSegments),
@@ -51,6 +67,12 @@ LookupTable::LookupTable(const arch_config_t &cfg) :
 }
 LookupTable::LookupTable(const options_t &opts) :
   _cmdCompileSO(opts.cmdCompileSO),
+  _pla_exact_max_inputs(opts.plaExactMaxInputs),
+  _pla_cover_time_limit(opts.plaCoverTimeLimit),
+  _pla_slot_search(opts.fPlaSlotSearch),
+  _deterministic(opts.fDeterministic),
+  _pla_cache_dir(opts.plaCacheDir),
+  _target_cache_dir(opts.targetCacheDir),
   _arch(opts.arch),
   _num_segments(opts.arch.numSegments),
   _num_primary_segments(opts.arch.numSegments),
@@ -260,46 +282,58 @@ void LookupTable::parseInput(const char *ptr, size_t cb, const char *name) {
   
   alp::string workdir=tempdir.path();
   alp::string libname=workdir+"target.so";
+  alp::string source;
+  const char *symbol="_Z14compute_targetP10seg_data_tPKS_";
   FILE *f;
   int r;
   
-  f=fopen((workdir+"target.cpp").ptr,"w");
-  
   // seg_data_t definition
-  fprintf(f,"%s",SEG_DATA_DECL);
+  source+=SEG_DATA_DECL;
 
   // target code
-  fwrite(_c_code.ptr,1,_c_code.len,f);
+  source+=_c_code;
 
   /* wrapper code:
     void compute_target(seg_data_t *res, const seg_data_t *arg0 ,...) {
       *res=<target_name>(*arg0,...);
     }
     */
-  fprintf(f,
+  source+=
     "\n"
-    "void compute_target(seg_data_t *res");
+    "void compute_target(seg_data_t *res";
   for(size_t i=0;i<_target_argument_types.len;i++)
-    fprintf(f,", const seg_data_t *arg%lu",i);
-  fprintf(f,
+    source+=alp::string::Format(", const seg_data_t *arg%lu",i);
+  source+=alp::string::Format(
     ") {\n  *res=%s(*arg0",
     _target_name.ptr);
 
-  for(size_t i=1;i<_target_argument_types.len;i++) fprintf(f,",*arg%lu",i);
+  for(size_t i=1;i<_target_argument_types.len;i++) 
+    source+=alp::string::Format(",*arg%lu",i);
 
-  fprintf(f,
-    ");\n}\n");
+  source+=
+    ");\n}\n";
+
+  // reuse the target function if the same code was compiled before
+  TargetCache::key_t key=TargetCache::Key(_cmdCompileSO,source);
+  _target_func=(target_func_t)TargetCache::Lookup(
+    key,_target_cache_dir,symbol);
+  if (_target_func!=NULL) return;
   
+  f=fopen((workdir+"target.cpp").ptr,"w");
+  fwrite(source.ptr,1,source.len,f);
   fclose(f);
 
   // load c code
   
   // fixme: this needs to be tested on windows. mingw-gcc -shared *should*
   // output a DLL so other than the extension it *should* work fine
-  r=system(
-    alp::string::Format(
-      "%s \"%starget.cpp\" -o \"%s\"",
-      _cmdCompileSO.ptr,workdir.ptr,libname.ptr).ptr);
+  {
+    Stats::Timer timer(Stats::TargetCompile);
+    r=system(
+      alp::string::Format(
+        "%s \"%starget.cpp\" -o \"%s\"",
+        _cmdCompileSO.ptr,workdir.ptr,libname.ptr).ptr);
+  }
 
   if (r!=0) 
     throw RuntimeError(
@@ -310,7 +344,7 @@ void LookupTable::parseInput(const char *ptr, size_t cb, const char *name) {
     throw RuntimeError(
       alp::string::Format("unable to load library file <%s>",libname.ptr));
   
-  _target_func=(target_func_t)dlib_lookup(_target_lib,"_Z14compute_targetP10seg_data_tPKS_");
+  _target_func=(target_func_t)dlib_lookup(_target_lib,symbol);
   if (_target_func==NULL) {
     dlib_close(_target_lib);
     _target_lib=NULL;
@@ -319,6 +353,11 @@ void LookupTable::parseInput(const char *ptr, size_t cb, const char *name) {
         "unable to locate target function in library file <%s>",libname.ptr));
   }
 
+  // the cache keeps the library loaded from now on
+  _target_func=(target_func_t)TargetCache::Store(
+    key,_target_cache_dir,_target_lib,(void*)_target_func,libname);
+  _target_lib=NULL;
+
 
 }
 
@@ -509,77 +548,208 @@ void LookupTable::saveIntermediateFile(const char *fn) {
   fclose(f);
 }
 
-void LookupTable::generateOutputFormat(alp::string &res) {
-  res.clear();
-  res+="#include <stdint.h>\n";
-  switch(_arch.wordSize) {
-    case 32:
-      res+=alp::string::Format(
-        "const uint32_t %s[%i]={",
-        _ident.ptr,_config_words.len);
-     
-     if (_config_words.len>0) {
-        res+=alp::string::Format("0x%.8xul",_config_words[0]&0xffffffff);
-        for(size_t i=1;i<_config_words.len;i++) {
-          res+=alp::string::Format(",0x%.8xul",_config_words[i]&0xffffffff);
-        }
-      }
-      break;
-    case 64:
-      res+=alp::string::Format(
-        "const uint64_t %s[%i]={",
-        _ident.ptr,_config_words.len);
-      
-      if (_config_words.len>0) {
-        res+=alp::string::Format("0x%.16llxuL",_config_words[0]);
-        for(size_t i=1;i<_config_words.len;i++) {
-          res+=alp::string::Format(",0x%.16llxuL",_config_words[i]);
-        }
-      }
-      break;
-    default:
-      assert(0 && "unsupported target word size");
+/** Determines the runs of words of cur to write if ref is loaded.
+  *
+  * \return true if the chain registers need to be written.
+  * \throw RuntimeError ref was built for a different architecture.
+  */
+static bool _bitstream_delta(
+  const arch_config_t &arch, const alp::array_t<uint64_t> &ref,
+  const alp::array_t<uint64_t> &cur, 
+  alp::array_t<BitstreamLayout::run_t> &runs) {
+  BitstreamLayout layout(arch);
+  
+  if ((ref.len!=layout.nWords()) || (cur.len!=layout.nWords()))
+    throw RuntimeError(
+      "reference configuration does not match the architecture");
+  return layout.delta(ref,cur,runs);
+}
+
+void LookupTable::writeOutputFormat(OutputStream &out) {
+  out.puts("#include <stdint.h>\n");
+  
+  if (_reference_words.len==0) {
+    BitstreamWriter::CArray(
+      out,_ident.ptr,_config_words.ptr,_config_words.len,_arch.wordSize);
+    return;
+  }
+
+  const char *type=BitstreamWriter::CType(_arch.wordSize);
+  alp::array_t<BitstreamLayout::run_t> runs;
+  bool chain=_bitstream_delta(_arch,_reference_words,_config_words,runs);
+  size_t n=0;
+  for(size_t i=0;i<runs.len;i++) n+=runs[i].count;
+
+  out.puts("/* ");
+  out.putDecimal(n);
+  out.puts(" of ");
+  out.putDecimal(_config_words.len);
+  out.puts(
+    " words differ from the reference configuration, the chain\n"
+    "   registers ");
+  out.puts(chain ? "need to be written" : "are unchanged");
+  out.puts(". */\n");
+
+  out.puts("const ");
+  out.puts(type);
+  out.put(' ');
+  out.puts(_ident.ptr);
+  out.puts("_delta[");
+  out.putDecimal(n+2*runs.len+2);
+  out.puts("]={");
+  for(size_t i=0;i<runs.len;i++) {
+    BitstreamWriter::CWord(out,runs[i].first,_arch.wordSize);
+    out.put(',');
+    BitstreamWriter::CWord(out,runs[i].count,_arch.wordSize);
+    for(size_t j=0;j<runs[i].count;j++) {
+      out.put(',');
+      BitstreamWriter::CWord(
+        out,_config_words[runs[i].first+j],_arch.wordSize);
+    }
+    out.put(',');
   }
+  BitstreamWriter::CWord(out,0,_arch.wordSize);
+  out.put(',');
+  BitstreamWriter::CWord(out,0,_arch.wordSize);
+  out.puts("};\n");
+
+  out.puts(alp::string::Format(
+    "const int %s_delta_chain=%i;\n",_ident.ptr,chain ? 1 : 0).ptr);
+  out.puts(alp::string::Format(
+    "void %s_delta_apply(volatile %s *config) {\n"
+    "  const %s *p;\n"
+    "  for(p=%s_delta;p[1]!=0;p+=2+p[1]) {\n"
+    "    %s i;\n"
+    "    for(i=0;i<p[1];i++) config[p[0]+i]=p[2+i];\n"
+    "  }\n"
+    "}\n",
+    _ident.ptr,type,type,_ident.ptr,type).ptr);
+}
 
-  res+="};\n";
+void LookupTable::generateOutputFormat(alp::string &res) {
+  res.clear();
+  OutputStream out(res);
+  writeOutputFormat(out);
+  out.close();
 }
 
 void LookupTable::saveOutputFile(const char *fn) {
-  alp::string data;
-  FILE *f;
-  generateOutputFormat(data);
+  OutputStream out(fn);
+  writeOutputFormat(out);
+  out.close();
+}
 
-  f=fopen(fn,"wb");
-  if (!f) throw FileIOException(fn);
-  
-  if (fwrite(data.ptr,1,data.len,f)<data.len) {
-    fclose(f);
-    throw FileIOException(fn);
+void LookupTable::writeOutputDumpFormat(OutputStream &out) {
+  if (_reference_words.len==0) {
+    BitstreamWriter::Dump(out,_config_words.ptr,_config_words.len);
+    return;
   }
 
-  fclose(f);
+  alp::array_t<BitstreamLayout::run_t> runs;
+  _bitstream_delta(_arch,_reference_words,_config_words,runs);
+  for(size_t i=0;i<runs.len;i++) {
+    for(size_t j=runs[i].first;j<runs[i].first+runs[i].count;j++) {
+      out.putDecimal(j);
+      out.put(' ');
+      out.putDecimal(_config_words[j]);
+      out.put('\n');
+    }
+  }
 }
 
 void LookupTable::generateOutputDumpFormat(alp::string &res) {
   res.clear();
-  for(size_t i=0;i<_config_words.len;i++)
-    res+=alp::string::Format("%Lu\n",_config_words[i]);
+  OutputStream out(res);
+  writeOutputDumpFormat(out);
+  out.close();
 }
 
 void LookupTable::saveOutputDumpFile(const char *fn) {
-  alp::string data;
-  FILE *f;
-  generateOutputDumpFormat(data);
+  OutputStream out(fn);
+  writeOutputDumpFormat(out);
+  out.close();
+}
 
-  f=fopen(fn,"wb");
+void LookupTable::saveOutputBinaryFile(const char *fn, bool big_endian) {
+  assert((_reference_words.len==0) && "delta output not supported");
+  OutputStream out(fn);
+  BitstreamWriter::Binary(
+    out,_config_words.ptr,_config_words.len,_arch.wordSize,big_endian);
+  out.close();
+}
+
+void LookupTable::saveOutputHexFile(const char *fn) {
+  OutputStream out(fn);
+  IntelHexWriter hex(out);
+
+  if (_reference_words.len==0) {
+    hex.words(0,_config_words.ptr,_config_words.len,_arch.wordSize);
+  } else {
+    alp::array_t<BitstreamLayout::run_t> runs;
+    _bitstream_delta(_arch,_reference_words,_config_words,runs);
+    for(size_t i=0;i<runs.len;i++) {
+      hex.words(
+        runs[i].first,_config_words.ptr+runs[i].first,runs[i].count,
+        _arch.wordSize);
+    }
+  }
+  hex.end();
+  out.close();
+}
+
+void LookupTable::saveOutputObjectFile(
+  const char *fn, int elf_class, uint32_t elf_flags) {
+  assert((_reference_words.len==0) && "delta output requires compilation");
+  ElfWriter elf(elf_class,"lut.c",elf_flags);
+  elf.addArray(_ident.ptr,_config_words.ptr,_config_words.len,_arch.wordSize);
+  elf.save(fn);
+}
+
+void LookupTable::parseReferenceFile(const char *fn) {
+  FILE *f=fopen(fn,"rb");
+  char *buf;
+  size_t cb;
   if (!f) throw FileIOException(fn);
-  
-  if (fwrite(data.ptr,1,data.len,f)<data.len) {
+
+  fseek(f,0,SEEK_END);
+  cb=ftell(f);
+  fseek(f,0,SEEK_SET);
+
+  buf=(char*)malloc(cb+1);
+  if (buf==NULL) {
     fclose(f);
     throw FileIOException(fn);
   }
 
+  if (fread(buf,1,cb,f)<cb) {
+    fclose(f);
+    free((void*)buf);
+    throw FileIOException(fn);
+  }
   fclose(f);
+
+  if (BitstreamDisassembler::ParseDump(buf,cb,_reference_words)) {
+    free((void*)buf);
+    return;
+  }
+
+  // translate the intermediate file just like this LUT
+  LookupTable ref(_arch);
+  ref._pla_exact_max_inputs=_pla_exact_max_inputs;
+  ref._pla_cover_time_limit=_pla_cover_time_limit;
+  ref._pla_slot_search=_pla_slot_search;
+  ref._deterministic=_deterministic;
+  ref._pla_cache_dir=_pla_cache_dir;
+  try {
+    ref.parseIntermediate(buf,cb,fn);
+  } catch(SyntaxError &e) {
+    free((void*)buf);
+    throw e;
+  }
+  free((void*)buf);
+
+  ref.translate();
+  _reference_words.insert(ref._config_words.ptr,ref._config_words.len);
 }
 
 void LookupTable::computeSegmentSpace() {
@@ -963,6 +1133,7 @@ deviation_t LookupTable::computeSegmentError(
 void LookupTable::evaluate(const seg_data_t &arg, seg_data_t &res) {
   // if _target_func is NULL, the caller was not careful enough.
   assert( (_target_func!=NULL) && "Target function was not loaded" );
+  Stats::Count(Stats::TargetEvaluations);
   _target_func(&res,&arg);
 }
 
@@ -1044,258 +1215,474 @@ void LookupTable::print_translation_parameters(){
 }
 
 
-void LookupTable::translate() {
-  assert( _segments.len > 0 && "translate: #of segments not larger than 0");
-
-  QMC qmc(_arch.selectorBits);
-  
-  //print_translation_parameters();
+/** Computes the prime implicants the way QMC::minimize does, dropping 
+  * each new implicant if one in the list covers its inputs and implies all
+  * of its outputs, by scanning the whole list.
+  */
+static void _reference_primes(
+  size_t n_inputs, const uint64_t *outputs, size_t n, 
+  alp::array_t<QMC::implicant_t> &res) {
+  res.clear();
+  for(size_t i=0;i<n;i++) {
+    if (outputs[i]==0) continue;
+    QMC::implicant_t m;
+    m.impl=outputs[i];
+    m.care=(1uL<<n_inputs)-1;
+    m.value=i;
+    m.ones=__builtin_popcountll(m.value);
+    m.color=0;
+    res.insert(m);
+  }
 
-  // Variables of interest during translation
-  const int REG_WIDTH = 64;
-  const uint64_t REG_MASK = 0xffffffffffffffff;
+  bool done=false;
+  while(!done) {
+    done=true;
+    std::stable_sort(
+      res.ptr,res.ptr+res.len,
+      [](const QMC::implicant_t &a, const QMC::implicant_t &b) {
+        return a.ones<b.ones;
+      });
+    size_t i1=res.len;
+    for(size_t i=0;i<i1;i++) {
+      for(size_t j=i+1;(j<i1) && (res[j].ones<=res[i].ones+1);j++) {
+        uint64_t diff=res[i].value^res[j].value;
+        if ((res[i].care!=res[j].care) || ((res[i].impl&res[j].impl)==0) ||
+            (__builtin_popcountll(diff)!=1)) continue;
+        QMC::implicant_t m=res[i];
+        m.impl&=res[j].impl;
+        m.value&=~diff;
+        m.care&=~diff;
+        m.ones=__builtin_popcountll(m.value);
+        m.color=0;
+        
+        bool dominated=false;
+        for(size_t k=0;(k<res.len) && !dominated;k++) 
+          dominated=((res[k].impl&m.impl)==m.impl) && res[k].covers(&m);
+        if (!dominated) { res.insert(m); done=false; }
+        if (res[j].impl==m.impl) { res[j].color=1; done=false; }
+        if (res[i].impl==m.impl) { res[i].color=1; done=false; }
+      }
+    }
+    size_t n_left=0;
+    for(size_t i=0;i<res.len;i++) if (res[i].color!=1) res[n_left++]=res[i];
+    res.setlen(n_left);
+  }
+}
 
-  connection_plane_conf = new char[3*REG_WIDTH*(_arch.selectorBits
-				       +_arch.interpolationBits)];
+#define TEST_QMC_PRIMES(n_inputs,...) { \
+  static const uint64_t outputs[]={ __VA_ARGS__ }; \
+  const size_t n=sizeof(outputs)/sizeof(outputs[0]); \
+  alp::array_t<QMC::implicant_t> expected; \
+  QMC qmc(n_inputs); \
+  for(size_t i=0;i<n;i++) qmc.add_term(i,outputs[i]); \
+  qmc.minimize(); \
+  _reference_primes(n_inputs,outputs,n,expected); \
+  Assertf( \
+    qmc.primes().len==expected.len, \
+    "expected %zu prime implicants, got %zu for %s\n", \
+    expected.len,qmc.primes().len,#__VA_ARGS__); \
+  for(size_t i=0;i<expected.len;i++) { \
+    size_t j; \
+    for(j=0;j<qmc.primes().len;j++) \
+      if ((qmc.primes()[j].value==expected[i].value) && \
+          (qmc.primes()[j].care==expected[i].care) && \
+          (qmc.primes()[j].impl==expected[i].impl)) break; \
+    Assertf( \
+      j<qmc.primes().len, \
+      "missing prime implicant %zu for %s\n",i,#__VA_ARGS__); \
+  } \
+}
+unittest(
+  /*
+    testing:
+      QMC::minimize
+  */
+  // implicants of a cube with a subset of the outputs of another must not
+  // be taken as primes
+  TEST_QMC_PRIMES(2, 3,3,1,1)
+  TEST_QMC_PRIMES(3, 0,0,1,1,1,2,2,2)
+  TEST_QMC_PRIMES(3, 7,3,3,1,5,4,6,7)
+  TEST_QMC_PRIMES(4, 1,2,2,3,3,3,3,4,4,4,4,4,4,4,4,4)
+  TEST_QMC_PRIMES(4, 15,7,3,1,0,9,11,13,6,6,14,12,5,5,7,15)
+  TEST_QMC_PRIMES(5, 
+    4,4,4,4,4,4,4,5,5,2,2,2,2,3,3,0,0,0,0,0,0,0,0,1,1,1,7,7,7,7,7,6)
+)
+#undef TEST_QMC_PRIMES
+
+#define TEST_QMC(n_inputs,method,...) { \
+  static const uint64_t outputs[]={ __VA_ARGS__ }; \
+  QMC qmc(n_inputs); \
+  for(size_t i=0;i<sizeof(outputs)/sizeof(outputs[0]);i++) \
+    qmc.add_term(i,outputs[i]); \
+  qmc.method(); \
+  Assertf( \
+    qmc.verify(), \
+    "QMC::" #method " yielded an invalid cover for %s\n", #__VA_ARGS__); \
+}
+unittest(
+  /*
+    testing:
+      QMC::minimize
+      QMC::minimizeHeuristic
+      QMC::verify
+  */
+  TEST_QMC(3,minimize, 0,0,1,1,1,2,2,2)
+  TEST_QMC(3,minimizeHeuristic, 0,0,1,1,1,2,2,2)
+  TEST_QMC(4,minimize, 1,2,2,3,3,3,3,4,4,4,4,4,4,4,4,4)
+  TEST_QMC(4,minimizeHeuristic, 1,2,2,3,3,3,3,4,4,4,4,4,4,4,4,4)
+  TEST_QMC(5,minimize, 
+    4,4,4,4,4,4,4,5,5,2,2,2,2,3,3,0,0,0,0,0,0,0,0,1,1,1,7,7,7,7,7,6)
+  TEST_QMC(5,minimizeHeuristic, 
+    4,4,4,4,4,4,4,5,5,2,2,2,2,3,3,0,0,0,0,0,0,0,0,1,1,1,7,7,7,7,7,6)
+)
+#undef TEST_QMC
 
-  /* Calculate LUT decoder configuration
-     - calculate *which* bits of the input are used for selection and
-       interpolation.
-     - calculate MinTerms for And plane of PLA
-     - Or plane: naive addresses for now
-   */
-  // 1. connection plane
-  // Connect interpolationBits for Multiply-Add unit
+/** Writes the connection plane, connecting the input bits used for 
+  * interpolation and segment selection to the Multiply-Add unit and the PLA.
+  */
+static void _write_connection_plane(
+  BitstreamImage &img, const arch_config_t &arch, int segment_space_width) {
   // Which LUT input bits are used for interpolation within segments?
   // Counting from MSBs:
   //   The selectorBits and following until a number of interpolationBits
   //   is reached.
-  int interpolate_LSB = _segment_space_width - _arch.interpolationBits-_arch.selectorBits;
-  int interpolate_MSB = _segment_space_width;
-  //printf("interpolateLSB: %i, interpolateMSB: %i\n",
-  //       interpolate_LSB, interpolate_MSB);
-  // Connect selectorBits to PLA via connection plane
-  for( int interpolateBit = 0; interpolateBit<_arch.interpolationBits; 
-       interpolateBit++){
-    for( int registerBit = 0; registerBit<REG_WIDTH*3; registerBit++){
-      if( interpolate_LSB <= registerBit
-          && registerBit < interpolate_MSB  
-          && registerBit - interpolate_LSB == interpolateBit){ // connection
-        //printf("connected: regbit: %i, interpolatebit: %i\n",
-        //        registerBit, interpolateBit);
-        connection_plane_conf[interpolateBit*REG_WIDTH*3+registerBit] = true;
-      }else{ // no connection
-        connection_plane_conf[interpolateBit*REG_WIDTH*3+registerBit] = false;
-      }
-    }
+  // The selectorBits are connected right after, i.e. line i connects to
+  // input bit interpolate_LSB+i.
+  int interpolate_LSB=
+    segment_space_width-arch.interpolationBits-arch.selectorBits;
+  for(int i=0;i<arch.interpolationBits+arch.selectorBits;i++) {
+    int bit=interpolate_LSB+i;
+    if ((bit<0) || (bit>=3*arch.wordSize)) continue;
+    img.set(BitstreamLayout::CONNECTION,i,bit);
   }
-  // Which LUT input bits are used for segment selection?
-  // Counting from LSBs:
-  //   (_segment_space_width-_arch.selectorBits) to _segment_space_width
-  int select_LSB = _segment_space_width - _arch.selectorBits;
-  int select_MSB = _segment_space_width;
-  //printf("selLSB: %i, selMSB: %i\n", select_LSB, select_MSB);
-  int sco = _arch.interpolationBits*REG_WIDTH*3; //segment configuration offset
-  // Connect selectorBits to PLA via connection plane
-  for( int selectorBit = 0; selectorBit<_arch.selectorBits; selectorBit++){
-    for( int registerBit = 0; registerBit<REG_WIDTH*3; registerBit++){ // 3 rs
-      if( select_LSB <= registerBit
-          && registerBit < select_MSB  
-          && registerBit - select_LSB == selectorBit){ // connection
-        //printf("connected: regbit: %i, selbit: %i\n", registerBit, selectorBit);
-        connection_plane_conf[selectorBit*REG_WIDTH*3+registerBit+sco] = true;
-      }else{ // no connection
-        connection_plane_conf[selectorBit*REG_WIDTH*3+registerBit+sco] = false;
+}
+
+/** Writes the RAM record of seg to RAM slot slot */
+static void _write_ram_record(
+  BitstreamImage &img, size_t slot, const arch_config_t &arch,
+  const segment_t &seg) {
+  uint64_t base,incline;
+  LookupTable::RamRecord(arch,seg,base,incline);
+  img.setField(BitstreamLayout::RAM_INCLINE,slot,incline);
+  img.setField(BitstreamLayout::RAM_BASE,slot,base);
+}
+
+/** Estimates the number of PLA implicants needed if segment i is mapped to
+  * RAM slot slots[i].
+  *
+  * For each output bit, runs of adjacent segments setting that bit are split
+  * into aligned power-of-two blocks of selector values, i.e. cubes. Cubes
+  * appearing for several output bits are counted once. This overestimates
+  * what minimization achieves, but is cheap and ranks assignments well 
+  * enough to guide the search.
+  */
+static size_t _estimate_pla_terms(
+  const alp::array_t<segment_t> &segments, const uint32_t *slots,
+  int segment_bits, alp::array_t<uint64_t> &cubes) {
+  cubes.setlen(0);
+  for(int b=0;b<segment_bits;b++) {
+    size_t i=0;
+    while(i<segments.len) {
+      if (((slots[i]>>b)&1)==0) { i++; continue; }
+      uint64_t lo=segments[i].prefix;
+      uint64_t hi=lo+segments[i].width;
+      for(i++;i<segments.len;i++) {
+        if (((slots[i]>>b)&1)==0 || segments[i].prefix!=hi) break;
+        hi+=segments[i].width;
+      }
+      while(lo<hi) {
+        int k=lo ? __builtin_ctzll(lo) : 63;
+        while((1uL<<k)>hi-lo) k--;
+        cubes.insert((lo<<6)|k);
+        lo+=1uL<<k;
       }
     }
   }
+  std::sort(cubes.ptr,cubes.ptr+cubes.len);
+  return std::unique(cubes.ptr,cubes.ptr+cubes.len)-cubes.ptr;
+}
+
+/** Searches for an assignment of segments to RAM slots requiring fewer PLA
+  * implicants, starting from the one given in slots.
+  *
+  * Uses simulated annealing on _estimate_pla_terms, moving one segment to 
+  * another (possibly occupied) slot per step. A fixed seed is used so that
+  * results are reproducible.
+  *
+  * Each step re-estimates the whole assignment rather than updating the 
+  * estimate incrementally for the two segments moved. This costs 
+  * O(segmentBits*segments) per step, which is negligible for the 20000 
+  * steps taken compared to minimizing the PLA.
+  */
+static void _search_pla_slots(
+  const alp::array_t<segment_t> &segments, int segment_bits,
+  alp::array_t<uint32_t> &slots) {
+  const int n_iterations=20000;
+  const double t_start=2, t_end=0.05;
+  size_t n_slots=1uL<<segment_bits;
+  
+  alp::array_t<ssize_t> seg_of;
+  alp::array_t<uint32_t> best;
+  alp::array_t<uint64_t> cubes;
   
+  seg_of.setlen(n_slots);
+  for(size_t i=0;i<n_slots;i++) seg_of[i]=-1;
+  for(size_t i=0;i<slots.len;i++) seg_of[slots[i]]=i;
+  best.insert(slots.ptr,slots.len);
+  
+  size_t cost=_estimate_pla_terms(segments,slots.ptr,segment_bits,cubes);
+  size_t best_cost=cost;
+  uint64_t rng=0x853c49e6748fea9buL;
+  
+  for(int it=0;it<n_iterations;it++) {
+    rng^=rng<<13; rng^=rng>>7; rng^=rng<<17;
+    size_t s=(rng>>32)%segments.len;
+    uint32_t t=(uint32_t)((rng&0xffffffff)%n_slots);
+    uint32_t t0=slots[s];
+    ssize_t u=seg_of[t];
+    if (t==t0) continue;
+    
+    slots[s]=t; seg_of[t]=s; seg_of[t0]=u;
+    if (u>=0) slots[u]=t0;
+    
+    size_t c=_estimate_pla_terms(segments,slots.ptr,segment_bits,cubes);
+    double temp=t_start*pow(t_end/t_start,(double)it/n_iterations);
+    rng^=rng<<13; rng^=rng>>7; rng^=rng<<17;
+    if (
+      (c>cost) && 
+      (exp(((double)cost-(double)c)/temp)<(double)(rng>>11)/(1uL<<53))) {
+      // reject
+      slots[s]=t0; seg_of[t0]=s; seg_of[t]=u;
+      if (u>=0) slots[u]=t;
+      continue;
+    }
+    
+    cost=c;
+    if (cost<best_cost) {
+      best_cost=cost;
+      memcpy(best.ptr,slots.ptr,slots.len*sizeof(uint32_t));
+    }
+  }
+  memcpy(slots.ptr,best.ptr,slots.len*sizeof(uint32_t));
+}
 
-  // 2. PLA -- MinTerms and naive addresses
-  for( size_t current_segment = 0; current_segment < _segments.len;
+// search steps of the exact PLA cover search per second of its time limit
+// in deterministic mode, roughly matching the speed of a current machine
+#define PLA_COVER_NODES_PER_SECOND 1000000
+
+/** Feeds the PLA configuration mapping segment i to RAM slot slots[i] into
+  * qmc and minimizes it, unless a minimized configuration is found in the
+  * cache.
+  *
+  * If deterministic, the exact cover search is bounded by 
+  * PLA_COVER_NODES_PER_SECOND search steps per second of cover_time_limit 
+  * instead of time, so that its result does not depend on the machine.
+  */
+static void _minimize_pla(
+  QMC &qmc, const alp::array_t<segment_t> &segments, const uint32_t *slots,
+  const arch_config_t &arch, int exact_max_inputs, int cover_time_limit,
+  bool deterministic, const alp::string &cache_dir) {
+  Stats::Timer timer(Stats::QMCMinimize);
+  
+  for(size_t current_segment=0;current_segment<segments.len;
        current_segment++) {
-    segment_t &seg=_segments[current_segment];
+    const segment_t &seg=segments[current_segment];
     for(size_t i=seg.prefix;i<seg.prefix+seg.width;i++) {
-      qmc.add_term(i,current_segment);
+      qmc.add_term(i,slots[current_segment]);
+    }
+  }
+  
+  PLACache::key_t key=PLACache::Key(
+    segments,slots,arch,exact_max_inputs,cover_time_limit,deterministic);
+  alp::array_t<QMC::implicant_t> cached;
+  if (PLACache::Lookup(key,cache_dir,cached)) {
+    qmc.setImplicants(cached);
+    // on-disk entries might be stale or corrupt
+    if (qmc.verify()) {
+      Stats::Count(Stats::Implicants,qmc.implicants().len);
+      return;
+    }
+  }
+  
+  // enumerating all prime implicants becomes infeasible for wide selectors
+  if (
+    (arch.selectorBits>exact_max_inputs) &&
+    (arch.selectorBits<=QMC::MaxHeuristicInputs)) {
+    qmc.minimizeHeuristic();
+  } else {
+    qmc.minimize();
+  }
+  if (!qmc.verify())
+    throw RuntimeError("PLA minimization yielded an invalid configuration");
+
+  // the greedy cover may use more implicants than necessary; only pay for
+  // an exact one if it makes a difference
+  if (
+    ((ssize_t)qmc.implicants().len>arch.plaInterconnects) &&
+    (cover_time_limit>0)) {
+    bool optimal;
+    size_t node_limit=0;
+    if (deterministic) 
+      node_limit=(size_t)cover_time_limit*PLA_COVER_NODES_PER_SECOND;
+    if (qmc.minimizeCoverExact(cover_time_limit,&optimal,node_limit)) {
+      alp::logf(
+        "INFO: PLA cover reduced to %zu implicants%s\n",alp::LOGT_INFO,
+        qmc.implicants().len,optimal?"":" (time limit reached)");
     }
+    if (!qmc.verify())
+      throw RuntimeError("PLA minimization yielded an invalid configuration");
   }
   
-  qmc.minimize();
-  const alp::array_t<QMC::implicant_t*> &implicants=qmc.implicants();
+  Stats::Count(Stats::Implicants,qmc.implicants().len);
+  PLACache::Store(key,cache_dir,qmc.implicants());
+}
 
-  if ((ssize_t)implicants.len>_arch.plaInterconnects) {
-    throw HWResourceExceededError(HWResourceExceededError::PLAInterconnects);
+unittest(
+  /*
+    testing:
+      _search_pla_slots
+      _minimize_pla
+      LookupTable::translate
+  */
+  options_t opts;
+  opts.arch.selectorBits=4;
+  opts.arch.segmentBits=3;
+  opts.arch.interpolationBits=8;
+  opts.arch.plaInterconnects=16;
+  opts.fPlaSlotSearch=1;
+
+  static const uint32_t bounds[][2]={
+    { 0,3 }, { 3,2 }, { 5,1 }, { 6,4 }, { 10,1 }, { 11,3 }, { 14,2 }
+  };
+  const size_t n=sizeof(bounds)/sizeof(bounds[0]);
+  alp::array_t<segment_t> segments;
+  alp::array_t<uint32_t> slots;
+  alp::array_t<uint64_t> cubes;
+  for(size_t i=0;i<n;i++) {
+    segments.insert(segment_t(bounds[i][0],bounds[i][1]));
+    slots.insert(i);
   }
 
-  // number of words required to store specified number of bits
-  #define NWORDS(nbits) ( \
-    (nbits)/_arch.wordSize + (((nbits)%_arch.wordSize>0)?1:0) )
-  { // allocate bitstream data structure 
-
-    _config_words.setlen(
-      // RAM
-      NWORDS(_arch.base_bits+_arch.incline_bits)*(1<<_arch.segmentBits) +
-      // input decoder
-      NWORDS(3*_arch.wordSize)*(_arch.selectorBits+_arch.interpolationBits)+
-      // PLA AND plane
-      NWORDS(2*_arch.selectorBits)*_arch.plaInterconnects+
-      // PLA OR plane
-      NWORDS(_arch.plaInterconnects)*_arch.segmentBits);
-    memset(_config_words.ptr,0x55,8*_config_words.len);
+  size_t cost=_estimate_pla_terms(segments,slots.ptr,3,cubes);
+  _search_pla_slots(segments,3,slots);
+  Assertf(
+    _estimate_pla_terms(segments,slots.ptr,3,cubes)<=cost,
+    "slot search increased the estimated PLA size");
+  for(size_t i=0;i<n;i++) {
+    Assertf(slots[i]<8, "segment %zu assigned to invalid slot %u",i,slots[i]);
+    for(size_t j=0;j<i;j++)
+      Assertf(
+        slots[i]!=slots[j], "segments %zu and %zu share slot %u",
+        j,i,slots[i]);
   }
 
-  { // write configuration bitstream word-by-word
-    // the configuration bitstream was allocated, now it is traversed through
-    // insert_pos, incrementally or decrementally.
-    uint64_t cur_word=0;
-    int cur_bits=0;
-    uint64_t *insert_pos=NULL;
-    bool insert_incr=true;
-
-    // write currently built word to bitstream vector, if not empty
-    #define FLUSH if (cur_bits>0) { \
-      if (insert_incr) \
-        *insert_pos++=cur_word&REG_MASK; \
-      else \
-        *insert_pos--=cur_word&REG_MASK; \
-      cur_word=0; \
-      cur_bits=0; \
-    }
-    
-    // write the bits LSBs of data to the currently constructed word, appending
-    // as many words as needed
-    #define WRITE_BITS(bits,data) { \
-      int _bits=bits; \
-      uint64_t _data=data; \
-      while (cur_bits+_bits>=REG_WIDTH) { \
-        int n=REG_WIDTH-cur_bits; \
-        if (n==REG_WIDTH) cur_word=_data; \
-        else cur_word|=(_data&((1uL<<n)-1))<<cur_bits; \
-        cur_bits=REG_WIDTH; \
-        FLUSH; \
-        _data>>=n; \
-        _bits-=n; \
-      } \
-      cur_word|=(_data&((1uL<<_bits)-1))<<cur_bits; \
-      cur_bits+=_bits; \
-    }
-    
-    // copy char-encoded bits to currently constructed word
-    #define EXTRACT_ACTUAL(ptr,bits) { \
-      for(int i_bit=0;i_bit<bits;i_bit++)  \
-        cur_word|=((ptr[i_bit]==true) ? 1 : 0) << (i_bit+cur_bits); \
-      cur_bits+=bits; \
-    }
-    
-    // extract a number of bits from a char-encoded stream of bits.
-    // appends as many words as needed to represent the bits.
-    #define EXTRACT(ptr,bits) if ((bits)>0) { \
-      int _bits=bits; \
-      char *_ptr=ptr; \
-      while (cur_bits+_bits>REG_WIDTH) { \
-        int n=REG_WIDTH-cur_bits; \
-        EXTRACT_ACTUAL(_ptr,n); \
-        FLUSH; \
-        _ptr+=n; \
-        _bits-=n; \
-      } \
-      EXTRACT_ACTUAL(_ptr,_bits); \
-    }
-    
-    // extract multi-word value from char-encoded stream of bits 
-    // and store in correct word order.
-    #define EXTRACT_VALUE(ptr,width) { \
-      /* number of _full_ words */ \
-      int _words=(width)/_arch.wordSize; \
-      /* extract high-order word if it aint a full one */ \
-      EXTRACT(ptr+_words*_arch.wordSize,(width)%_arch.wordSize); \
-      FLUSH; \
-      /* extract remainder */ \
-      for(int i_word=_words-1;i_word>-1;i_word--) { \
-        EXTRACT(ptr+i_word*_arch.wordSize,_arch.wordSize) \
-        FLUSH; \
-      } \
-    }
-    
-    // extract a multiple multi-word values
-    #define EXTRACT_VECTOR(base,count,width) { \
-      for(int i=0;i<(count);i++) \
-        EXTRACT_VALUE((base)+i*(width),(width)); \
-    }
-    
-    // insert RAM data at the beginning of the bitstream
-    insert_pos=_config_words.ptr;
-    insert_incr=true;
-    
-    for(size_t i=0;i<_segments.len;i++) {
-      uint64_t base,incline;
-      base=(int64_t)_segments[i].y0;
-      incline=(int64_t)(_segments[i].y1-_segments[i].y0);
-      incline/=(1<<_arch.interpolationBits)*_segments[i].width;
+  QMC qmc(opts.arch.selectorBits);
+  _minimize_pla(qmc,segments,slots.ptr,opts.arch,10,0,true,alp::string());
+  Assertf(qmc.verify(), "invalid PLA for the reassigned slots");
+
+  // the RAM records need to be placed at the slots the PLA addresses
+  LookupTable lut(opts);
+  alp::string input="name \"test\"\ndomain 12 0\n";
+  for(size_t i=0;i<n;i++) 
+    input+=alp::string::Format(
+      "segment %u %u %u %u\n",bounds[i][0],bounds[i][1],
+      1000*(unsigned)i,1000*(unsigned)i+999);
+  lut.parseIntermediate(input.ptr,input.len,"test lut");
+  lut.translate();
+
+  BitstreamDisassembler dis(opts.arch);
+  alp::string report;
+  dis.decode(lut.config_words());
+  Assertf(
+    dis.validate(lut,report), "bitstream does not match the LUT:\n%s",
+    report.ptr);
+)
 
-      base-=incline*(1<<_arch.interpolationBits)*_segments[i].prefix;
+void LookupTable::RamRecord(
+  const arch_config_t &arch, const segment_t &seg, 
+  uint64_t &base, uint64_t &incline) {
+  base=(int64_t)seg.y0;
+  incline=(int64_t)(seg.y1-seg.y0);
+  incline/=(1<<arch.interpolationBits)*seg.width;
 
-      WRITE_BITS(_arch.incline_bits,incline);
-      WRITE_BITS(_arch.base_bits,base);
-      FLUSH;
-    }
+  base-=incline*(1<<arch.interpolationBits)*seg.prefix;
+}
+
+void LookupTable::translate() {
+  assert( _segments.len > 0 && "translate: #of segments not larger than 0");
+  Stats::Timer timer(Stats::Translate);
 
+  QMC qmc(_arch.selectorBits);
+  
+  //print_translation_parameters();
 
-    // start inserting chain registers at the very end to omit reversing later
-    insert_pos=_config_words.ptr+_config_words.len-1;
-    insert_incr=false;
-    EXTRACT_VECTOR(
-      connection_plane_conf,
-      _arch.selectorBits+_arch.interpolationBits,
-      3*_arch.wordSize);
-    
-    for(size_t i=0;i<implicants.len;i++) {
-      for(size_t j=0;j<(size_t)_arch.selectorBits;j++)
-        if (implicants[i]->term[j]==0) {WRITE_BITS(1,1) }
-        else { WRITE_BITS(1,0) }
-      for(size_t j=0;j<(size_t)_arch.selectorBits;j++)
-        if (implicants[i]->term[j]==1) { WRITE_BITS(1,1) }
-        else { WRITE_BITS(1,0) }
-      FLUSH;
+  // 2. PLA -- MinTerms and RAM slot addresses, segments in order at first
+  alp::array_t<uint32_t> slots, slots_alt;
+  for(size_t i=0;i<_segments.len;i++) slots.insert(i);
+  
+  QMC qmc_alt(_arch.selectorBits);
+  QMC *pla=&qmc;
+  const uint32_t *slot=slots.ptr;
+  _minimize_pla(
+    qmc,_segments,slots.ptr,_arch,_pla_exact_max_inputs,
+    _pla_cover_time_limit,_deterministic,_pla_cache_dir);
+  
+  // the OR plane depends on the RAM slot chosen for each segment, a 
+  // different assignment may save implicants
+  if (
+    (_pla_slot_search || 
+      ((ssize_t)qmc.implicants().len>_arch.plaInterconnects)) &&
+    (_segments.len>1)) {
+    slots_alt.insert(slots.ptr,slots.len);
+    _search_pla_slots(_segments,_arch.segmentBits,slots_alt);
+    _minimize_pla(
+      qmc_alt,_segments,slots_alt.ptr,_arch,_pla_exact_max_inputs,
+      _pla_cover_time_limit,_deterministic,_pla_cache_dir);
+    if (qmc_alt.implicants().len<qmc.implicants().len) {
+      alp::logf(
+        "INFO: reassigning RAM slots reduced the PLA from %zu to %zu "
+        "implicants\n",alp::LOGT_INFO,
+        qmc.implicants().len,qmc_alt.implicants().len);
+      pla=&qmc_alt;
+      slot=slots_alt.ptr;
     }
+  }
 
-    for(size_t i=implicants.len;i<(size_t)_arch.plaInterconnects;i++) {
-      WRITE_BITS(2*_arch.selectorBits,0);
-      FLUSH;
-    }
-    
-    for(size_t i=0;i<(size_t)_arch.segmentBits;i++) {
-      ssize_t i0=_arch.plaInterconnects;
-      size_t cb=i0%REG_WIDTH;
-      i0-=i0%REG_WIDTH;
-      
-      while(i0>=(ssize_t)implicants.len) {
-        WRITE_BITS(cb,0);
-        FLUSH;
-        cb=REG_WIDTH;
-        i0-=cb;
-      }
+  const alp::array_t<QMC::implicant_t*> &implicants=pla->implicants();
 
-      while(i0>=0) {
-        for(size_t j=i0;(j<implicants.len)&&(j<i0+cb);j++) {
-          if (implicants[j]->impl&(1<<i)) { WRITE_BITS(1,1) }
-          else { WRITE_BITS(1,0) }
-        }
-        FLUSH;
-        cb=REG_WIDTH;
-        i0-=cb;
-      } 
-    }
-    
-    #undef NWORDS
-    #undef FLUSH
-    #undef EXTRACT_ACTUAL
-    #undef EXTRACT
-    #undef EXTRACT_VALUE
-    #undef EXTRACT_VECTOR
-    #undef WRITE_BITS
+  if ((ssize_t)implicants.len>_arch.plaInterconnects) {
+    throw HWResourceExceededError(HWResourceExceededError::PLAInterconnects);
+  }
+
+  BitstreamImage img((BitstreamLayout(_arch)));
+
+  // 1. RAM, each segment at the slot assigned to it
+  for(size_t i=0;i<_segments.len;i++)
+    _write_ram_record(img,slot[i],_arch,_segments[i]);
+
+  // 2. connection plane
+  _write_connection_plane(img,_arch,_segment_space_width);
+
+  // 3. PLA AND plane: inverted selector lines are connected for 0 bits, 
+  // normal ones for 1 bits, none for don't cares. Unused interconnects stay
+  // disconnected.
+  uint64_t input_mask=(_arch.selectorBits<64) 
+    ? (1uL<<_arch.selectorBits)-1 : ~0uL;
+  for(size_t i=0;i<implicants.len;i++) {
+    const QMC::implicant_t *m=implicants[i];
+    img.setField(
+      BitstreamLayout::AND_INVERTED,i,~m->value&m->care&input_mask);
+    img.setField(BitstreamLayout::AND_NORMAL,i,m->value&m->care);
+  }
+
+  // 4. PLA OR plane: one line per output bit, one bit per interconnect
+  for(size_t i=0;i<(size_t)_arch.segmentBits;i++) {
+    uint64_t *l=img.line(BitstreamLayout::OR_PLANE,i);
+    for(size_t j=0;j<implicants.len;j++)
+      l[j/64]|=((implicants[j]->impl>>i)&1)<<(j%64);
   }
 
+  img.encode(_config_words);
 }
 
 
@@ -1315,25 +1702,7 @@ void LookupTable::translate2() {
   
   //print_translation_parameters();
 
-  // Variables of interest during translation
-  int REG_WIDTH = _arch.wordSize;
-  const uint64_t REG_MASK = 0xffffffffffffffff;
-
-  // Allocate char arrays to hold config information.
-  // And plane of the PLA; *2: for inverted inputs
-  and_plane_conf = new char[_arch.plaInterconnects*2*_arch.selectorBits];
-  // Or plane of the PLA
-  or_plane_conf = new char[_arch.plaInterconnects*_arch.segmentBits];
-  // Connection plane connecting suitable input lines to the PLA
-  connection_plane_conf = new char[3*REG_WIDTH*(_arch.selectorBits
-				       +_arch.interpolationBits)];
-  // Array of LUT outputs used as factors in the Multiply-Add unit
-  factor_output = new seg_data_t[1<<_arch.segmentBits];
-  // Array of LUT outputs used as offsets in the Multiply-Add unit
-  offset_output = new seg_data_t[1<<_arch.segmentBits];
-  // TODO: for now, only linear interpolation, no steps
-  use_multiply_add = true;
-  
+  BitstreamImage img((BitstreamLayout(_arch)));
 
   /* Calculate LUT decoder configuration
      - calculate *which* bits of the input are used for selection and
@@ -1342,210 +1711,30 @@ void LookupTable::translate2() {
      - Or plane: naive addresses for now
    */
   // 1. connection plane
-  // Connect interpolationBits for Multiply-Add unit
-  // Which LUT input bits are used for interpolation within segments?
-  // Counting from MSBs:
-  //   The selectorBits and following until a number of interpolationBits
-  //   is reached.
-  int interpolate_LSB = _segment_space_width - _arch.interpolationBits-_arch.selectorBits;
-  int interpolate_MSB = _segment_space_width;
-  //printf("interpolateLSB: %i, interpolateMSB: %i\n",
-  //       interpolate_LSB, interpolate_MSB);
-  // Connect selectorBits to PLA via connection plane
-  for( int interpolateBit = 0; interpolateBit<_arch.interpolationBits; 
-       interpolateBit++){
-    for( int registerBit = 0; registerBit<REG_WIDTH*3; registerBit++){
-      if( interpolate_LSB <= registerBit
-          && registerBit < interpolate_MSB  
-          && registerBit - interpolate_LSB == interpolateBit){ // connection
-        //printf("connected: regbit: %i, interpolatebit: %i\n",
-        //        registerBit, interpolateBit);
-        connection_plane_conf[interpolateBit*REG_WIDTH*3+registerBit] = true;
-      }else{ // no connection
-        connection_plane_conf[interpolateBit*REG_WIDTH*3+registerBit] = false;
-      }
-    }
-  }
-  // Which LUT input bits are used for segment selection?
-  // Counting from LSBs:
-  //   (_segment_space_width-_arch.selectorBits) to _segment_space_width
-  int select_LSB = _segment_space_width - _arch.selectorBits;
-  int select_MSB = _segment_space_width;
-  //printf("selLSB: %i, selMSB: %i\n", select_LSB, select_MSB);
-  int sco = _arch.interpolationBits*REG_WIDTH*3; //segment configuration offset
-  // Connect selectorBits to PLA via connection plane
-  for( int selectorBit = 0; selectorBit<_arch.selectorBits; selectorBit++){
-    for( int registerBit = 0; registerBit<REG_WIDTH*3; registerBit++){ // 3 rs
-      if( select_LSB <= registerBit
-          && registerBit < select_MSB  
-          && registerBit - select_LSB == selectorBit){ // connection
-        //printf("connected: regbit: %i, selbit: %i\n", registerBit, selectorBit);
-        connection_plane_conf[selectorBit*REG_WIDTH*3+registerBit+sco] = true;
-      }else{ // no connection
-        connection_plane_conf[selectorBit*REG_WIDTH*3+registerBit+sco] = false;
-      }
-    }
-  }
+  _write_connection_plane(img,_arch,_segment_space_width);
 
   // 2. PLA -- MinTerms and naive addresses
   int current_interconnect = 0;
+  PLAGenerator pla_gen( img, _arch.selectorBits, _arch.segmentBits,
+                        _arch.plaInterconnects);
   for( size_t current_segment = 0; current_segment < _segments.len;
        current_segment++){
-    qmc_pla_gen( &current_interconnect, current_segment,
-                 &_segments[current_segment],
-                 and_plane_conf, or_plane_conf, _arch.selectorBits,
-                 _arch.segmentBits, _arch.plaInterconnects);
+    pla_gen.qmc_pla_gen( &current_interconnect, current_segment,
+                         &_segments[current_segment]);
   }
-  // write impossible MinTerms to rest of and_plane_conf, initialize or_plane
+  // write impossible MinTerms to rest of the AND plane, the OR plane is
+  // already cleared
+  uint64_t input_mask=(_arch.selectorBits<64) 
+    ? (1uL<<_arch.selectorBits)-1 : ~0uL;
   for(; current_interconnect<_arch.plaInterconnects; current_interconnect++){
-    for(int i=0;i<_arch.selectorBits;i++) {
-      and_plane_conf[current_interconnect*2*_arch.selectorBits+i]=true;
-      and_plane_conf[(current_interconnect*2+1)*_arch.selectorBits+i]=true;
-    }
-    for(int i=0;i<_arch.segmentBits;i++) {
-      or_plane_conf[current_interconnect+_arch.plaInterconnects*i] = false;
-    }
-  }
- 
-  
-  
-  { // allocate bitstream data structure 
-    // number of words required to store specified number of bits
-    #define NWORDS(nbits) ( \
-      (nbits)/_arch.wordSize + (((nbits)%_arch.wordSize>0)?1:0) )
-
-    _config_words.setlen(
-      // RAM
-      NWORDS(_arch.base_bits+_arch.incline_bits)*(1<<_arch.segmentBits) +
-      // input decoder
-      NWORDS(3*_arch.wordSize)*(_arch.selectorBits+_arch.interpolationBits)+
-      // PLA AND plane
-      NWORDS(2*_arch.selectorBits)*_arch.plaInterconnects+
-      // PLA OR plane
-      NWORDS(_arch.plaInterconnects)*_arch.segmentBits);
-    #undef NWORDS
+    img.setField(
+      BitstreamLayout::AND_INVERTED,current_interconnect,input_mask);
+    img.setField(BitstreamLayout::AND_NORMAL,current_interconnect,input_mask);
   }
 
-  { // write configuration bitstream word-by-word
-    // the configuration bitstream was allocated, now it is traversed through
-    // insert_pos, incrementally or decrementally.
-    uint64_t cur_word=0;
-    int cur_bits=0;
-    uint64_t *insert_pos=NULL;
-    bool insert_incr=true;
-
-    // write currently built word to bitstream vector, if not empty
-    #define FLUSH if (cur_bits>0) { \
-      if (insert_incr) \
-        *insert_pos++=cur_word&REG_MASK; \
-      else \
-        *insert_pos--=cur_word&REG_MASK; \
-      cur_word=0; \
-      cur_bits=0; \
-    }
-    
-    // write the bits LSBs of data to the currently constructed word, appending
-    // as many words as needed
-    #define WRITE_BITS(bits,data) { \
-      int _bits=bits; \
-      uint64_t _data=data; \
-      while (cur_bits+_bits>REG_WIDTH) { \
-        int n=REG_WIDTH-cur_bits; \
-        cur_word|=(_data&((1uL<<n)-1))<<cur_bits; \
-        cur_bits=REG_WIDTH; \
-        FLUSH; \
-        _data>>=n; \
-        _bits-=n; \
-      } \
-      cur_word|=(_data&((1uL<<_bits)-1))<<cur_bits; \
-      cur_bits+=_bits; \
-    }
-    
-    // copy char-encoded bits to currently constructed word
-    #define EXTRACT_ACTUAL(ptr,bits) { \
-      for(int i_bit=0;i_bit<bits;i_bit++)  \
-        cur_word|=((ptr[i_bit]==true) ? 1 : 0) << (i_bit+cur_bits); \
-      cur_bits+=bits; \
-    }
-    
-    // extract a number of bits from a char-encoded stream of bits.
-    // appends as many words as needed to represent the bits.
-    #define EXTRACT(ptr,bits) if ((bits)>0) { \
-      int _bits=bits; \
-      char *_ptr=ptr; \
-      while (cur_bits+_bits>REG_WIDTH) { \
-        int n=REG_WIDTH-cur_bits; \
-        EXTRACT_ACTUAL(_ptr,n); \
-        FLUSH; \
-        _ptr+=n; \
-        _bits-=n; \
-      } \
-      EXTRACT_ACTUAL(_ptr,_bits); \
-    }
-    
-    // extract multi-word value from char-encoded stream of bits 
-    // and store in correct word order.
-    #define EXTRACT_VALUE(ptr,width) { \
-      /* number of _full_ words */ \
-      int _words=(width)/_arch.wordSize; \
-      /* extract high-order word if it aint a full one */ \
-      EXTRACT(ptr+_words*_arch.wordSize,(width)%_arch.wordSize); \
-      FLUSH; \
-      /* extract remainder */ \
-      for(int i_word=_words-1;i_word>-1;i_word--) { \
-        EXTRACT(ptr+i_word*_arch.wordSize,_arch.wordSize) \
-        FLUSH; \
-      } \
-    }
-    
-    // extract a multiple multi-word values
-    #define EXTRACT_VECTOR(base,count,width) { \
-      for(int i=0;i<(count);i++) \
-        EXTRACT_VALUE((base)+i*(width),(width)); \
-    }
-    
-    // insert RAM data at the beginning of the bitstream
-    insert_pos=_config_words.ptr;
-    insert_incr=true;
-    
-    for(size_t i=0;i<_segments.len;i++) {
-      uint64_t base,incline;
-      base=(int64_t)_segments[i].y0;
-      incline=(int64_t)(_segments[i].y1-_segments[i].y0);
-      incline/=(1<<_arch.interpolationBits)*_segments[i].width;
-
-      base-=incline*(1<<_arch.interpolationBits)*_segments[i].prefix;
-
-      WRITE_BITS(_arch.incline_bits,incline);
-      WRITE_BITS(_arch.base_bits,base);
-      FLUSH;
-    }
-
-
-    // start inserting chain registers at the very end to omit reversing later
-    insert_pos=_config_words.ptr+_config_words.len-1;
-    insert_incr=false;
-    EXTRACT_VECTOR(
-      connection_plane_conf,
-      _arch.selectorBits+_arch.interpolationBits,
-      3*_arch.wordSize);
-
-    EXTRACT_VECTOR(
-      and_plane_conf,
-      _arch.plaInterconnects,
-      _arch.selectorBits*2);
-
-    EXTRACT_VECTOR(
-      or_plane_conf,
-      _arch.segmentBits,
-      _arch.plaInterconnects);
-
-    #undef FLUSH
-    #undef EXTRACT_ACTUAL
-    #undef EXTRACT
-    #undef EXTRACT_VALUE
-    #undef EXTRACT_VECTOR
-    #undef WRITE_BITS
-  }
+  // 3. RAM
+  for(size_t i=0;i<_segments.len;i++)
+    _write_ram_record(img,i,_arch,_segments[i]);
 
+  img.encode(_config_words);
 }
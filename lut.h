@@ -14,6 +14,7 @@
 #include "weights.h"
 #include "deviation.h"
 #include "qmc.h"
+#include "output-stream.h"
 
 #include <alpha/alpha.h>
 
@@ -47,6 +48,12 @@ class LookupTable {
 
     // process-specific options
     alp::string _cmdCompileSO;
+    int _pla_exact_max_inputs;
+    int _pla_cover_time_limit;
+    bool _pla_slot_search;
+    bool _deterministic;
+    alp::string _pla_cache_dir;
+    alp::string _target_cache_dir;
     
     
     /** Lookup table identifier generated *externally* and guaranteed to be 
@@ -77,6 +84,9 @@ class LookupTable {
 
     alp::string _c_code;
     
+    /** Library of the target function while it is being loaded. Once
+      * loaded, the library is held by the TargetCache.
+      */
     dynamic_library_t *_target_lib;
     target_func_t _target_func;
     
@@ -86,18 +96,15 @@ class LookupTable {
 
     alp::array_t<segment_t> _segments;
 
-    // generated LUT configuration held in arrays
-    char* and_plane_conf;
-    char* or_plane_conf;
-    char* connection_plane_conf;
-    seg_data_t* factor_output;
-    seg_data_t* offset_output;
-    bool use_multiply_add;
-    
     /** LUT configuration bitstream
       */
     alp::array_t<uint64_t> _config_words;
 
+    /** Bitstream of the configuration the output is a delta against, empty
+      * if the full bitstream is output.
+      */
+    alp::array_t<uint64_t> _reference_words;
+
   public:
     /** Constructor.
       *
@@ -119,6 +126,13 @@ class LookupTable {
     
     /** Getter for this LUT's identifier */
     const alp::string &ident() const { return _ident; }
+
+    const arch_config_t &arch() const { return _arch; }
+
+    /** Returns the configuration bitstream, empty before translation */
+    const alp::array_t<uint64_t> &config_words() const { 
+      return _config_words; 
+    }
     
     int num_segments() const { return _num_segments; }
     int num_primary_segments() const { return _num_primary_segments; }
@@ -133,6 +147,13 @@ class LookupTable {
       */
     const alp::string &fn_weights() const { return _fn_weights; }
 
+    /** Returns all key-values read from the input file */
+    const alp::array_t<KeyValue*> &keyvalues() const { return _keyvalues; }
+    /** Returns the name of the target function */
+    const alp::string &target_name() const { return _target_name; }
+    /** Returns the C code defining the target function */
+    const alp::string &c_code() const { return _c_code; }
+
     /** Returns a constant view into our domain as represented by our
       * bounds instance.*/
     const Bounds &bounds() { return _bounds; }
@@ -188,6 +209,14 @@ class LookupTable {
       * Basically just a lookup of strings
       */
     static approx_strategy::id_t ParseApproxStrategy(const alp::string &s);
+
+    /** Computes the RAM record of a segment, i.e. the base value and the 
+      * incline per interpolation step of the Multiply-Add unit. Both are
+      * stored truncated to the widths given by the architecture.
+      */
+    static void RamRecord(
+      const arch_config_t &arch, const segment_t &seg, 
+      uint64_t &base, uint64_t &incline);
     
     /** Parses an input format buffer and integrates its content into this
       * instance.
@@ -246,12 +275,37 @@ class LookupTable {
     void saveIntermediateFile(const char *fn);
     
     
+    /** Loads a reference configuration, switching the final output to a 
+      * delta against it.
+      *
+      * The file either holds a bitstream dump as written by 
+      * saveOutputDumpFile or a LUT in intermediate format, which is 
+      * translated using the architecture and options of this LUT.
+      *
+      * \param fn File name of the reference configuration.
+      * \throw FileIOException The given file could not be read.
+      * \throw SyntaxError The given file is not a valid intermediate file.
+      */
+    void parseReferenceFile(const char *fn);
+
     /** Generates a representation of the Lookup table in final output format.
       *
       * Outputs C code defining a constant buffer of our configuration bits.
+      * If a reference configuration was loaded, only the differing words
+      * are output, as a sequence of runs, each consisting of the index of 
+      * its first word, its number of words and the words themselves. The 
+      * sequence is terminated by an empty run. A function writing the runs
+      * to the configuration is output as well.
+      * 
       * \param res String variable receiving the generated code.
+      * \throw RuntimeError The reference configuration was built for a 
+      * different architecture.
       */
     void generateOutputFormat(alp::string &res);
+    /** Writes the final output format to out.
+      * \see generateOutputFormat
+      */
+    void writeOutputFormat(OutputStream &out);
 
     /** Saves the final output code output to a file.
       *
@@ -260,8 +314,46 @@ class LookupTable {
       */
     void saveOutputFile(const char *fn);
 
+    /** Generates a raw dump of the bitstream, the decimal representation of
+      * each word, one per line. If a reference configuration was loaded, 
+      * only the differing words are output, each preceded by its index.
+      */
     void generateOutputDumpFormat(alp::string &res);
+    void writeOutputDumpFormat(OutputStream &out);
     void saveOutputDumpFile(const char *fn);
+
+    /** Saves the configuration bitstream as raw binary data, each word in
+      * the least number of bytes holding a word.
+      *
+      * \param fn File name to write to
+      * \param big_endian Store the bytes of each word most significant 
+      * first.
+      * \throw FileIOException The file could not be written to.
+      */
+    void saveOutputBinaryFile(const char *fn, bool big_endian);
+
+    /** Saves the configuration bitstream as an Intel HEX file, words 
+      * stored little endian starting at address 0. If a reference 
+      * configuration was loaded, only the differing words are stored.
+      *
+      * \param fn File name to write to
+      * \throw FileIOException The file could not be written to.
+      */
+    void saveOutputHexFile(const char *fn);
+
+    /** Saves the configuration bitstream as a RISC-V relocatable ELF 
+      * object, just like compiling the output of generateOutputFormat.
+      *
+      * Delta output is not supported, as it requires code.
+      *
+      * \param fn File name to write to
+      * \param elf_class ELF class of the object, 32 or 64.
+      * \param elf_flags ELF header flags selecting the ABI, see
+      * ElfWriter::AbiFlags.
+      * \throw FileIOException The file could not be written to.
+      */
+    void saveOutputObjectFile(
+      const char *fn, int elf_class, uint32_t elf_flags);
     
     
     /** Computes the segment space of this LUT.
@@ -1,5 +1,7 @@
 #include "options.h"
 #include "error.h"
+#include "explore.h"
+#include "elf-writer.h"
 #include <stdio.h>
 #include <string.h>
 
@@ -10,11 +12,27 @@
 options_t::options_t() : 
   fInputIntermediate(0),
   fInputWeights(0),
+  fDisassemble(0),
+  fCombine(0),
+  fBatch(0),
+  fIncremental(0),
+  fStats(0),
+  jobs(Default_jobs),
   fOutputIntermediate(0),
   fOutputC(0),
   fOutputDump(0),
+  fOutputBinary(0),
+  fOutputHex(0),
+  fBigEndian(0),
   maxWeightSteps(Default_maxWeightSteps),
   fGenerateGnuplot(0),
+  fExternalCompile(0),
+  elfClass(Default_elfClass),
+  elfFlags(ElfWriter::DefaultFlags(Default_elfClass)),
+  fPlaSlotSearch(0),
+  plaExactMaxInputs(Default_plaExactMaxInputs),
+  plaCoverTimeLimit(Default_plaCoverTimeLimit),
+  fDeterministic(0),
   cmdCompileSO(Default_cmdCompileSO()),
   cmdCompileTargetO(Default_cmdCompileTargetO())
   // strings initialize themselves to ""
@@ -35,6 +53,9 @@ options_t::options_t() :
 void options_t::print(FILE *f) {
   fprintf(f,
     "riscv-lut-compiler [options] input-file\n"
+    "riscv-lut-compiler [options] --combine input-file...\n"
+    "riscv-lut-compiler [options] --batch input-file...\n"
+    "riscv-lut-compiler [options] --serve <socket>\n"
     "  translates a C/C++ function annotated with keywords into a Lookup \n"
     "  table configuration.\n"
     "  This is outputted either as an intermediate format (that can be read\n"
@@ -52,6 +73,45 @@ void options_t::print(FILE *f) {
     "  -D|--output-dump\n"
     "    Output a raw dump of the final bitstream, printing the decimal \n"
     "    representation of each word, one word per line. \n"
+    "  -B|--output-binary\n"
+    "    Output the final bitstream as raw binary data, each word in as \n"
+    "    few bytes as possible, little endian unless --big-endian is given.\n"
+    "  --big-endian\n"
+    "    Store words of binary output most significant byte first.\n"
+    "  -X|--output-hex\n"
+    "    Output the final bitstream as an Intel HEX file, words stored \n"
+    "    little endian starting at address 0.\n"
+    "  -m|--combine\n"
+    "    Compile each of multiple input files into a LUT and output the \n"
+    "    configurations of all of them together, as C code (-C) or ELF. \n"
+    "    The bitstreams are stored in a common pool named <name>_pool, \n"
+    "    <name> being given by -n or luts, identical sections only once. \n"
+    "    Each LUT is described by an array \n"
+    "    <ident>_desc holding the pool offset and word count of each of its\n"
+    "    sections.\n"
+    "  --batch\n"
+    "    Compile each of multiple input files into its own output, named \n"
+    "    after the input file, on a pool of worker threads. A LUT failing \n"
+    "    to compile does not affect the others. Cannot be used with -o and \n"
+    "    -n.\n"
+    "  -j|--jobs <number>\n"
+    "    set the number of worker threads used by --batch and --explore \n"
+    "    and of jobs run concurrently by --serve, 0 for one per hardware \n"
+    "    thread.\n"
+    "    default: %i\n"
+    "  --explore <ranges>\n"
+    "    compile each input file for every architecture in the given \n"
+    "    ranges of parameters, on --jobs worker threads, and output the \n"
+    "    Pareto front of hardware cost (configuration bits) versus maximum\n"
+    "    and mean error to <name>.pareto. Ranges are comma-separated \n"
+    "    <param>=<first>[:<last>[:<step>]], param being one of \n"
+    "    segmentBits, selectorBits, interpolationBits, plaInterconnects, \n"
+    "    base_bits and incline_bits. Others are taken from --arch, as is \n"
+    "    numSegments unless segmentBits is explored.\n"
+    "    Dominated architectures are not translated.\n"
+    "  --manifest <file>\n"
+    "    add the input files listed in file, one per line and relative to \n"
+    "    its directory. Empty lines and lines starting with # are ignored.\n"
     "  -c|--compile\n"
     "    Input an intermediate format instead of the input format.\n"
     "  --arch <file>\n"
@@ -67,6 +127,12 @@ void options_t::print(FILE *f) {
     "  -w|--weights-test\n"
     "    Input a weights file and sample it into a .dat file, used for \n"
     "    weight distributions.\n"
+    "  --disassemble\n"
+    "    Input a bitstream dump (see -D) and output a listing of the \n"
+    "    configuration it holds: connection plane, PLA, RAM and segments.\n"
+    "  --validate <file>\n"
+    "    Check a disassembled bitstream against the LUT in the given \n"
+    "    intermediate file, failing on any mismatch.\n"
     "  --weight-steps <number>\n"
     "    set the maximum number of samples done when performing a \n"
     "    weights test. default: %i\n"
@@ -77,20 +143,86 @@ void options_t::print(FILE *f) {
     "    platform. default: `%s`\n"
     "  --cmd-compile-target-o <command>\n"
     "    specify the command to use for building object filess on the\n"
-    "    target platform. default: `%s`\n"
+    "    target platform, if enabled by --external-compile or required by\n"
+    "    --delta. default: `%s`\n"
+    "  --external-compile\n"
+    "    build the ELF object by compiling the C output instead of writing\n"
+    "    it directly.\n"
+    "  --elf-class <32|64>\n"
+    "    set the ELF class of objects written directly. default: %i\n"
+    "  --elf-abi <abi>\n"
+    "    set the ABI of objects written directly, one of ilp32, ilp32f,\n"
+    "    ilp32d and ilp32e for --elf-class 32 or lp64, lp64f and lp64d for\n"
+    "    --elf-class 64. Objects can only be linked with code of the same\n"
+    "    floating-point ABI. default: lp64d for --elf-class 64, ilp32 for\n"
+    "    --elf-class 32\n"
     "  -g|--gnuplot\n"
     "    create a gnuplot file for visualizing the target function and\n"
     "    generated segments. Can only be used with input files.\n"
+    "  --pla-exact-max-inputs <number>\n"
+    "    set the maximum number of selector bits for which the PLA is\n"
+    "    minimized by enumerating all prime implicants. Wider selectors use\n"
+    "    a heuristic minimizer. default: %i\n"
+    "  --pla-cover-time-limit <seconds>\n"
+    "    set the time limit for searching a minimum PLA cover if the one\n"
+    "    found greedily exceeds the number of PLA interconnects. 0 disables\n"
+    "    the search. default: %i\n"
+    "  --deterministic\n"
+    "    produce the same output on any machine, regardless of its speed,\n"
+    "    its load and the number of jobs run concurrently. The minimum PLA\n"
+    "    cover search is then bounded by a fixed number of search steps per\n"
+    "    second of --pla-cover-time-limit instead of time.\n"
+    "  --pla-slot-search\n"
+    "    search for an assignment of segments to RAM slots that minimizes\n"
+    "    the PLA even if it fits with segments in order. This is done\n"
+    "    anyway if it does not fit.\n"
+    "  --pla-cache <dir>\n"
+    "    store minimized PLA configurations in dir and reuse them whenever\n"
+    "    the same segments are translated again.\n"
+    "  --incremental\n"
+    "    record the hashes of everything the output depends on in a \n"
+    "    manifest next to it (<output>.manifest) and skip compiling the \n"
+    "    LUT if they match those recorded by the last compilation.\n"
+    "  --stats[=<file>]\n"
+    "    print the number of calls, the wall time and the CPU time of each\n"
+    "    compilation phase and counters such as target function \n"
+    "    evaluations to stderr when done, or write them to file as JSON.\n"
+    "  --target-cache <dir>\n"
+    "    store compiled target functions in dir and reuse them whenever \n"
+    "    the same target code is compiled again.\n"
+    "  --segment-cache <dir>\n"
+    "    store the segments chosen by segmentation strategies in dir and\n"
+    "    reuse them whenever a LUT is segmented the same way again, e.g.\n"
+    "    if only its approximation strategy changed.\n"
+    "  --serve <socket>\n"
+    "    run as a compile server listening on the Unix domain socket \n"
+    "    given, until terminated by SIGINT or SIGTERM. Invocations \n"
+    "    forwarded to the server (see \n"
+    "    " ENV_SERVER ") run in processes forked off it, up\n"
+    "    to --jobs at a time, sharing its PLA, target and segment caches \n"
+    "    unless they specify their own.\n"
+    "  --delta <file>\n"
+    "    output only the words of the bitstream that differ from a reference\n"
+    "    configuration, given as a bitstream dump (see -D) or as an\n"
+    "    intermediate file, together with a function applying them.\n"
     "\n"
     "environment variables:\n"
     "  " ENV_CMD_SO "\n"
     "    set the default for --cmd-compile-so.\n"
     "  " ENV_CMD_TARGET_O "\n"
     "    set the default for --cmd-compile-target-o.\n"
+    "  " ENV_SERVER "\n"
+    "    forward invocations to the compile server listening on the given\n"
+    "    socket, running them locally if it cannot be reached. The two \n"
+    "    variables above are forwarded along with them.\n"
     ,
+    Default_jobs,
     Default_maxWeightSteps,
     Default_cmdCompileSO(),
-    Default_cmdCompileTargetO()
+    Default_cmdCompileTargetO(),
+    Default_elfClass,
+    Default_plaExactMaxInputs,
+    Default_plaCoverTimeLimit
     );
 }
 
@@ -104,7 +236,20 @@ int options_t::parseCommandLine(int argn, const char **argv) {
     WeightSteps,
     WeightsPath,
     CmdCompileSO,
-    CmdCompileTargetO
+    CmdCompileTargetO,
+    PlaExactMaxInputs,
+    PlaCoverTimeLimit,
+    PlaCacheDir,
+    DeltaReference,
+    ElfClass,
+    ElfAbi,
+    Validate,
+    Jobs,
+    Manifest,
+    TargetCacheDir,
+    SegmentCacheDir,
+    ServeSocket,
+    Explore
   };
   state_t state=Idle;
 
@@ -119,8 +264,25 @@ int options_t::parseCommandLine(int argn, const char **argv) {
         if (SWITCH("-i","--intermediate")) fOutputIntermediate=1;
         else if (SWITCH("-C","--output-c")) fOutputC=1;
         else if (SWITCH("-D","--output-dump")) fOutputDump=1;
+        else if (SWITCH("-B","--output-binary")) fOutputBinary=1;
+        else if (SWITCH("-X","--output-hex")) fOutputHex=1;
+        else if (LSWITCH("--big-endian")) fBigEndian=1;
         else if (SWITCH("-c","--compile")) fInputIntermediate=1;
         else if (SWITCH("-w","--weights-test")) fInputWeights=1;
+        else if (LSWITCH("--disassemble")) fDisassemble=1;
+        else if (SWITCH("-m","--combine")) fCombine=1;
+        else if (LSWITCH("--batch")) fBatch=1;
+        else if (LSWITCH("--incremental")) fIncremental=1;
+        else if (LSWITCH("--stats")) fStats=1;
+        else if (LSWITCH("--deterministic")) fDeterministic=1;
+        else if (strncmp("--stats=",argv[i],8)==0) {
+          fStats=1;
+          fnStats=argv[i]+8;
+        }
+        else if (SWITCH("-j","--jobs")) state=Jobs;
+        else if (LSWITCH("--manifest")) state=Manifest;
+        else if (LSWITCH("--explore")) state=Explore;
+        else if (LSWITCH("--validate")) state=Validate;
         else if (SWITCH("-n","--name")) state=Name;
         else if (SWITCH("-o","--output")) state=Output;
         else if (LSWITCH("--arch")) state=Arch;
@@ -131,6 +293,17 @@ int options_t::parseCommandLine(int argn, const char **argv) {
         else if (LSWITCH("--cmd-compile-so")) state=CmdCompileSO;
         else if (LSWITCH("--cmd-compile-target-o")) state=CmdCompileTargetO;
         else if (SWITCH("-g","--gnuplot")) fGenerateGnuplot=1;
+        else if (LSWITCH("--external-compile")) fExternalCompile=1;
+        else if (LSWITCH("--elf-class")) state=ElfClass;
+        else if (LSWITCH("--elf-abi")) state=ElfAbi;
+        else if (LSWITCH("--pla-slot-search")) fPlaSlotSearch=1;
+        else if (LSWITCH("--pla-cache")) state=PlaCacheDir;
+        else if (LSWITCH("--target-cache")) state=TargetCacheDir;
+        else if (LSWITCH("--segment-cache")) state=SegmentCacheDir;
+        else if (LSWITCH("--serve")) state=ServeSocket;
+        else if (LSWITCH("--delta")) state=DeltaReference;
+        else if (LSWITCH("--pla-exact-max-inputs")) state=PlaExactMaxInputs;
+        else if (LSWITCH("--pla-cover-time-limit")) state=PlaCoverTimeLimit;
         else if (SWITCH("-h","--help")) {
           print(stdout);
           return 2;
@@ -138,10 +311,7 @@ int options_t::parseCommandLine(int argn, const char **argv) {
           throw CommandLineError(CommandLineError::UnknownSwitch,argv[i]);
         }
       } else {
-        if (fnInput.len>0) {
-          throw CommandLineError(CommandLineError::StrayArgument,argv[i]);
-        }
-        fnInput=argv[i];
+        fnInputs.push_back(argv[i]);
       }
       break;
     case Name:
@@ -177,6 +347,80 @@ int options_t::parseCommandLine(int argn, const char **argv) {
       state=Idle;
       cmdCompileTargetO=argv[i];
       break;
+    case PlaExactMaxInputs:
+      state=Idle;
+      plaExactMaxInputs=atol(argv[i]);
+      if (plaExactMaxInputs<0)
+        throw CommandLineError(
+          CommandLineError::Semantics,
+          "non-negative number expected for --pla-exact-max-inputs");
+      break;
+    case PlaCoverTimeLimit:
+      state=Idle;
+      plaCoverTimeLimit=atol(argv[i]);
+      if (plaCoverTimeLimit<0)
+        throw CommandLineError(
+          CommandLineError::Semantics,
+          "non-negative number expected for --pla-cover-time-limit");
+      break;
+    case PlaCacheDir:
+      state=Idle;
+      plaCacheDir=argv[i];
+      break;
+    case TargetCacheDir:
+      state=Idle;
+      targetCacheDir=argv[i];
+      break;
+    case SegmentCacheDir:
+      state=Idle;
+      segmentCacheDir=argv[i];
+      break;
+    case ServeSocket:
+      state=Idle;
+      serveSocket=argv[i];
+      break;
+    case DeltaReference:
+      state=Idle;
+      fnDeltaReference=argv[i];
+      break;
+    case Validate:
+      state=Idle;
+      fnValidate=argv[i];
+      break;
+    case Jobs:
+      state=Idle;
+      jobs=atol(argv[i]);
+      if (jobs<0)
+        throw CommandLineError(
+          CommandLineError::Semantics,
+          "non-negative number expected for --jobs");
+      break;
+    case Manifest:
+      state=Idle;
+      parseManifest(argv[i]);
+      break;
+    case Explore: {
+      DesignSpace space;
+      alp::string error;
+      state=Idle;
+      exploreSpec=argv[i];
+      if (!space.parse(exploreSpec.ptr,error))
+        throw CommandLineError(
+          CommandLineError::Semantics,
+          alp::string::Format("--explore: %s",error.ptr));
+      break;
+    }
+    case ElfClass:
+      state=Idle;
+      elfClass=atol(argv[i]);
+      if ((elfClass!=32) && (elfClass!=64))
+        throw CommandLineError(
+          CommandLineError::Semantics,"32 or 64 expected for --elf-class");
+      break;
+    case ElfAbi:
+      state=Idle;
+      elfAbi=argv[i];
+      break;
       
 
     #undef SWITCH
@@ -192,35 +436,155 @@ int options_t::parseCommandLine(int argn, const char **argv) {
     ERRSTATE(Name,"--name")
     ERRSTATE(Arch,"--arch")
     ERRSTATE(WeightSteps,"--weight-steps")
+    ERRSTATE(PlaExactMaxInputs,"--pla-exact-max-inputs")
+    ERRSTATE(PlaCoverTimeLimit,"--pla-cover-time-limit")
+    ERRSTATE(PlaCacheDir,"--pla-cache")
+    ERRSTATE(DeltaReference,"--delta")
+    ERRSTATE(ElfClass,"--elf-class")
+    ERRSTATE(ElfAbi,"--elf-abi")
+    ERRSTATE(Validate,"--validate")
+    ERRSTATE(Jobs,"--jobs")
+    ERRSTATE(Manifest,"--manifest")
+    ERRSTATE(TargetCacheDir,"--target-cache")
+    ERRSTATE(SegmentCacheDir,"--segment-cache")
+    ERRSTATE(ServeSocket,"--serve")
+    ERRSTATE(Explore,"--explore")
 
     default: break;
 
     #undef ERRSTATE
   }
 
-  if (fnInput.len<1) 
+  if (serveSocket.len>0) {
+    if (fnInputs.size()>0)
+      throw CommandLineError(
+        CommandLineError::StrayArgument,fnInputs[0].ptr);
+    return 0;
+  }
+
+  if (fnInputs.size()<1) 
     throw CommandLineError(
       CommandLineError::Semantics,"no input file specified");
 
-  if ((fOutputIntermediate+fOutputC+fOutputDump)>1)
+  if ((fnInputs.size()>1) && !fCombine && !fBatch && (exploreSpec.len==0))
+    throw CommandLineError(
+      CommandLineError::StrayArgument,fnInputs[1].ptr);
+  fnInput=fnInputs[0];
+
+  if (fCombine && 
+      (fOutputIntermediate || fOutputDump || fOutputBinary || fOutputHex ||
+       fInputWeights || fDisassemble || fGenerateGnuplot || 
+       (fnDeltaReference.len>0)))
+    throw CommandLineError(
+      CommandLineError::Semantics,
+      "--combine only supports C and ELF output of LUTs");
+
+  if (fBatch && (fCombine || fInputWeights || fDisassemble))
+    throw CommandLineError(
+      CommandLineError::Semantics,
+      "cannot specify --batch together with --combine, -w or --disassemble");
+
+  if ((exploreSpec.len>0) && 
+      (fCombine || fBatch || fInputWeights || fDisassemble || 
+       fInputIntermediate || fOutputIntermediate || fIncremental))
+    throw CommandLineError(
+      CommandLineError::Semantics,
+      "cannot specify --explore together with --combine, --batch, -w, "
+      "--disassemble, -c, -i or --incremental");
+
+  if ((exploreSpec.len>0) && ((outputName.len>0) || (lutName.len>0)) &&
+      (fnInputs.size()>1))
     throw CommandLineError(
       CommandLineError::Semantics,
-      "cannot specify more then one of -C, -D and -i together");
+      "cannot specify -o or -n when exploring multiple input files");
+
+  if (fIncremental && (fCombine || fInputWeights || fDisassemble))
+    throw CommandLineError(
+      CommandLineError::Semantics,
+      "--incremental is not supported with --combine, -w or --disassemble");
+
+  if (fBatch && ((outputName.len>0) || (lutName.len>0)))
+    throw CommandLineError(
+      CommandLineError::Semantics,
+      "cannot specify --batch together with -o or -n");
+
+  if ((fOutputIntermediate+fOutputC+fOutputDump+fOutputBinary+fOutputHex)>1)
+    throw CommandLineError(
+      CommandLineError::Semantics,
+      "cannot specify more then one of -C, -D, -B, -X and -i together");
+
+  if (fOutputBinary && (fnDeltaReference.len>0))
+    throw CommandLineError(
+      CommandLineError::Semantics,"cannot specify --delta and -B together");
+
+  if (fOutputIntermediate && (fnDeltaReference.len>0))
+    throw CommandLineError(
+      CommandLineError::Semantics,"cannot specify --delta and -i together");
 
   if (fInputIntermediate && fInputWeights)
     throw CommandLineError(
       CommandLineError::Semantics,"cannot specify -c and -w together");
 
+  if (fDisassemble && (fInputIntermediate || fInputWeights))
+    throw CommandLineError(
+      CommandLineError::Semantics,
+      "cannot specify --disassemble together with -c or -w");
+
+  if ((fnValidate.len>0) && !fDisassemble)
+    throw CommandLineError(
+      CommandLineError::Semantics,"--validate requires --disassemble");
+
+  // the class may be given after the ABI
+  if (elfAbi.len==0) elfFlags=ElfWriter::DefaultFlags(elfClass);
+  else if (!ElfWriter::AbiFlags(elfAbi.ptr,elfClass,elfFlags))
+    throw CommandLineError(
+      CommandLineError::Semantics,
+      alp::string::Format(
+        "unknown ABI '%s' for --elf-class %i",elfAbi.ptr,elfClass));
+
 
   return 0;
 }
 
+void options_t::parseManifest(const char *fn) {
+  FILE *f=fopen(fn,"r");
+  char line[4096];
+  alp::string dir;
+
+  if (!f) 
+    throw CommandLineError(
+      CommandLineError::Semantics,
+      alp::string::Format("unable to read manifest %s",fn));
+
+  for(const char *p=fn;*p;p++) 
+    if (*p=='/') dir=alp::string(fn,(size_t)(p-fn+1));
+
+  while(fgets(line,sizeof(line),f)) {
+    char *s=line, *e=line+strlen(line);
+    while((*s==' ') || (*s=='\t')) s++;
+    while((e>s) && ((e[-1]=='\n') || (e[-1]=='\r') || (e[-1]==' ') || 
+      (e[-1]=='\t'))) e--;
+    *e=0;
+    if ((*s==0) || (*s=='#')) continue;
+
+    if (*s=='/') {
+      fnInputs.push_back(s);
+    } else {
+      fnInputs.push_back(dir+s);
+    }
+  }
+  fclose(f);
+}
+
 void options_t::computeOutputName() {
   if (outputName.len>0) return;
   
   if (!fInputWeights && (lutName.len>0)) {
     outputName=lutName;
     outputBase=lutName;
+  } else if (fCombine) {
+    outputName="luts";
+    outputBase="luts";
   } else {
     outputName=fnInput;
     for(ssize_t i=(ssize_t)fnInput.len-1;i>-1;i--)
@@ -240,10 +604,18 @@ void options_t::computeOutputName() {
 
   if (fInputWeights) {
     outputName+=".dat";
+  } else if (fDisassemble) {
+    outputName+=".lst";
+  } else if (exploreSpec.len>0) {
+    outputName+=".pareto";
   } else if (fOutputIntermediate) {
     outputName+=".lut";
   } else if (fOutputDump) {
     outputName+=".dump";
+  } else if (fOutputBinary) {
+    outputName+=".bin";
+  } else if (fOutputHex) {
+    outputName+=".hex";
   } else if (fOutputC) {
     outputName+=".c";
   } else {
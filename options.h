@@ -4,9 +4,11 @@
 #include <alpha/alpha.h>
 #include "vfs.h"
 #include <stdio.h>
+#include <vector>
 
 #define ENV_CMD_SO "RISCV_LUT_COMPILER_CMD_SO"
 #define ENV_CMD_TARGET_O "RISCV_LUT_COMPILER_CMD_TARGET_O"
+#define ENV_SERVER "RISCV_LUT_COMPILER_SERVER"
 
 /** Structure defining per-invocation options, specified via the command line
   * and holding an arch_config_t potentially loaded as a result of command-line
@@ -23,6 +25,10 @@
 struct options_t {
   enum {
     Default_maxWeightSteps = 1000,
+    Default_plaExactMaxInputs = 10,
+    Default_plaCoverTimeLimit = 10,
+    Default_elfClass = 64,
+    Default_jobs = 0,
   };
   static const char *Default_cmdCompileSO() { return "gcc -g -fPIC -shared"; }
   static const char *Default_cmdCompileTargetO() { 
@@ -33,16 +39,111 @@ struct options_t {
   
   int fInputIntermediate;
   int fInputWeights;
+  /** Input a bitstream dump and output a listing of its configuration */
+  int fDisassemble;
+  /** Compile all input files and output their configurations together,
+    * sharing identical bitstream sections.
+    */
+  int fCombine;
+  /** Compile each of the input files into its own output */
+  int fBatch;
+  /** Skip compiling LUTs whose output is up to date according to its
+    * manifest, and write manifests of compiled outputs.
+    */
+  int fIncremental;
+  /** Report timing and counters of the compilation phases */
+  int fStats;
+  /** Number of worker threads compiling LUTs in batch and exploration 
+    * mode and of jobs run concurrently by a compile server, 0 for one per
+    * hardware thread.
+    */
+  int jobs;
 
   int fOutputIntermediate;
   int fOutputC;
   int fOutputDump;
+  int fOutputBinary;
+  int fOutputHex;
+  /** Store words of binary output most significant byte first */
+  int fBigEndian;
   
   int maxWeightSteps;
 
   int fGenerateGnuplot;
+
+  /** Build ELF objects by compiling the C output with cmdCompileTargetO
+    * instead of writing them directly.
+    */
+  int fExternalCompile;
+  /** ELF class (32 or 64) of objects written directly */
+  int elfClass;
+  /** ABI of objects written directly, as accepted by gcc's -mabi. The
+    * default ABI of elfClass if empty, see ElfWriter::DefaultFlags.
+    */
+  alp::string elfAbi;
+  /** ELF header flags of objects written directly, computed from elfClass
+    * and elfAbi by parseCommandLine.
+    */
+  uint32_t elfFlags;
+
+  /** Always search for an assignment of segments to RAM slots minimizing
+    * the PLA, not only if it does not fit otherwise.
+    */
+  int fPlaSlotSearch;
+
+  /** Maximum number of selector bits for which the PLA configuration is
+    * minimized by enumerating all prime implicants. Beyond that, a heuristic
+    * minimizer is used.
+    */
+  int plaExactMaxInputs;
+  /** Time limit, in seconds, for searching an exact minimum PLA cover in 
+    * case the greedily chosen one exceeds the available interconnects. 0 
+    * disables the search.
+    */
+  int plaCoverTimeLimit;
+  /** Make the output independent of the speed and load of the machine and
+    * thus of the number of jobs run concurrently, by bounding the exact PLA
+    * cover search by a number of search steps instead of 
+    * plaCoverTimeLimit seconds.
+    */
+  int fDeterministic;
+  /** Directory for caching PLA minimization results across invocations. 
+    * Not used if empty.
+    */
+  alp::string plaCacheDir;
+  /** Directory for caching compiled target functions across invocations.
+    * Not used if empty.
+    */
+  alp::string targetCacheDir;
+  /** Directory for caching segmentation results across invocations. Not
+    * used if empty.
+    */
+  alp::string segmentCacheDir;
+  /** Ranges of architecture parameters to compile each input file for,
+    * outputting the Pareto front of hardware cost and error instead of
+    * a configuration, see DesignSpace. Not exploring if empty.
+    */
+  alp::string exploreSpec;
+  /** Unix domain socket to serve compile jobs on. Not serving if empty. */
+  alp::string serveSocket;
+  /** Reference configuration to output the bitstream as a delta against,
+    * either a bitstream dump or an intermediate file. Not used if empty.
+    */
+  alp::string fnDeltaReference;
+  /** Intermediate file to check a disassembled bitstream against. Not used
+    * if empty.
+    */
+  alp::string fnValidate;
+  /** JSON file to write statistics to instead of printing them, see 
+    * fStats. Not used if empty.
+    */
+  alp::string fnStats;
   
   alp::string fnInput;
+  /** All input files, fnInput being the first. Only --combine, --batch and
+    * --explore accept more than one.
+    */
+  std::vector<alp::string> fnInputs;
   alp::string fnArch;
   alp::string lutName;
   alp::string outputName;
@@ -84,12 +185,25 @@ struct options_t {
     * \throw CommandLineError The command line is invalid.
     */
   int parseCommandLine(int argn, const char **argv);
+
+  /** Adds the input files listed in a manifest file to fnInputs.
+    *
+    * The manifest lists one file per line, relative to the directory of the
+    * manifest unless absolute. Empty lines and lines starting with '#' are
+    * ignored.
+    *
+    * \throw CommandLineError The manifest could not be read.
+    */
+  void parseManifest(const char *fn);
   
   /** Computes the name of the program run's output file depending on
     * input names and process options.
     *
     * Generates a ```.dat``` file name for weight file tests, ```.lut``` for
-    * intermediate files, ```.c``` for c-code files and ```.o``` for ELF files.
+    * intermediate files, ```.c``` for c-code files, ```.pareto``` for 
+    * design-space exploration and ```.o``` for ELF files.
+    * Combined output is named after the LUT identifier given or 
+    * ```luts``` otherwise.
     */
   void computeOutputName();
 
@@ -0,0 +1,238 @@
+#include "output-stream.h"
+#include <assert.h>
+#include <algorithm>
+
+OutputStream::OutputStream(const char *fn) :
+  _f(NULL), _str(NULL), _fn(fn), _len(0), _failed(false) {
+  _f=fopen(fn,"wb");
+  if (!_f) throw FileIOException(fn);
+}
+
+OutputStream::OutputStream(alp::string &res) :
+  _f(NULL), _str(&res), _len(0), _failed(false) {
+
+}
+
+OutputStream::~OutputStream() {
+  _flush();
+  if (_f) fclose(_f);
+}
+
+void OutputStream::close() {
+  _flush();
+  if (_f) {
+    if (fclose(_f)!=0) _failed=true;
+    _f=NULL;
+  }
+  _str=NULL;
+  if (_failed) throw FileIOException(_fn);
+}
+
+void OutputStream::_flush() {
+  if (_len>0) _write_through(_buf,_len);
+  _len=0;
+}
+
+void OutputStream::_write_through(const void *p, size_t n) {
+  if (_f) {
+    if (fwrite(p,1,n,_f)<n) _failed=true;
+  } else if (_str) {
+    _str->append((const char*)p,n);
+  }
+}
+
+void OutputStream::putDecimal(uint64_t v) {
+  static const char pairs[]=
+    "0001020304050607080910111213141516171819"
+    "2021222324252627282930313233343536373839"
+    "4041424344454647484950515253545556575859"
+    "6061626364656667686970717273747576777879"
+    "8081828384858687888990919293949596979899";
+  char buf[20];
+  char *p=buf+sizeof(buf);
+
+  while(v>=100) {
+    p-=2;
+    memcpy(p,pairs+2*(v%100),2);
+    v/=100;
+  }
+  if (v>=10) {
+    p-=2;
+    memcpy(p,pairs+2*v,2);
+  } else {
+    *--p='0'+v;
+  }
+  write(p,buf+sizeof(buf)-p);
+}
+
+void OutputStream::putHex(uint64_t v, int digits, bool upper) {
+  const char *hex=upper ? "0123456789ABCDEF" : "0123456789abcdef";
+  char buf[16];
+  int n=0;
+
+  assert(digits<=16);
+  do {
+    buf[15-n++]=hex[v&0xf];
+    v>>=4;
+  } while(v || (n<digits));
+  write(buf+16-n,n);
+}
+
+void BitstreamWriter::Dump(OutputStream &out, const uint64_t *words, size_t n) {
+  for(size_t i=0;i<n;i++) {
+    out.putDecimal(words[i]);
+    out.put('\n');
+  }
+}
+
+void BitstreamWriter::Binary(
+  OutputStream &out, const uint64_t *words, size_t n, int word_size,
+  bool big_endian) {
+  size_t bytes=(word_size+7)/8;
+  uint8_t buf[8];
+
+  assert(bytes<=8);
+  for(size_t i=0;i<n;i++) {
+    for(size_t j=0;j<bytes;j++) {
+      uint8_t b=(uint8_t)(words[i]>>(8*j));
+      buf[big_endian ? bytes-1-j : j]=b;
+    }
+    out.write(buf,bytes);
+  }
+}
+
+const char *BitstreamWriter::CType(int word_size) {
+  switch(word_size) {
+    case 32: return "uint32_t";
+    case 64: return "uint64_t";
+    default:
+      assert(0 && "unsupported target word size");
+  }
+  return NULL;
+}
+
+void BitstreamWriter::CWord(OutputStream &out, uint64_t word, int word_size) {
+  out.puts("0x");
+  switch(word_size) {
+    case 32:
+      out.putHex(word&0xffffffff,8);
+      out.puts("ul");
+      break;
+    case 64:
+      out.putHex(word,16);
+      out.puts("uL");
+      break;
+    default:
+      assert(0 && "unsupported target word size");
+  }
+}
+
+void BitstreamWriter::CArray(
+  OutputStream &out, const char *name, const uint64_t *words, size_t n,
+  int word_size) {
+  out.puts("const ");
+  out.puts(CType(word_size));
+  out.put(' ');
+  out.puts(name);
+  out.put('[');
+  out.putDecimal(n);
+  out.puts("]={");
+  for(size_t i=0;i<n;i++) {
+    if (i>0) out.put(',');
+    CWord(out,words[i],word_size);
+  }
+  out.puts("};\n");
+}
+
+void IntelHexWriter::_record(
+  uint8_t type, uint16_t addr, const uint8_t *data, size_t n) {
+  uint8_t sum=n+(addr>>8)+(addr&0xff)+type;
+
+  assert(n<256);
+  _out.put(':');
+  _out.putHex(n,2,true);
+  _out.putHex(addr,4,true);
+  _out.putHex(type,2,true);
+  for(size_t i=0;i<n;i++) {
+    _out.putHex(data[i],2,true);
+    sum+=data[i];
+  }
+  _out.putHex((uint8_t)-sum,2,true);
+  _out.put('\n');
+}
+
+void IntelHexWriter::data(uint32_t addr, const uint8_t *p, size_t n) {
+  while(n>0) {
+    // records must not cross 64 KiB boundaries
+    size_t c=std::min(n,(size_t)16);
+    c=std::min(c,(size_t)0x10000-(addr&0xffff));
+
+    if ((addr>>16)!=_upper) {
+      uint8_t ext[2]={ (uint8_t)(addr>>24), (uint8_t)(addr>>16) };
+      _upper=addr>>16;
+      _record(4,0,ext,2);
+    }
+    _record(0,addr&0xffff,p,c);
+    addr+=c;
+    p+=c;
+    n-=c;
+  }
+}
+
+void IntelHexWriter::words(
+  size_t first, const uint64_t *w, size_t n, int word_size) {
+  size_t bytes=(word_size+7)/8;
+  uint8_t buf[16*8];
+
+  assert(bytes<=8);
+  for(size_t i=0;i<n;) {
+    size_t c=std::min(n-i,(size_t)16);
+    for(size_t j=0;j<c;j++)
+      for(size_t k=0;k<bytes;k++)
+        buf[j*bytes+k]=(uint8_t)(w[i+j]>>(8*k));
+    data((first+i)*bytes,buf,c*bytes);
+    i+=c;
+  }
+}
+
+void IntelHexWriter::end() {
+  _record(1,0,NULL,0);
+}
+
+unittest(
+  /*
+    testing:
+      OutputStream::putDecimal
+      OutputStream::putHex
+      IntelHexWriter::data
+  */
+  alp::string s;
+  {
+    OutputStream out(s);
+    out.putDecimal(0);
+    out.put(' ');
+    out.putDecimal(18446744073709551615uL);
+    out.put(' ');
+    out.putDecimal(1009);
+    out.put(' ');
+    out.putHex(0xab,4);
+    out.close();
+  }
+  Assertf(
+    strcmp(s.ptr,"0 18446744073709551615 1009 00ab")==0,
+    "unexpected formatted integers '%s'", s.ptr);
+
+  s.clear();
+  {
+    const uint8_t data[3]={ 0x01, 0x02, 0x03 };
+    OutputStream out(s);
+    IntelHexWriter hex(out);
+    hex.data(0xfffe,data,3);
+    hex.end();
+    out.close();
+  }
+  Assertf(
+    strcmp(s.ptr,
+      ":02FFFE000102FE\n:020000040001F9\n:0100000003FC\n:00000001FF\n")==0,
+    "unexpected Intel HEX output '%s'", s.ptr);
+);
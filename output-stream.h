@@ -0,0 +1,137 @@
+/** \file output-stream.h
+  * \brief Buffered output streams and writers for bitstream output formats.
+  */
+#ifndef RISCV_LUT_COMPULER_OUTPUT_STREAM_H
+#define RISCV_LUT_COMPULER_OUTPUT_STREAM_H
+
+#include "error.h"
+
+#include <alpha/alpha.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+
+/** Buffered output to a file or string.
+  *
+  * Output is collected in a fixed buffer and passed on whenever it is full,
+  * so that large outputs are neither formatted into intermediate strings
+  * nor written in many small pieces.
+  */
+class OutputStream {
+  public:
+    enum {
+      BufferSize = 65536
+    };
+
+  protected:
+    FILE *_f;
+    alp::string *_str;
+    alp::string _fn;
+    char _buf[BufferSize];
+    size_t _len;
+    bool _failed;
+
+    void _flush();
+    void _write_through(const void *p, size_t n);
+
+  public:
+    /** Opens the file fn for writing.
+      *
+      * \throw FileIOException The file could not be opened.
+      */
+    OutputStream(const char *fn);
+    /** Appends all output to res. */
+    OutputStream(alp::string &res);
+    /** Flushes and closes the stream, ignoring errors. */
+    ~OutputStream();
+
+    /** Flushes and closes the stream.
+      *
+      * \throw FileIOException The output could not be written.
+      */
+    void close();
+
+    void write(const void *p, size_t n) {
+      if (_len+n>BufferSize) {
+        _flush();
+        if (n>BufferSize) {
+          _write_through(p,n);
+          return;
+        }
+      }
+      memcpy(_buf+_len,p,n);
+      _len+=n;
+    }
+    void put(char c) {
+      if (_len==BufferSize) _flush();
+      _buf[_len++]=c;
+    }
+    void puts(const char *s) { write(s,strlen(s)); }
+
+    /** Writes the decimal representation of v */
+    void putDecimal(uint64_t v);
+    /** Writes the hexadecimal representation of v with at least digits
+      * digits.
+      */
+    void putHex(uint64_t v, int digits=1, bool upper=false);
+};
+
+/** Writers for the output formats of configuration bitstreams.
+  *
+  * Words are wordSize bits wide. Binary formats store each word in the
+  * least number of bytes holding that many bits.
+  */
+class BitstreamWriter {
+  public:
+    /** Writes the decimal representation of each word, one per line */
+    static void Dump(OutputStream &out, const uint64_t *words, size_t n);
+
+    /** Writes the words as raw binary data */
+    static void Binary(
+      OutputStream &out, const uint64_t *words, size_t n, int word_size,
+      bool big_endian=false);
+
+    /** Writes the definition of a constant C array of the words.
+      *
+      * \param word_size 32 or 64, the width of the array elements
+      */
+    static void CArray(
+      OutputStream &out, const char *name, const uint64_t *words, size_t n,
+      int word_size);
+
+    /** Writes a single C array element, in the format used by CArray */
+    static void CWord(OutputStream &out, uint64_t word, int word_size);
+
+    /** Returns the C type of words of the given size */
+    static const char *CType(int word_size);
+};
+
+/** Writer for Intel HEX files.
+  *
+  * Data is written as records of up to 16 bytes, with extended linear
+  * address records as required for addresses beyond 64 KiB. The end of file
+  * record is written by end.
+  */
+class IntelHexWriter {
+  protected:
+    OutputStream &_out;
+    uint32_t _upper;
+
+    void _record(uint8_t type, uint16_t addr, const uint8_t *data, size_t n);
+
+  public:
+    IntelHexWriter(OutputStream &out) : _out(out), _upper(0) {
+
+    }
+
+    /** Writes n bytes of data to address addr */
+    void data(uint32_t addr, const uint8_t *p, size_t n);
+
+    /** Writes n words at word index first, little endian */
+    void words(size_t first, const uint64_t *w, size_t n, int word_size);
+
+    /** Writes the end of file record */
+    void end();
+};
+
+#endif
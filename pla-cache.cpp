@@ -0,0 +1,172 @@
+#include "pla-cache.h"
+#include "util.h"
+#include <unordered_map>
+#include <vector>
+#include <mutex>
+#include <atomic>
+#include <stdio.h>
+#include <unistd.h>
+
+// bump whenever the meaning of cached entries changes
+#define PLA_CACHE_VERSION 2
+
+static std::unordered_map<PLACache::key_t,std::vector<QMC::implicant_t> > 
+  _entries;
+static std::mutex _entries_lock;
+static std::atomic<unsigned> _n_tmp_files(0);
+
+static void _append(PLACache::key_t &key, uint32_t v) {
+  key.append((const char*)&v,sizeof(v));
+}
+
+/** Returns the file name of the on-disk entry for key */
+static alp::string _file_name(
+  const PLACache::key_t &key, const alp::string &dir) {
+  uint64_t h=hash_fnv1a(key.data(),key.size());
+  return alp::string::Format("%s/%.16lx.pla",dir.ptr,(unsigned long)h);
+}
+
+PLACache::key_t PLACache::Key(
+  const alp::array_t<segment_t> &segments, const uint32_t *slots,
+  const arch_config_t &arch, int exact_max_inputs, int cover_time_limit,
+  bool deterministic) {
+  key_t key;
+  _append(key,PLA_CACHE_VERSION);
+  _append(key,arch.selectorBits);
+  _append(key,arch.plaInterconnects);
+  _append(key,exact_max_inputs);
+  _append(key,cover_time_limit);
+  _append(key,(uint32_t)deterministic);
+  _append(key,segments.len);
+  for(size_t i=0;i<segments.len;i++) {
+    _append(key,segments[i].prefix);
+    _append(key,segments[i].width);
+    _append(key,slots[i]);
+  }
+  return key;
+}
+
+bool PLACache::Lookup(
+  const key_t &key, const alp::string &dir, 
+  alp::array_t<QMC::implicant_t> &res) {
+  
+  res.setlen(0);
+  {
+    std::lock_guard<std::mutex> lock(_entries_lock);
+    auto it=_entries.find(key);
+    if (it!=_entries.end()) {
+      res.insert((QMC::implicant_t*)it->second.data(),it->second.size());
+      return true;
+    }
+  }
+  if (dir.len==0) return false;
+
+  FILE *f=fopen(_file_name(key,dir).ptr,"rb");
+  if (!f) return false;
+  
+  // the file starts with the full key to rule out hash collisions
+  uint64_t cb_key=0, n=0;
+  std::string stored;
+  bool ok=
+    (fread(&cb_key,sizeof(cb_key),1,f)==1) && (cb_key==key.size());
+  if (ok) {
+    stored.resize(cb_key);
+    ok=(fread(&stored[0],1,cb_key,f)==cb_key) && (stored==key) &&
+      (fread(&n,sizeof(n),1,f)==1);
+  }
+  for(uint64_t i=0;ok && (i<n);i++) {
+    QMC::implicant_t m;
+    ok=(fread(&m.value,sizeof(uint64_t),1,f)==1) &&
+      (fread(&m.care,sizeof(uint64_t),1,f)==1) &&
+      (fread(&m.impl,sizeof(uint64_t),1,f)==1);
+    m.ones=__builtin_popcountll(m.value);
+    m.color=0;
+    if (ok) res.insert(m);
+  }
+  fclose(f);
+  if (!ok) {
+    res.setlen(0);
+    return false;
+  }
+
+  std::lock_guard<std::mutex> lock(_entries_lock);
+  _entries[key].assign(res.ptr,res.ptr+res.len);
+  return true;
+}
+
+void PLACache::Store(
+  const key_t &key, const alp::string &dir,
+  const alp::array_t<QMC::implicant_t*> &implicants) {
+  
+  {
+    std::lock_guard<std::mutex> lock(_entries_lock);
+    std::vector<QMC::implicant_t> &e=_entries[key];
+    e.clear();
+    for(size_t i=0;i<implicants.len;i++) e.push_back(*implicants[i]);
+  }
+  if (dir.len==0) return;
+  
+  // write to a temporary file first so that concurrent readers never see a
+  // partial entry
+  alp::string fn=_file_name(key,dir);
+  alp::string fn_tmp=alp::string::Format(
+    "%s.%i.%u.tmp",fn.ptr,(int)getpid(),_n_tmp_files++);
+  FILE *f=fopen(fn_tmp.ptr,"wb");
+  if (!f) return;
+  
+  uint64_t cb_key=key.size(), n=implicants.len;
+  bool ok=
+    (fwrite(&cb_key,sizeof(cb_key),1,f)==1) &&
+    (fwrite(key.data(),1,cb_key,f)==cb_key) &&
+    (fwrite(&n,sizeof(n),1,f)==1);
+  for(size_t i=0;ok && (i<implicants.len);i++) {
+    ok=(fwrite(&implicants[i]->value,sizeof(uint64_t),1,f)==1) &&
+      (fwrite(&implicants[i]->care,sizeof(uint64_t),1,f)==1) &&
+      (fwrite(&implicants[i]->impl,sizeof(uint64_t),1,f)==1);
+  }
+  ok=(fclose(f)==0) && ok;
+  if (!ok || (rename(fn_tmp.ptr,fn.ptr)!=0)) unlink(fn_tmp.ptr);
+}
+
+void PLACache::Clear() {
+  std::lock_guard<std::mutex> lock(_entries_lock);
+  _entries.clear();
+}
+
+unittest(
+  /*
+    testing:
+      PLACache::Key
+      PLACache::Lookup
+      PLACache::Store
+  */
+  arch_config_t arch;
+  alp::array_t<segment_t> segments;
+  segments.insert(segment_t(0,3));
+  segments.insert(segment_t(3,5));
+  uint32_t slots[]={ 0, 1 }, slots_swapped[]={ 1, 0 };
+  
+  PLACache::key_t key=PLACache::Key(segments,slots,arch,10,10);
+  Assertf(
+    key!=PLACache::Key(segments,slots_swapped,arch,10,10),
+    "expected different keys for different slot assignments");
+  
+  QMC qmc(3);
+  for(size_t i=3;i<8;i++) qmc.add_term(i,1);
+  qmc.minimize();
+
+  TempDir tmp;
+  alp::array_t<QMC::implicant_t> res;
+  Assertf(!PLACache::Lookup(key,tmp.path(),res), "unexpected cache hit");
+  PLACache::Store(key,tmp.path(),qmc.implicants());
+  PLACache::Clear();
+  Assertf(PLACache::Lookup(key,tmp.path(),res), "expected on-disk entry");
+  Assertf(res.len==qmc.implicants().len, "implicant count mismatch");
+  for(size_t i=0;i<res.len;i++)
+    Assertf(
+      (res[i].value==qmc.implicants()[i]->value) &&
+      (res[i].care==qmc.implicants()[i]->care) &&
+      (res[i].impl==qmc.implicants()[i]->impl),
+      "implicant %zu differs",i);
+  PLACache::Clear();
+);
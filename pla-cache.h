@@ -0,0 +1,63 @@
+/** \file pla-cache.h
+  * \brief Memoization of PLA minimization results.
+  */
+#ifndef RISCV_LUT_COMPULER_PLA_CACHE_H
+#define RISCV_LUT_COMPULER_PLA_CACHE_H
+
+#include "error.h"
+#include "segment.h"
+#include "arch-config.h"
+#include "qmc2.h"
+
+#include <alpha/alpha.h>
+#include <string>
+
+/** Cache of minimized PLA configurations.
+  *
+  * The implicants chosen for the PLA only depend on the selector width, the
+  * segment boundaries, the RAM slot of each segment and the options steering
+  * minimization. These are encoded into a canonical key, which maps to the 
+  * resulting list of implicants.
+  *
+  * Entries are kept in memory for the lifetime of the process. If a
+  * directory is given, they are also stored there, one file per key, so 
+  * that they are available to later invocations. Failing to access the
+  * directory is not an error, the entry is then simply not cached on disk.
+  *
+  * All methods may be called concurrently.
+  */
+class PLACache {
+  public:
+    typedef std::string key_t;
+
+    /** Computes the key of mapping segment i to RAM slot slots[i], 
+      * deterministic telling whether cover_time_limit stands for a number of
+      * search steps (see options_t::fDeterministic).
+      */
+    static key_t Key(
+      const alp::array_t<segment_t> &segments, const uint32_t *slots,
+      const arch_config_t &arch, int exact_max_inputs, int cover_time_limit,
+      bool deterministic=false);
+
+    /** Looks up the implicants stored for key.
+      *
+      * \param dir Directory of the on-disk cache, none if empty
+      * \return true iff an entry was found
+      */
+    static bool Lookup(
+      const key_t &key, const alp::string &dir, 
+      alp::array_t<QMC::implicant_t> &res);
+
+    /** Stores implicants for key.
+      *
+      * \param dir Directory of the on-disk cache, none if empty
+      */
+    static void Store(
+      const key_t &key, const alp::string &dir,
+      const alp::array_t<QMC::implicant_t*> &implicants);
+
+    /** Drops all entries held in memory */
+    static void Clear();
+};
+
+#endif
@@ -30,23 +30,19 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA*/
 #include "error.h"
 using namespace std;
 
-int MIN_BITS = 1;   //minimum bits to print
-vector<unsigned> input_values;  
-bool show_mid = false;    //show middle process
-
-vector<vector<B_number> > table;  //original table
-vector<vector<B_number> > p_group;  //mid process table
-vector<vector<B_number> > final_group;  //final table
-vector<B_number> printed_numbers; //avoid printing the same final numbers 
-vector<B_number> written_numbers; //avoid rewriting the same config on further
-                                  //interconnects
-
+PLAGenerator::PLAGenerator( BitstreamImage &img, int arch_selectorBits,
+                            int arch_segmentBits, int arch_plaInterconnects) :
+  img(img),
+  arch_selectorBits(arch_selectorBits),
+  arch_segmentBits(arch_segmentBits),
+  arch_plaInterconnects(arch_plaInterconnects),
+  MIN_BITS(1),
+  show_mid(false) {
 
+}
 
-void qmc_pla_gen( int* current_interconnect, int current_segment,
-                  segment_t* subseg, char* and_plane_conf, char* or_plane_conf,
-                  int arch_selectorBits, int arch_segmentBits,
-                  int arch_plaInterconnects){
+void PLAGenerator::qmc_pla_gen( int* current_interconnect, 
+                                int current_segment, segment_t* subseg){
   /**
     * Generate configuration for the PLA for one segment.
     * current_interconnect points to the current index of
@@ -56,8 +52,7 @@ void qmc_pla_gen( int* current_interconnect, int current_segment,
 
   getinput( subseg);
   if (MIN_BITS<arch_segmentBits) MIN_BITS=arch_segmentBits;
-  init( current_interconnect, current_segment, and_plane_conf, or_plane_conf,
-        arch_selectorBits, arch_segmentBits,arch_plaInterconnects);
+  init( current_interconnect, current_segment);
 }
 
 /* counts 1s by getting the LSB (%2) and then shifting until 0 */
@@ -75,7 +70,7 @@ unsigned count_1s(unsigned number) {
 }
 /*get LSB, arrange it in array, the print array in reverse order so MSB is on
 the left */
-void print_binary(unsigned number) {
+void PLAGenerator::print_binary(unsigned number) {
   unsigned bits[MIN_BITS];
   int count = 0;
   
@@ -89,7 +84,7 @@ void print_binary(unsigned number) {
 }
 /*creating first table: append current number to the array located in
 table[number of 1s f this number]*/
-void create_table() {
+void PLAGenerator::create_table() {
   short tmp;
   B_number temp_num;
   for(size_t i=0;i<input_values.size();i++) {
@@ -102,7 +97,7 @@ void create_table() {
   }
 }
 
-void print_table() {
+void PLAGenerator::print_table() {
   
   cout<<endl<<"COMPUTING:"<<endl;
   for(size_t i=0;i<table.size();i++) {
@@ -126,7 +121,7 @@ B_number init_B_number(unsigned n,int d, bool u) {
 /*like the original table, but the paring of numbers from the original table-
 dashes are represented by a 1. for example original A=0011 B=1011, new number 
 is -011 which is represented as C.number=A&B=0011,C.dashes=A^B=1000*/
-void create_p_group() {
+void PLAGenerator::create_p_group() {
   short tmp;
   B_number temp_num;
   unsigned temp_number, temp_dashes;
@@ -154,7 +149,7 @@ void create_p_group() {
   }
 }
 
-void print_p_group() {
+void PLAGenerator::print_p_group() {
   cout<<endl<<"MID PROCESS COMPUTATION:"<<endl;
   
   for(size_t i=0;i<p_group.size();i++) {
@@ -170,7 +165,7 @@ void print_p_group() {
 }
 /*print a number such as -001; this allocates bits in an array dash=2 then 
 prints reverse array */
-void print_p_binary(unsigned n, unsigned d) {
+void PLAGenerator::print_p_binary(unsigned n, unsigned d) {
   unsigned bits[MIN_BITS];
   int count = 0;
   
@@ -195,7 +190,7 @@ void print_p_binary(unsigned n, unsigned d) {
 A=-001 B=-011 -> C= -0-1 which will be represented as 
 C.number=A&B=0001&0011=0001, and C.dashes=A^B^A.dashes=0001^0011^1000=1010. 
 Computation is done only when A.dashes = b.dashes*/
-void create_final_group() {
+void PLAGenerator::create_final_group() {
   short tmp;
   B_number temp_num;
   unsigned temp_number, temp_dashes;
@@ -226,7 +221,7 @@ void create_final_group() {
 }
 /*print all the values from the final table, except for duplicates.
   print all the unused numbers from original table and mid process table*/
-void print_final_group() {
+void PLAGenerator::print_final_group() {
   //cout<<endl<<"FINAL:\n-------------------------------------"<<endl;
   size_t i,j;
   for(i=0;i<final_group.size();i++) {
@@ -257,7 +252,7 @@ void print_final_group() {
   //cout<<"-------------------------------------"<<endl;
 }
 /*used to avoid printing duplicates that can exist in the final table*/
-bool is_printed(B_number n) {
+bool PLAGenerator::is_printed(B_number n) {
   for(size_t i=0;i<printed_numbers.size();i++)
     if(n.number==printed_numbers[i].number && n.dashes == printed_numbers[i].dashes)
       return true;
@@ -266,7 +261,7 @@ bool is_printed(B_number n) {
 }
 
 /*used to avoid writing the same config on further interconnects*/
-bool is_written(B_number n) {
+bool PLAGenerator::is_written(B_number n) {
   for(size_t i=0;i<written_numbers.size();i++)
     if(n.number==written_numbers[i].number && n.dashes == written_numbers[i].dashes)
       return true;
@@ -274,77 +269,43 @@ bool is_written(B_number n) {
   return false;
 }
 
-void write_interconnect(unsigned n, unsigned d, int* current_interconnect,
-                       int current_segment, char* and_plane_conf,
-                       char* or_plane_conf, int arch_selectorBits,
-                       int arch_segmentBits, int arch_plaInterconnects){
-  int count = 0;
-  unsigned bits[arch_selectorBits];
-
+void PLAGenerator::write_interconnect(unsigned n, unsigned d, 
+                                      int* current_interconnect,
+                                      int current_segment){
   if (*current_interconnect>=arch_plaInterconnects)
     throw HWResourceExceededError(HWResourceExceededError::PLAInterconnects);
 
-  // transfer Minterm from n (containing 1 or 0),
-  // and d (containing don't-cares) into
-  // containing an field for each bit.
-  while(count<arch_selectorBits) {
-    if(!(d%2)) // if last bit don't-care not set:
-      bits[count] = n%2; //last bit 1 or 0
-    else
-      bits[count] = 2; //don't-care encoded as 2
+  // config and-plane for one interconnect from Minterm n (containing 1 or 0)
+  // and d (containing don't-cares):
+  // inverted selector lines are connected for 0 bits, then normal selector
+  // lines for 1 bits, none for don't-cares
+  uint64_t mask=(arch_selectorBits<64) ? (1uL<<arch_selectorBits)-1 : ~0uL;
+  img.setField(
+    BitstreamLayout::AND_INVERTED,*current_interconnect,
+    ~(uint64_t)n&~(uint64_t)d&mask);
+  img.setField(
+    BitstreamLayout::AND_NORMAL,*current_interconnect,
+    (uint64_t)n&~(uint64_t)d&mask);
 
-    n >>= 1; //remove last bit from binary input
-    d >>= 1; //remove last bit from don't-care input
-    count++;
-  }
-  // config and-plane for one interconnect
-  // normal, then inverted selector lines
-  //printf("AND plane protocol: ");
-  for(int i=0;i<count;i++){
-    //cout << "and-normal-index: " << *current_interconnect*2*arch_selectorBits+i;
-    //cout << ", and-inverted-index: " << (*current_interconnect*2+1)*arch_selectorBits+i << endl;
-    if(bits[i]==1){ // normal selector line must be connected
-      //and_plane_conf[*current_interconnect*2*arch_selectorBits+i]=true;
-      and_plane_conf[*current_interconnect*2*arch_selectorBits+i]=false;
-      and_plane_conf[(*current_interconnect*2+1)*arch_selectorBits+i]=true;
-    }else if(bits[i]==0){ // inverted selector line must be connected
-      and_plane_conf[*current_interconnect*2*arch_selectorBits+i]=true;
-      and_plane_conf[(*current_interconnect*2+1)*arch_selectorBits+i]=false;
-      //and_plane_conf[(*current_interconnect*2+1)*arch_selectorBits+i]=false;
-    }else{ // don't-care: both must not be connected
-      and_plane_conf[*current_interconnect*2*arch_selectorBits+i]=false;
-      and_plane_conf[(*current_interconnect*2+1)*arch_selectorBits+i]=false;
-    }
-  }
   // config or-plane for that same interconnect
-  int tmp_cs = current_segment;
-  //cout << "and plane written, current_segment: " << tmp_cs <<
-  //         ", current_interconnect: " << *current_interconnect << endl;
   for(int i=0;i<arch_segmentBits;i++) {
-    if((tmp_cs%2)==1){
-      or_plane_conf[*current_interconnect+arch_plaInterconnects*i] = true;
-    } else {
-      or_plane_conf[*current_interconnect+arch_plaInterconnects*i] = false;
-    }
-    tmp_cs >>= 1;
+    img.set(
+      BitstreamLayout::OR_PLANE,i,*current_interconnect,
+      (current_segment>>i)&1);
   }
   (*current_interconnect)++;
 }
 
 /*write pla config (and, or planes) to and_plane_conf and or_plane_conf*/
-void write_pla_config( int* current_interconnect, int current_segment,
-                       char* and_plane_conf, char* or_plane_conf,
-                       int arch_selectorBits, int arch_segmentBits,
-                       int arch_plaInterconnects){
+void PLAGenerator::write_pla_config( int* current_interconnect, 
+                                     int current_segment){
   //cout << "current interconnect: " << *current_interconnect << endl;
   size_t i,j;
   for(i=0;i<final_group.size();i++) {
     for(j=0;j<final_group[i].size();j++) {
       if(!is_written(final_group[i][j])) {
         write_interconnect(final_group[i][j].number,final_group[i][j].dashes,
-                         current_interconnect, current_segment, and_plane_conf,
-                         or_plane_conf, arch_selectorBits, arch_segmentBits,
-                         arch_plaInterconnects);
+                         current_interconnect, current_segment);
         written_numbers.push_back(final_group[i][j]);
       }
     }
@@ -353,9 +314,7 @@ void write_pla_config( int* current_interconnect, int current_segment,
     for(j=0;j<p_group[i].size();j++) {
       if(!p_group[i][j].used) {
         write_interconnect(p_group[i][j].number,p_group[i][j].dashes,
-                         current_interconnect, current_segment, and_plane_conf,
-                         or_plane_conf, arch_selectorBits, arch_segmentBits,
-                         arch_plaInterconnects);
+                         current_interconnect, current_segment);
       }
     }
   }
@@ -363,19 +322,14 @@ void write_pla_config( int* current_interconnect, int current_segment,
     for(j=0;j<table[i].size();j++) {
       if(!table[i][j].used) {
         write_interconnect(table[i][j].number,table[i][j].dashes,
-                         current_interconnect, current_segment, and_plane_conf,
-                         or_plane_conf, arch_selectorBits, arch_segmentBits,
-                         arch_plaInterconnects);
+                         current_interconnect, current_segment);
       }
     }
   }
 }
 
 /*initialize all table*/
-void init( int* current_interconnect, int current_segment,
-           char* and_plane_conf, char* or_plane_conf,
-           int arch_selectorBits, int arch_segmentBits,
-           int arch_plaInterconnects){
+void PLAGenerator::init( int* current_interconnect, int current_segment){
   table.clear();
   p_group.clear();
   final_group.clear();
@@ -389,14 +343,11 @@ void init( int* current_interconnect, int current_segment,
   //if(show_mid)
   //  print_p_group();
   create_final_group();
-  write_pla_config( current_interconnect, current_segment,
-                    and_plane_conf, or_plane_conf,
-                    arch_selectorBits, arch_segmentBits,
-                    arch_plaInterconnects);
+  write_pla_config( current_interconnect, current_segment);
   //print_final_group();
 }
 
-void getinput( segment_t* segment) {
+void PLAGenerator::getinput( segment_t* segment) {
   int num_bits=0;
   input_values.clear();
   for( uint32_t in = segment->prefix; in < segment->prefix + segment->width; in++){
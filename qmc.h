@@ -2,6 +2,8 @@
 #define RISCV_LUT_COMPILER_QMC_H
 
 #include "lut.h"
+#include "bitstream.h"
+#include <vector>
 
 struct B_number{
   unsigned number;
@@ -10,37 +12,62 @@ struct B_number{
 };
 
 
-//----------------------------------------------------------
-void qmc_pla_gen( int* current_interconnect, int current_segment, 
-                  segment_t* subseg, char* and_plane_conf, char* or_plane_conf,
+/** Legacy PLA generator, minimizing each segment on its own.
+  *
+  * All state of the generator lives in an instance of this class, so that
+  * independent translations may run concurrently using one instance each.
+  * An instance is meant to be used for all segments of a single LUT: it 
+  * remembers the interconnects written so far and never writes one twice.
+  *
+  * The PLA planes are written to the AND and OR plane sections of a 
+  * configuration bitstream image.
+  */
+class PLAGenerator {
+  protected:
+    BitstreamImage &img;
+    int arch_selectorBits;
+    int arch_segmentBits;
+    int arch_plaInterconnects;
+
+    int MIN_BITS;   //minimum bits to print
+    bool show_mid;  //show middle process
+    std::vector<unsigned> input_values;  
+    std::vector<std::vector<B_number> > table;  //original table
+    std::vector<std::vector<B_number> > p_group;  //mid process table
+    std::vector<std::vector<B_number> > final_group;  //final table
+    //avoid printing the same final numbers 
+    std::vector<B_number> printed_numbers;
+    //avoid rewriting the same config on further interconnects
+    std::vector<B_number> written_numbers;
+
+  public:
+    PLAGenerator( BitstreamImage &img,
                   int arch_selectorBits, int arch_segmentBits,
-                  int arch_plaInterconnects); //gen PLA conf
+                  int arch_plaInterconnects);
+
+    //----------------------------------------------------------
+    void qmc_pla_gen( int* current_interconnect, int current_segment, 
+                      segment_t* subseg); //gen PLA conf
+    void print_binary(unsigned number);//print the number in binary
+    void create_table();            //create original table sorted by the number of 1s
+    void print_table();             //print the table
+    void create_p_group();          //create mid process table
+    void print_p_group();           //print it
+    void print_p_binary(unsigned n, unsigned d);//print the mid table (with -'s)
+    void create_final_group();              //create final table
+    void print_final_group();               //print final table with -'s and unused terms
+    bool is_printed(B_number n);            //dont print terms that were already printed
+    bool is_written(B_number n);
+    void write_interconnect(unsigned n, unsigned d, int* current_interconnect,
+                            int current_segment);
+    void write_pla_config( int* current_interconnect, int current_segment); //write pla config
+    void init( int* current_interconnect, int current_segment); //start the table making and printing
+    void getinput( segment_t* segment);     //get input from segment
+    //----------------------------------------------------------
+};
+
 unsigned count_1s(unsigned number); //count the number of 1s in a number
-void print_binary(unsigned number);//print the number in binary
-void create_table();            //create original table sorted by the number of 1s
-void print_table();             //print the table
 B_number init_B_number(unsigned n,int d, bool u);//initialize a B_number
-void create_p_group();          //create mid process table
-void print_p_group();           //print it
-void print_p_binary(unsigned n, unsigned d);//print the mid table (with -'s)
-void create_final_group();              //create final table
-void print_final_group();               //print final table with -'s and unused terms
-bool is_printed(B_number n);            //dont print terms that were already printed
-bool is_written(B_number n);
-void write_interconnect(unsigned n, unsigned d, int* current_interconnect,
-                        int current_segment, char* and_plane_conf,
-                        char* or_plane_conf, int arch_selectorBits, 
-                        int arch_segmentBits, int arch_plaInterconnects);
-void write_pla_config( int* current_interconnect, int current_segment, //write pla config
-                       char* and_plane_conf, char* or_plane_conf,
-                       int arch_selectorBits, int arch_segmentBits,
-                       int arch_plaInterconnects);
-void init( int* current_interconnect, int current_segment, //start the table making and printing
-                       char* and_plane_conf, char* or_plane_conf,
-                       int arch_selectorBits, int arch_segmentBits,
-                       int arch_plaInterconnects);
-void getinput( segment_t* segment);     //get input from segment
 unsigned count_bits(unsigned n);        //min bits to represent a number
-//----------------------------------------------------------
 
 #endif
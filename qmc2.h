@@ -1,19 +1,44 @@
 #ifndef RISCV_LUT_COMPULER_QMC2_H
 #define RISCV_LUT_COMPULER_QMC2_H
+#include "unate-cover.h"
+#include "stats.h"
 #include <alpha/alpha.h>
+#include <unordered_map>
+#include <assert.h>
+#include <algorithm>
 
 class QMC {
   public:
+    enum {
+      /** Maximum number of inputs supported by minimizeHeuristic */
+      MaxHeuristicInputs = 20,
+    };
+    /** A single (multi-output) implicant.
+      *
+      * Inputs are stored bit-parallel: bit i of care is set iff input i is
+      * not a don't care, in which case bit i of value holds its state. Bits
+      * of value outside of care are always zero.
+      */
     struct implicant_t {
       uint64_t impl; // bitmask of output bits implied
+      uint64_t value; // input states
+      uint64_t care; // bitmask of inputs that are not don't cares
       int ones;
       int color;
-      char term[0];
+      
+      /** Returns the state of input i: 0, 1 or 2 for don't care */
+      int term(size_t i) const {
+        if (((care>>i)&1)==0) return 2;
+        return (value>>i)&1;
+      }
 
-      int numImplBits() {
-        int r=0;
-        for(int i=0;i<64;i++) if ((impl>>i)&1) r++;
-        return r;
+      int numImplBits() const {
+        return __builtin_popcountll(impl);
+      }
+
+      /** Returns true iff all inputs covered by b are covered by us. */
+      bool covers(const implicant_t *b) const {
+        return ((b->care&care)==care) && (((b->value^value)&care)==0);
       }
 
       static int OnesCmpFunc(implicant_t *const&a, implicant_t *const&b) {
@@ -21,95 +46,323 @@ class QMC {
       }
     };
   protected:
+    /** Cube of an implicant, i.e. its inputs */
+    struct key_t {
+      uint64_t value;
+      uint64_t care;
+      
+      key_t(uint64_t value, uint64_t care) : value(value), care(care) { }
+
+      bool operator==(const key_t &k) const {
+        return (value==k.value) && (care==k.care);
+      }
+    };
+    struct key_hash_t {
+      size_t operator()(const key_t &k) const {
+        uint64_t h=k.value*0x9e3779b97f4a7c15uL;
+        h^=(k.care+0x632be59bd9b4e019uL)*0xc2b2ae3d27d4eb4fuL;
+        return (size_t)(h^(h>>29));
+      }
+    };
+
+    /** Bump allocator for implicants.
+      *
+      * Implicants are carved from chunks which are only released as a whole.
+      * reset() makes all chunks available again without returning them to
+      * the system.
+      */
+    class arena_t {
+      protected:
+        enum { ChunkSize = 1024 };
+        alp::array_t<implicant_t*> _chunks;
+        size_t _chunk;
+        size_t _used;
+      public:
+        arena_t() : _chunk(0), _used(0) { }
+        ~arena_t() {
+          for(size_t i=0;i<_chunks.len;i++) free((void*)_chunks[i]);
+        }
+
+        implicant_t *alloc() {
+          if (_used==ChunkSize) { _chunk++; _used=0; }
+          if (_chunk==_chunks.len) 
+            _chunks.insert(
+              (implicant_t*)malloc(ChunkSize*sizeof(implicant_t)));
+          return _chunks[_chunk]+(_used++);
+        }
+        
+        void reset() { _chunk=0; _used=0; }
+    };
+
     size_t n_inputs;
+    /** Storage of _minterms, kept until destruction */
+    arena_t _minterm_arena;
+    /** Storage of _implicants, reset by clearImplicants() */
+    arena_t _arena;
     alp::array_t<implicant_t*> _minterms;
     alp::array_t<implicant_t*> _implicants;
+    
+    /** Outputs of all implicants added to _implicants during the current 
+      * minimize() call, by cube.
+      *
+      * A new implicant is dropped if its cube was added before with a 
+      * superset of its outputs, like the previous linear scan for covering
+      * implicants did. Cubes containing it need not be looked up, as they 
+      * are only generated in later rounds. Implicants removed from 
+      * _implicants since are kept: they were combined into an implicant 
+      * with the same outputs.
+      */
+    std::unordered_map<key_t,uint64_t,key_hash_t> _seen;
+    /** All prime implicants found by the last call to minimize(), used by
+      * minimizeCoverExact().
+      */
+    alp::array_t<implicant_t> _primes;
+    /** Coverage table of minimize(), kept to avoid reallocating it */
+    alp::array_t<char> _tbl;
 
-    implicant_t *_dup(implicant_t *m) {
-      implicant_t *r=(implicant_t*)malloc(sizeof(implicant_t)+n_inputs);
-      memcpy(r,m,sizeof(implicant_t)+n_inputs);
+    implicant_t *_dup(const implicant_t *m) {
+      implicant_t *r=_arena.alloc();
+      memcpy(r,m,sizeof(implicant_t));
       return r;
     }
 
+    void _remember(const implicant_t *m) {
+      _seen[key_t(m->value,m->care)]|=m->impl;
+    }
+
+    /** Returns true iff an implicant of the same cube as m implying all of
+      * its outputs was added before.
+      */
+    bool _dominated(const implicant_t &m) const {
+      auto it=_seen.find(key_t(m.value,m.care));
+      return (it!=_seen.end()) && ((it->second&m.impl)==m.impl);
+    }
+
     bool _combine(implicant_t *a, implicant_t *b, implicant_t *&res, uint64_t &tag) {
-      if ((a->ones!=b->ones+1) && (a->ones+1!=b->ones)) return NULL;
+      if (a->care!=b->care) return false;
       if ((a->impl&b->impl)==0) return false;
-      ssize_t idiff=-1;
-      for(size_t i=0;i<n_inputs;i++) {
-        if (a->term[i]==b->term[i]) continue;
-        if (a->term[i]==2) return false;
-        if (b->term[i]==2) return false;
-        if (idiff!=-1) return false;
-        idiff=i;
-      }
+      uint64_t diff=a->value^b->value;
+      if (__builtin_popcountll(diff)!=1) return false;
+      
+      tag=a->impl&b->impl;
+      res=NULL;
+
+      implicant_t m;
+      m.impl=tag;
+      m.value=a->value&~diff;
+      m.care=a->care&~diff;
+      m.ones=__builtin_popcountll(m.value);
+      m.color=0;
+
+      if (_dominated(m)) return true;
+
+      res=_dup(&m);
+      _remember(res);
+      return true;
+    }
+
+    /** Removes all implicants with color 1, preserving the order of the
+      * remaining ones. Their storage is reclaimed by the next reset of the
+      * arena.
+      */
+    void _compact() {
+      size_t n=0;
+      for(size_t i=0;i<_implicants.len;i++) 
+        if (_implicants[i]->color!=1) _implicants[n++]=_implicants[i];
+      _implicants.setlen(n);
+    }
+
+    /** Calls f(t) for each input word t covered by the cube (value,care).
+      */
+    template<class F> void _for_each_input(
+      uint64_t value, uint64_t care, F f) const {
+      uint64_t dc=~care&_input_mask(), sub=0;
+      do {
+        f(value|sub);
+        sub=(sub-dc)&dc;
+      } while(sub!=0);
+    }
+
+    uint64_t _input_mask() const {
+      return (n_inputs<64) ? (1uL<<n_inputs)-1 : ~0uL;
+    }
 
-      if (idiff==-1) return false;
+    /** Dense table of all input words mapped to the output bits required to
+      * be set for them, used by the heuristic minimizer.
+      */
+    alp::array_t<uint64_t> _outputs;
+    /** Number of cubes of the current cover implying each (input, output)
+      * pair, indexed by input*_n_outputs+output. Used by the heuristic 
+      * minimizer.
+      */
+    alp::array_t<uint32_t> _counts;
+    /** Number of output bits used by any minterm */
+    size_t _n_outputs;
+
+    /** Returns true iff the cube (value,care) may imply all outputs in impl,
+      * i.e. it does not contain any input for which one of them is off.
+      */
+    bool _valid(uint64_t value, uint64_t care, uint64_t impl) const {
+      uint64_t dc=~care&_input_mask(), sub=0;
+      do {
+        if ((_outputs[value|sub]&impl)!=impl) return false;
+        sub=(sub-dc)&dc;
+      } while(sub!=0);
+      return true;
+    }
+
+    void _count(const implicant_t *m, int delta) {
+      _for_each_input(m->value,m->care,[&](uint64_t t) {
+        for(uint64_t o=m->impl;o!=0;o&=o-1)
+          _counts[t*_n_outputs+__builtin_ctzll(o)]+=delta;
+      });
+    }
 
-      res=(implicant_t*)malloc(sizeof(implicant_t)+n_inputs);
-      memcpy(res,a,sizeof(implicant_t)+n_inputs);
-      if (a->term[idiff]==1) res->ones--;
-      res->impl&=b->impl;
-      tag=res->impl;
-      res->term[idiff]=2;
-      res->color=0;
+    static bool DashesLessFunc(implicant_t *const&a, implicant_t *const&b) {
+      // most don't cares first
+      return __builtin_popcountll(a->care)<__builtin_popcountll(b->care);
+    }
 
+    /** Expand step of the heuristic minimizer.
+      *
+      * Raises inputs of each cube to don't cares and adds output bits as long
+      * as the cube stays valid, making it prime. Cubes contained in an expanded
+      * cube are removed.
+      */
+    void _expand() {
+      // alp::array_t::sort degenerates with many equal keys, as is the case
+      // with the initial set of minterms
+      std::stable_sort(
+        _implicants.ptr,_implicants.ptr+_implicants.len,DashesLessFunc);
       for(size_t i=0;i<_implicants.len;i++) {
-        if (
-          ((_implicants[i]->impl&res->impl)==res->impl) && 
-          (_covers(_implicants[i],res))) { 
-          free((void*) res);
-          res=NULL;
-          return true;
+        implicant_t *c=_implicants[i];
+        if (c->color==1) continue;
+        
+        for(uint64_t b=c->care;b!=0;b&=b-1) {
+          uint64_t bit=b&-b;
+          if (_valid(c->value^bit,c->care,c->impl)) {
+            c->value&=~bit;
+            c->care&=~bit;
+          }
+        }
+        uint64_t all=(_n_outputs<64) ? (1uL<<_n_outputs)-1 : ~0uL;
+        for(uint64_t o=all&~c->impl;o!=0;o&=o-1) {
+          uint64_t bit=o&-o;
+          if (_valid(c->value,c->care,c->impl|bit)) c->impl|=bit;
         }
+        c->ones=__builtin_popcountll(c->value);
 
+        for(size_t j=0;j<_implicants.len;j++) {
+          implicant_t *d=_implicants[j];
+          if ((j==i) || (d->color==1)) continue;
+          if (c->covers(d) && ((d->impl&~c->impl)==0)) d->color=1;
+        }
       }
-      return true;
+      _compact();
     }
 
-    bool _covers(implicant_t *a, implicant_t *b) {
-      for(size_t i=0;i<n_inputs;i++) {
-        if ((a->term[i]!=b->term[i])&&(a->term[i]!=2)) return false;
+    /** Irredundant step of the heuristic minimizer. 
+      *
+      * Rebuilds _counts and removes cubes all of whose (input, output) pairs
+      * are implied by other cubes, trying the smallest cubes first.
+      */
+    void _irredundant() {
+      memset(_counts.ptr,0,_counts.len*sizeof(uint32_t));
+      for(size_t i=0;i<_implicants.len;i++) _count(_implicants[i],1);
+      
+      for(ssize_t i=(ssize_t)_implicants.len-1;i>-1;i--) {
+        implicant_t *c=_implicants[i];
+        bool redundant=true;
+        _for_each_input(c->value,c->care,[&](uint64_t t) {
+          for(uint64_t o=c->impl;o!=0;o&=o-1)
+            if (_counts[t*_n_outputs+__builtin_ctzll(o)]<2) redundant=false;
+        });
+        if (!redundant) continue;
+        _count(c,-1);
+        c->color=1;
       }
-      return true;
+      _compact();
     }
 
-    void _del(size_t idx) {
-      free((void*)_implicants[idx]);
-      _implicants.remove(idx);
+    /** Reduce step of the heuristic minimizer.
+      *
+      * Shrinks each cube to the smallest cube implying the (input, output)
+      * pairs no other cube implies, so that a subsequent expand step may
+      * find a different prime. Requires _counts to be up to date.
+      */
+    void _reduce() {
+      for(size_t i=0;i<_implicants.len;i++) {
+        implicant_t *c=_implicants[i];
+        uint64_t impl=0, and_all=~0uL, or_all=0;
+        _for_each_input(c->value,c->care,[&](uint64_t t) {
+          uint64_t own=0;
+          for(uint64_t o=c->impl;o!=0;o&=o-1)
+            if (_counts[t*_n_outputs+__builtin_ctzll(o)]==1) own|=o&-o;
+          if (own==0) return;
+          impl|=own;
+          and_all&=t;
+          or_all|=t;
+        });
+        // irredundant cubes always imply some pair on their own
+        if (impl==0) continue;
+
+        implicant_t r;
+        r.impl=impl;
+        r.care=(c->care|(and_all^or_all^_input_mask()))&_input_mask();
+        r.value=and_all&r.care;
+        r.ones=__builtin_popcountll(r.value);
+        r.color=0;
+        
+        _count(c,-1);
+        _count(&r,1);
+        *c=r;
+      }
     }
 
   public:
-    QMC(size_t n_inputs) : n_inputs(n_inputs) {
+    QMC(size_t n_inputs) : n_inputs(n_inputs), _n_outputs(0) {
     
     }
     ~QMC() {
-      for(size_t i=0;i<_minterms.len;i++) free((void*)_minterms[i]);
-      for(size_t i=0;i<_implicants.len;i++) free((void*)_implicants[i]);
+    
     }
 
     const alp::array_t<implicant_t*> &implicants() const { return _implicants; }
+    /** Returns the prime implicants found by the last call to minimize() */
+    const alp::array_t<implicant_t> &primes() const { return _primes; }
 
     void clearImplicants() {
-      for(size_t i=0;i<_implicants.len;i++) free((void*)_implicants[i]);
+      _implicants.clear();
+      _arena.reset();
+      _seen.clear();
+      _primes.clear();
+    }
+
+    /** Replaces the current set of implicants, e.g. by one previously 
+      * obtained for the same minterms.
+      */
+    void setImplicants(const alp::array_t<implicant_t> &impls) {
+      clearImplicants();
+      for(size_t i=0;i<impls.len;i++) _implicants.insert(_dup(&impls[i]));
     }
 
     void add_term(uint64_t term, uint64_t res) {
       if (res==0) return;
-      implicant_t *m=(implicant_t*)malloc(sizeof(implicant_t)+n_inputs);
+      implicant_t *m=_minterm_arena.alloc();
       m->impl=res;
-      m->ones=0;
+      m->care=(n_inputs<64) ? (1uL<<n_inputs)-1 : ~0uL;
+      m->value=term&m->care;
+      m->ones=__builtin_popcountll(m->value);
       m->color=0;
-
-      for(size_t i=0;i<n_inputs;i++) {
-        if ((m->term[i]=(term>>i)&1)==1)
-          m->ones++;
-      }
       _minterms.insert(m);
     }
 
     void minimize() {
       clearImplicants();
-      for(size_t i=0;i<_minterms.len;i++) _implicants.insert(_dup(_minterms[i]));
+      for(size_t i=0;i<_minterms.len;i++) {
+        _implicants.insert(_dup(_minterms[i]));
+        _remember(_minterms[i]);
+      }
 
       bool done=false;
       implicant_t *new_impl;
@@ -137,11 +390,12 @@ class QMC {
             }
           }
         }
-        for(ssize_t i=0;i<(ssize_t)_implicants.len;i++) {
-          if (_implicants[i]->color==1) { _del(i--); i1--; }
-        }
-        
+        _compact();
+
       }
+      Stats::Count(Stats::QMCRounds,i_round);
+      
+      for(size_t i=0;i<_implicants.len;i++) _primes.insert(*_implicants[i]);
 
       size_t n_terms=0;
       for(size_t i=0;i<_minterms.len;i++) {
@@ -149,8 +403,9 @@ class QMC {
       }
 
       
-      char *tbl=(char*)malloc((n_terms+1)*(_implicants.len+1));
-      memset(tbl,0,(n_terms+1)*(_implicants.len+1));
+      _tbl.setlen((n_terms+1)*(_implicants.len+1));
+      char *tbl=_tbl.ptr;
+      memset(tbl,0,_tbl.len);
       char *impl_used=tbl+n_terms*_implicants.len;
       char *term_covered=impl_used+_implicants.len;
       size_t terms_covered=0;
@@ -168,7 +423,7 @@ class QMC {
         char *p=tbl;
         for(size_t i=0;i<_implicants.len;i++) {
           for(size_t j=0;j<_minterms.len;j++) {
-            char covered=_covers(_implicants[i],_minterms[j])?1:0;
+            char covered=_implicants[i]->covers(_minterms[j])?1:0;
             for(size_t k=0;k<64;k++) {
               if (((_minterms[j]->impl>>k)&1)==0) continue;
               *p++=covered&(_implicants[i]->impl>>k);
@@ -191,7 +446,7 @@ class QMC {
         if (idx!=-1) {
           impl_used[idx]=1;
           for(size_t j=0;j<n_terms;j++) 
-            if (term_covered[j]==0) {
+            if ((tbl[idx*n_terms+j]==1)&&(term_covered[j]==0)) {
               term_covered[j]=1;
               terms_covered++;
             }
@@ -199,7 +454,7 @@ class QMC {
       }
 
       // greedily choose implicants covering the most terms
-      while(terms_covered<_minterms.len) {
+      while(terms_covered<n_terms) {
         size_t best_pick=0;
         size_t best_quality=0;
         for(size_t i=0;i<_implicants.len;i++) {
@@ -222,17 +477,142 @@ class QMC {
         impl_used[best_pick]=1;
       }
 
-      for(ssize_t j=(ssize_t)_implicants.len-1;j>-1;j--)
-        if (impl_used[j]!=1) _del(j);
+      for(size_t j=0;j<_implicants.len;j++)
+        if (impl_used[j]!=1) _implicants[j]->color=1;
+      _compact();
       
-      free((void*)tbl);
+
+    }
+
+    /** Searches for a cover of the prime implicants found by the last call 
+      * to minimize() using fewer implicants than the current one.
+      *
+      * minimize() selects the implicants greedily, which is fast but may use
+      * more implicants than necessary. This solves the covering problem 
+      * exactly, giving up after time_limit seconds or node_limit search 
+      * steps.
+      *
+      * \param time_limit Time, in seconds, after which the search is aborted
+      * \param optimal If not NULL, set to true iff the resulting cover is
+      * proven to be minimal
+      * \param node_limit If not 0, the number of search steps after which 
+      * the search is aborted instead of time_limit, see UnateCover::solve
+      * \return true iff a smaller cover was found, in which case it replaces
+      * the current one
+      */
+    bool minimizeCoverExact(
+      double time_limit, bool *optimal=NULL, size_t node_limit=0) {
+      if (optimal) *optimal=false;
+      if (_primes.len==0) return false;
+
+      size_t n_terms=0;
+      for(size_t i=0;i<_minterms.len;i++) {
+        n_terms+=_minterms[i]->numImplBits(); 
+      }
+
+      UnateCover uc(_primes.len,n_terms);
+      for(size_t i=0;i<_primes.len;i++) {
+        size_t col=0;
+        for(size_t j=0;j<_minterms.len;j++) {
+          bool covered=_primes[i].covers(_minterms[j]);
+          for(size_t k=0;k<64;k++) {
+            if (((_minterms[j]->impl>>k)&1)==0) continue;
+            if (covered && ((_primes[i].impl>>k)&1)) uc.set(i,col);
+            col++;
+          }
+        }
+      }
+
+      alp::array_t<uint32_t> sel;
+      bool found=uc.solve(sel,_implicants.len,time_limit,node_limit);
+      if (optimal) *optimal=!uc.timedOut();
+      if (!found) return false;
+
+      _implicants.clear();
+      for(size_t i=0;i<sel.len;i++) 
+        _implicants.insert(_dup(&_primes[sel[i]]));
+      return true;
+    }
+
+    /** Heuristic alternative to minimize() for wide inputs.
+      *
+      * Instead of enumerating all prime implicants, this performs the 
+      * expand / irredundant / reduce loop known from espresso on the 
+      * multi-output cover, starting with the minterms themselves. The loop
+      * terminates once an iteration does not reduce the number of cubes or
+      * max_iterations was reached.
+      *
+      * Requires a dense table over all input words, thus the number of inputs
+      * is limited to MaxHeuristicInputs.
+      */
+    void minimizeHeuristic(int max_iterations=16) {
+      assert(
+        (n_inputs<=MaxHeuristicInputs) && 
+        "too many inputs for heuristic minimization");
+      clearImplicants();
+
+      uint64_t all=0;
+      _outputs.setlen(1uL<<n_inputs);
+      memset(_outputs.ptr,0,_outputs.len*sizeof(uint64_t));
+      for(size_t i=0;i<_minterms.len;i++) {
+        _implicants.insert(_dup(_minterms[i]));
+        _outputs[_minterms[i]->value]|=_minterms[i]->impl;
+        all|=_minterms[i]->impl;
+      }
+      _n_outputs=(all==0) ? 1 : 64-__builtin_clzll(all);
+      _counts.setlen(_outputs.len*_n_outputs);
+
+      _expand();
+      _irredundant();
       
+      alp::array_t<implicant_t> best;
+      for(int i_round=0;i_round<max_iterations;i_round++) {
+        best.setlen(_implicants.len);
+        for(size_t i=0;i<_implicants.len;i++) best[i]=*_implicants[i];
+
+        _reduce();
+        _expand();
+        _irredundant();
+
+        if (_implicants.len<best.len) continue;
+        
+        // no improvement: restore the previous cover
+        clearImplicants();
+        for(size_t i=0;i<best.len;i++) _implicants.insert(_dup(&best[i]));
+        break;
+      }
 
+      _outputs.clear();
+      _counts.clear();
+    }
+
+    /** Checks the current set of implicants against the minterms.
+      *
+      * Every minterm must have exactly its output bits implied and no input
+      * word that is not a minterm may be covered by any implicant. Each
+      * term is expected to have been added only once.
+      */
+    bool verify() const {
+      for(size_t i=0;i<_implicants.len;i++) {
+        const implicant_t *c=_implicants[i];
+        uint64_t n=0;
+        for(size_t j=0;j<_minterms.len;j++)
+          if (c->covers(_minterms[j]) && 
+            ((_minterms[j]->impl&c->impl)==c->impl)) n++;
+        if (n!=(1uL<<(n_inputs-__builtin_popcountll(c->care)))) return false;
+      }
+      for(size_t j=0;j<_minterms.len;j++) {
+        uint64_t impl=0;
+        for(size_t i=0;i<_implicants.len;i++)
+          if (_implicants[i]->covers(_minterms[j])) impl|=_implicants[i]->impl;
+        if (impl!=_minterms[j]->impl) return false;
+      }
+      return true;
     }
 
     void print() {
       for(size_t i=0;i<_implicants.len;i++) {
-        for(size_t j=0;j<n_inputs;j++) switch(_implicants[i]->term[j]) {
+        for(size_t j=0;j<n_inputs;j++) switch(_implicants[i]->term(j)) {
           case 0: printf("0"); break;
           case 1: printf("1"); break;
           case 2: printf("-"); break;
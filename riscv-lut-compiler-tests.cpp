@@ -0,0 +1,190 @@
+/** \file riscv-lut-compiler-tests.cpp
+  * \brief Main routine running the unit tests of the LUT compiler.
+  *
+  * Unit tests are defined by unittest blocks throughout the sources and
+  * only registered when the program starts. This runner runs each of them
+  * in a process of its own, so that tests cannot affect each other and a
+  * crashing test is reported like a failing one.
+  */
+#include <alpha/alpha.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <thread>
+#include <vector>
+
+#if defined(__linux)
+
+#include <unistd.h>
+#include <sys/wait.h>
+
+/** Unit test being run */
+struct running_t {
+  const alp::unittest_t::registration_t *test;
+  pid_t pid;
+  /** Captured standard output and error of the test */
+  FILE *output;
+};
+
+static void print_usage(FILE *f) {
+  fprintf(
+    f,
+    "riscv-lut-compiler-tests [options] [pattern...]\n"
+    "  runs the unit tests whose names contain any of the patterns given,\n"
+    "  all of them if there are none.\n"
+    "\n"
+    "options:\n"
+    "  -h|--help\n"
+    "    Print this help text and exit normally.\n"
+    "  -l|--list\n"
+    "    List the names of the selected tests instead of running them.\n"
+    "  -j|--jobs <number>\n"
+    "    set the number of tests run concurrently, 0 for one per hardware\n"
+    "    thread. default: 0\n");
+}
+
+static bool matches(
+  const alp::unittest_t::registration_t *test,
+  const std::vector<const char*> &patterns) {
+  if (patterns.empty()) return true;
+  for(size_t i=0;i<patterns.size();i++)
+    if (strstr(test->name,patterns[i])) return true;
+  return false;
+}
+
+/** Starts a test in a child process capturing its output */
+static bool start(
+  const alp::unittest_t::registration_t *test, running_t &res) {
+  res.test=test;
+  res.output=tmpfile();
+  if (!res.output) return false;
+
+  fflush(stdout);
+  fflush(stderr);
+  res.pid=fork();
+  if (res.pid<0) {
+    fclose(res.output);
+    return false;
+  }
+  if (res.pid==0) {
+    dup2(fileno(res.output),STDOUT_FILENO);
+    dup2(fileno(res.output),STDERR_FILENO);
+    bool ok=test->run();
+    fflush(stdout);
+    fflush(stderr);
+    _exit(ok ? 0 : 1);
+  }
+  return true;
+}
+
+/** Reports the result of a test that terminated with status, returning
+  * true iff it passed.
+  */
+static bool finish(running_t &r, int status) {
+  bool ok=WIFEXITED(status) && (WEXITSTATUS(status)==0);
+  char buf[4096];
+  size_t n;
+
+  rewind(r.output);
+  while((n=fread(buf,1,sizeof(buf),r.output))>0) fwrite(buf,1,n,stdout);
+  fclose(r.output);
+
+  if (ok) {
+    printf("\x1b[32;1mPASS\x1b[30;0m %s\n",r.test->name);
+  } else if (WIFSIGNALED(status)) {
+    printf(
+      "\x1b[31;1mFAIL\x1b[30;0m %s (terminated by signal %i)\n",
+      r.test->name,WTERMSIG(status));
+  } else {
+    printf("\x1b[31;1mFAIL\x1b[30;0m %s\n",r.test->name);
+  }
+  fflush(stdout);
+  return ok;
+}
+
+/** Main entry point.
+  *
+  * Returns 0 if all selected tests passed, 1 if any failed and 2 on
+  * command-line errors.
+  */
+int main(int argn, char **argv) {
+  std::vector<const char*> patterns;
+  bool list=false;
+  int jobs=0;
+
+  for(int i=1;i<argn;i++) {
+    if ((strcmp(argv[i],"-h")==0) || (strcmp(argv[i],"--help")==0)) {
+      print_usage(stdout);
+      return 0;
+    } else if ((strcmp(argv[i],"-l")==0) || (strcmp(argv[i],"--list")==0)) {
+      list=true;
+    } else if ((strcmp(argv[i],"-j")==0) || (strcmp(argv[i],"--jobs")==0)) {
+      if ((i+1>=argn) || ((jobs=atoi(argv[++i]))<0)) {
+        print_usage(stderr);
+        fprintf(
+          stderr,
+          "\x1b[31;1mERROR: non-negative number expected for %s"
+          "\x1b[30;0m\n",argv[i-1]);
+        return 2;
+      }
+    } else if (argv[i][0]=='-') {
+      print_usage(stderr);
+      fprintf(
+        stderr,"\x1b[31;1mERROR: Unknown switch: %s\x1b[30;0m\n",argv[i]);
+      return 2;
+    } else {
+      patterns.push_back(argv[i]);
+    }
+  }
+
+  std::vector<const alp::unittest_t::registration_t*> tests;
+  for(
+    const alp::unittest_t::registration_t *t=alp::unittest_t::First();
+    t!=NULL;t=t->next) {
+    if (matches(t,patterns)) tests.push_back(t);
+  }
+
+  if (list) {
+    for(size_t i=0;i<tests.size();i++) printf("%s\n",tests[i]->name);
+    return 0;
+  }
+
+  unsigned max_jobs=jobs;
+  if (max_jobs==0) max_jobs=std::thread::hardware_concurrency();
+  if (max_jobs==0) max_jobs=1;
+
+  std::vector<running_t> running;
+  size_t next=0, n_failed=0;
+  while((next<tests.size()) || !running.empty()) {
+    while((next<tests.size()) && (running.size()<max_jobs)) {
+      running_t r;
+      if (!start(tests[next],r)) {
+        printf(
+          "\x1b[31;1mFAIL\x1b[30;0m %s (unable to start)\n",tests[next]->name);
+        n_failed++;
+      } else {
+        running.push_back(r);
+      }
+      next++;
+    }
+    if (running.empty()) continue;
+
+    int status;
+    pid_t pid=wait(&status);
+    if (pid<0) break;
+    for(size_t i=0;i<running.size();i++) {
+      if (running[i].pid!=pid) continue;
+      if (!finish(running[i],status)) n_failed++;
+      running.erase(running.begin()+i);
+      break;
+    }
+  }
+
+  printf(
+    "%zu of %zu unit tests passed\n",tests.size()-n_failed,tests.size());
+  return (n_failed>0) ? 1 : 0;
+}
+
+#else
+#error "unit test runner not implemented for this OS"
+#endif
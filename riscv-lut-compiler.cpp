@@ -8,11 +8,44 @@
 #include "keyvalue.h"
 #include "options.h"
 #include "strategies.h"
+#include "disassembler.h"
+#include "lut-bundle.h"
+#include "server.h"
+#include "build-manifest.h"
+#include "segment-cache.h"
+#include "stats.h"
+#include "explore.h"
 #include <alpha/alpha.h>
+#include <map>
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <mutex>
+
+/** Weights tables loaded by a worker, by located file name.
+  *
+  * Weights tables are not shared between workers as evaluating them 
+  * modifies their interpreter state.
+  */
+typedef std::map<std::string,WeightsTable*> weights_cache_t;
 
 // forward declarations for better overview
 static int run_weights_test(options_t &options);
-static int run_lut_compilation(options_t &options);
+static void run_segmentation(
+  options_t &options, LookupTable *lut, WeightsTable *weights);
+static void measure_error(LookupTable *lut, WeightsTable *weights);
+static int build_lut(
+  options_t &options, LookupTable *lut, weights_cache_t *weights_cache,
+  WeightsTable **weights_res=NULL);
+static int run_lut_compilation(
+  options_t &options, weights_cache_t *weights_cache=NULL);
+static int run_lut_combination(options_t &options);
+static int run_batch_compilation(options_t &options);
+static int run_exploration(options_t &options);
+static int run_disassembly(options_t &options);
+static int run_server(options_t &options);
+static int run(options_t &options);
 int main(int argn, char **argv);
 
 /** Main toolflow for running a weights test
@@ -89,15 +122,74 @@ static int run_weights_test(options_t &options) {
 
 }
 
-/** Main toolflow for running LUT compilation
+/** Runs the segmentation strategies of a LUT, replacing its principal
+  * segments.
+  *
+  * \throw RuntimeError No segmentation method was specified or a strategy
+  * failed.
+  */
+static void run_segmentation(
+  options_t &options, LookupTable *lut, WeightsTable *weights) {
+  // primary segmentation
+  lut->clearSegments();
+
+  if (lut->strategy1()!=segment_strategy::INVALID) {
+    Stats::Timer timer(Stats::SegmentationPhase(lut->strategy1()));
+    segment_strategy::get(lut->strategy1())->execute(lut,weights,options);
+  } else if (lut->explicit_segments().data().len>0) {
+    const alp::array_t<Bounds::interval_t> &intervals=
+      lut->explicit_segments().data();
+    for(size_t i=0;i<intervals.len;i++)
+      lut->addSegment(intervals[i].start,intervals[i].end,true);
+    // fixme: think about whether specifying 'true' here makes sense.
+  } else {
+    throw RuntimeError(
+      "No segmentation method (strategy / explicit segments) specified");
+  }
+
+  // secondary segmentation (if desired)
+  if (lut->strategy2()!=segment_strategy::INVALID) {
+    Stats::Timer timer(Stats::SegmentationPhase(lut->strategy2()));
+    segment_strategy::get(lut->strategy2())->execute(lut,weights,options);
+  }
+}
+
+/** Records the approximation error of all segments of a LUT within its 
+  * domain in the statistics, without counting the evaluations needed.
   */
-static int run_lut_compilation(options_t &options) {
-  LookupTable *lut=new LookupTable(options.arch);
+static void measure_error(LookupTable *lut, WeightsTable *weights) {
+  Stats::Timer timer(Stats::ErrorEvaluation);
+  Stats::Uncounted uncounted;
+
+  // restrict error computation to the domain, like min-error does
+  if (weights==NULL) weights=new WeightsTable(lut->bounds());
+  weights->grab();
+  for(size_t i=0;i<lut->segments().len;i++) {
+    deviation_t e=lut->computeSegmentError(error_square,weights,i);
+    Stats::AddError(e.mean,e.weight);
+  }
+  weights->drop();
+}
+
+/** Builds the segments of a LUT from options.fnInput, i.e. everything of 
+  * the LUT compilation up to translation.
+  *
+  * \param weights_cache Weights tables to reuse and to add loaded tables 
+  * to, none if NULL.
+  * \param weights_res Receives the weights table of the LUT, NULL if it 
+  * has none. Owned by weights_cache if given.
+  * \return 0 on success, the exit code otherwise. Errors are reported.
+  */
+static int build_lut(
+  options_t &options, LookupTable *lut, weights_cache_t *weights_cache,
+  WeightsTable **weights_res) {
   WeightsTable *weights=NULL;
+  alp::string fn_weights;
   bool forgo_approximation=false;
 
   // handle input files (intermediate / input)
   try {
+    Stats::Timer timer(Stats::Parse);
     if (options.fInputIntermediate) {
       lut->parseIntermediateFile(options.fnInput.ptr);
     } else {
@@ -126,13 +218,20 @@ static int run_lut_compilation(options_t &options) {
   // load it 
   if (lut->fn_weights().len>0) {
     try {
-      alp::string fn=options.vfsWeights.locate(lut->fn_weights());
-      if (fn.len<1) {
+      fn_weights=options.vfsWeights.locate(lut->fn_weights());
+      if (fn_weights.len<1) {
         throw RuntimeError("Unable to locate weights file");
       }
-      weights=new WeightsTable();
-      weights->grab();
-      weights->parseWeightsFile(fn.ptr);
+      weights_cache_t::iterator it;
+      if (weights_cache && 
+          ((it=weights_cache->find(fn_weights.ptr))!=weights_cache->end())) {
+        weights=it->second;
+      } else {
+        weights=new WeightsTable();
+        weights->grab();
+        weights->parseWeightsFile(fn_weights.ptr);
+        if (weights_cache) (*weights_cache)[fn_weights.ptr]=weights;
+      }
     } catch(FileIOException &e) {
       fprintf(
         stderr,"\x1b[31;1mError loading weights file: %s\x1b[30;0m\n",
@@ -156,8 +255,11 @@ static int run_lut_compilation(options_t &options) {
   if (!options.fInputIntermediate) {
     try {
       
-      lut->computeSegmentSpace();
-      lut->computePrincipalSegments();
+      {
+        Stats::Timer timer(Stats::SegmentSpace);
+        lut->computeSegmentSpace();
+        lut->computePrincipalSegments();
+      }
 
       // principal segmentation exhibits the maximum resolution possible.
       // Thus, if it does not use too many segments, we do not want to use
@@ -171,32 +273,28 @@ static int run_lut_compilation(options_t &options) {
       } else {
         // only perform segmentation strategies if they are actually needed,
         // i.e. we have more 
-
-        // primary segmentation
-        lut->clearSegments();
-
-        if (lut->strategy1()!=segment_strategy::INVALID) {
-          segment_strategy::get(lut->strategy1())->execute(lut,weights,options);
-        } else if (lut->explicit_segments().data().len>0) {
-          const alp::array_t<Bounds::interval_t> &intervals=
-            lut->explicit_segments().data();
-          for(size_t i=0;i<intervals.len;i++)
-            lut->addSegment(intervals[i].start,intervals[i].end,true);
-          // fixme: think about whether specifying 'true' here makes sense.
+        SegmentCache::key_t key;
+        alp::array_t<segment_t> cached;
+        bool cacheable=SegmentCache::Key(*lut,options,fn_weights,key);
+        
+        if (cacheable && 
+            SegmentCache::Lookup(key,options.segmentCacheDir,cached)) {
+          alp::logf(
+            "INFO: reusing cached segmentation of %u segments\n",
+            alp::LOGT_INFO,(unsigned)cached.len);
+          lut->clearSegments();
+          for(size_t i=0;i<cached.len;i++) lut->addSegment(cached[i],true);
         } else {
-          throw RuntimeError(
-            "No segmentation method (strategy / explicit segments) specified");
-        }
-
-        // secondary segmentation (if desired)
-        if (lut->strategy2()!=segment_strategy::INVALID) {
-          segment_strategy::get(lut->strategy2())->execute(lut,weights,options);
+          run_segmentation(options,lut,weights);
+          if (cacheable) 
+            SegmentCache::Store(key,options.segmentCacheDir,lut->segments());
         }
       }
       
       // approximation (if not handled before as part of segmentation)
       if (forgo_approximation) {
       } else if (lut->approximation_strategy()!=approx_strategy::INVALID) {
+        Stats::Timer timer(Stats::Approximation);
         approx_strategy::get(lut->approximation_strategy())->execute(
           lut,weights,options);
       } else if (!options.fOutputIntermediate) {
@@ -204,6 +302,10 @@ static int run_lut_compilation(options_t &options) {
           "No approximation strategy specified and not outputting intermediate "
           "representation");
       }
+      
+      if (options.fStats && 
+          (lut->approximation_strategy()!=approx_strategy::INVALID))
+        measure_error(lut,weights);
     } catch(RuntimeError &e) {
       fprintf(
         stderr,"\x1b[31;1mError compiling lut file %s: %s\x1b[30;0m\n",
@@ -286,13 +388,27 @@ static int run_lut_compilation(options_t &options) {
 
     }
   }
+  if (weights_res) *weights_res=weights;
+  return 0;
+}
+
+/** Builds a LUT from options.fnInput and writes its output.
+  *
+  * \return 0 on success, the exit code otherwise. Errors are reported.
+  */
+static int compile_lut(
+  options_t &options, LookupTable &lut, weights_cache_t *weights_cache) {
+  int res;
+
+  if ((res=build_lut(options,&lut,weights_cache))!=0) return res;
   try {
     options.computeOutputName();
     if (options.fOutputIntermediate) {
-      lut->saveIntermediateFile(options.outputName.ptr);
+      Stats::Timer timer(Stats::Output);
+      lut.saveIntermediateFile(options.outputName.ptr);
     } else {
       try {
-        lut->translate();
+        lut.translate();
       } catch(HWResourceExceededError &e) {
         fprintf(
           stderr,
@@ -301,15 +417,50 @@ static int run_lut_compilation(options_t &options) {
           options.fnInput.ptr,e.what());
         return 1;
       }
+      if (options.fnDeltaReference.len>0) {
+        try {
+          lut.parseReferenceFile(options.fnDeltaReference.ptr);
+        } catch(FileIOException &e) {
+          fprintf(
+            stderr,
+            "\x1b[31;1mError loading reference configuration: %s\x1b[30;0m\n",
+            e.what());
+          return 1;
+        } catch(SyntaxError &e) {
+          fprintf(
+            stderr,
+            "\x1b[31;1mError parsing reference configuration %s: "
+            "%s\x1b[30;0m\n",
+            options.fnDeltaReference.ptr,e.what());
+          return 1;
+        } catch(HWResourceExceededError &e) {
+          fprintf(
+            stderr,
+            "\x1b[31;1mHardware resources exhausted during translation of %s: "
+            "%s\x1b[30;0m\n",
+            options.fnDeltaReference.ptr,e.what());
+          return 1;
+        }
+      }
+      Stats::Timer timer(Stats::Output);
       if (options.fOutputC) {
-        lut->saveOutputFile(options.outputName.ptr);
+        lut.saveOutputFile(options.outputName.ptr);
       } else if (options.fOutputDump) {
-        lut->saveOutputDumpFile(options.outputName.ptr);
+        lut.saveOutputDumpFile(options.outputName.ptr);
+      } else if (options.fOutputBinary) {
+        lut.saveOutputBinaryFile(
+          options.outputName.ptr,options.fBigEndian);
+      } else if (options.fOutputHex) {
+        lut.saveOutputHexFile(options.outputName.ptr);
+      } else if (
+        !options.fExternalCompile && (options.fnDeltaReference.len==0)) {
+        lut.saveOutputObjectFile(
+          options.outputName.ptr,options.elfClass,options.elfFlags);
       } else {
         TempDir tmpdir;
         alp::string fn_c=tmpdir.path()+"lut.c";
         int code;
-        lut->saveOutputFile(fn_c.ptr);
+        lut.saveOutputFile(fn_c.ptr);
 
         if ((code=system(alp::string::Format(
           "%s \"%s\" -o \"%s\"",
@@ -327,13 +478,471 @@ static int run_lut_compilation(options_t &options) {
   return 0;
 }
 
+/** Main toolflow for running LUT compilation
+  *
+  * In incremental mode, the compilation is skipped if the manifest of the
+  * output shows that nothing it depends on changed, and the manifest is
+  * written after a successful compilation.
+  */
+static int run_lut_compilation(
+  options_t &options, weights_cache_t *weights_cache) {
+  LookupTable lut(options);
+  int res;
+
+  if (!options.fIncremental) return compile_lut(options,lut,weights_cache);
+
+  options.computeOutputName();
+  BuildManifest manifest(options);
+  alp::string fn_manifest=BuildManifest::FileName(options);
+  if (manifest.upToDate(fn_manifest.ptr,options.vfsWeights)) {
+    alp::logf(
+      "INFO: %s is up to date\n",alp::LOGT_INFO,options.outputName.ptr);
+    return 0;
+  }
+  remove(fn_manifest.ptr);
+
+  if ((res=compile_lut(options,lut,weights_cache))!=0) return res;
+
+  if (lut.fn_weights().len>0)
+    manifest.setWeights(
+      lut.fn_weights(),options.vfsWeights.locate(lut.fn_weights()));
+  try {
+    manifest.save(fn_manifest.ptr);
+  } catch(FileIOException &e) {
+    fprintf(
+      stderr,"\x1b[31;1mError writing manifest: %s\x1b[30;0m\n",e.what());
+    return 1;
+  }
+  return 0;
+}
+
+/** Main toolflow for compiling multiple LUTs into a combined output
+  */
+static int run_lut_combination(options_t &options) {
+  LookupTableBundle bundle(
+    (options.lutName.len>0) ? options.lutName.ptr : "luts");
+
+  for(size_t i=0;i<options.fnInputs.size();i++) {
+    LookupTable lut(options);
+    int res;
+
+    options.fnInput=options.fnInputs[i];
+    if ((res=build_lut(options,&lut,NULL))!=0) return res;
+    try {
+      lut.translate();
+      bundle.add(lut);
+    } catch(HWResourceExceededError &e) {
+      fprintf(
+        stderr,
+        "\x1b[31;1mHardware resources exhausted during translation of %s: "
+        "%s\x1b[30;0m\n",
+        options.fnInput.ptr,e.what());
+      return 1;
+    } catch(RuntimeError &e) {
+      fprintf(
+        stderr,"\x1b[31;1mError combining LUT %s: %s\x1b[30;0m\n",
+        options.fnInput.ptr,e.what());
+      return 1;
+    }
+  }
+  options.fnInput=options.fnInputs[0];
+
+  alp::logf(
+    "INFO: combined %lu LUTs into %lu of %lu words\n",alp::LOGT_INFO,
+    bundle.size(),bundle.nPoolWords(),bundle.nInputWords());
+
+  try {
+    Stats::Timer timer(Stats::Output);
+    options.computeOutputName();
+    if (options.fOutputC) {
+      bundle.saveOutputFile(options.outputName.ptr);
+    } else if (!options.fExternalCompile) {
+      bundle.saveOutputObjectFile(
+        options.outputName.ptr,options.elfClass,options.elfFlags);
+    } else {
+      TempDir tmpdir;
+      alp::string fn_c=tmpdir.path()+"luts.c";
+      bundle.saveOutputFile(fn_c.ptr);
+
+      if (system(alp::string::Format(
+        "%s \"%s\" -o \"%s\"",
+        options.cmdCompileTargetO.ptr,
+        fn_c.ptr,options.outputName.ptr).ptr)!=0) 
+        throw RuntimeError("unable to compile LUTs to ELF");
+    }
+  } catch(FileIOException &e) {
+    fprintf(
+      stderr,"\x1b[31;1mError writing output file: %s\x1b[30;0m\n",
+      e.what());
+    return 1;
+  } catch(RuntimeError &e) {
+    fprintf(
+      stderr,"\x1b[31;1mError outputting LUTs: %s\x1b[30;0m\n",e.what());
+    return 1;
+  }
+  return 0;
+}
+
+/** Main toolflow for compiling each of multiple LUTs into its own output,
+  * on a pool of worker threads.
+  *
+  * LUTs failing to compile are reported and do not affect the others.
+  */
+static int run_batch_compilation(options_t &options) {
+  size_t n=options.fnInputs.size();
+  std::vector<int> results(n,1);
+  std::atomic<size_t> next(0);
+  unsigned n_workers=options.jobs;
+
+  if (n_workers==0) n_workers=std::thread::hardware_concurrency();
+  if (n_workers==0) n_workers=1;
+  if (n_workers>n) n_workers=n;
+
+  auto worker=[&]() {
+    weights_cache_t weights;
+    size_t i;
+    while((i=next++)<n) {
+      options_t job(options);
+      job.fnInput=options.fnInputs[i];
+      results[i]=run_lut_compilation(job,&weights);
+      if (results[i]==0) {
+        alp::logf(
+          "INFO: compiled %s to %s\n",alp::LOGT_INFO,
+          job.fnInput.ptr,job.outputName.ptr);
+      }
+    }
+    for(weights_cache_t::iterator it=weights.begin();it!=weights.end();it++)
+      it->second->drop();
+  };
+
+  std::vector<std::thread> workers;
+  for(unsigned i=0;i<n_workers;i++) workers.push_back(std::thread(worker));
+  for(unsigned i=0;i<n_workers;i++) workers[i].join();
+
+  size_t n_failed=0;
+  for(size_t i=0;i<n;i++) {
+    if (results[i]==0) continue;
+    fprintf(
+      stderr,"\x1b[31;1mFailed to compile %s\x1b[30;0m\n",
+      options.fnInputs[i].ptr);
+    n_failed++;
+  }
+  alp::logf(
+    "INFO: compiled %lu of %lu LUTs using %u workers\n",alp::LOGT_INFO,
+    n-n_failed,n,n_workers);
+  return (n_failed>0) ? 1 : 0;
+}
+
+/** Returns true iff the architectures a and b only differ in the number of
+  * PLA interconnects, which does not affect the segments and thus the
+  * error of a LUT but only whether its PLA fits.
+  */
+static bool same_but_interconnects(
+  const arch_config_t &a, const arch_config_t &b) {
+  return 
+    (a.segmentBits==b.segmentBits) && (a.selectorBits==b.selectorBits) &&
+    (a.interpolationBits==b.interpolationBits) && 
+    (a.base_bits==b.base_bits) && (a.incline_bits==b.incline_bits);
+}
+
+/** Compiles the LUT of options.fnInput for every architecture of space on
+  * a pool of worker threads and writes the Pareto front of their cost and 
+  * error.
+  *
+  * Architectures are handed out by ascending cost. Those which cannot be on
+  * the front are settled without compiling them if possible, i.e. if the 
+  * LUT did not fit the same architecture with as many interconnects or 
+  * more, or if it fitted it with fewer. Otherwise the LUT is built, but 
+  * only translated if no feasible architecture dominates it. As pruned and
+  * infeasible architectures are never on the front, the front does not 
+  * depend on the order in which architectures are completed.
+  */
+static int explore_lut(options_t &options, const DesignSpace &space) {
+  std::vector<design_point_t> points;
+  std::mutex points_lock;
+  size_t next=0;
+  unsigned n_workers=options.jobs;
+
+  space.enumerate(options.arch,points);
+  if (n_workers==0) n_workers=std::thread::hardware_concurrency();
+  if (n_workers==0) n_workers=1;
+  if (n_workers>points.size()) n_workers=points.size();
+
+  auto explore_point=[&](size_t i, weights_cache_t &weights_cache) {
+    design_point_t p;
+    {
+      std::lock_guard<std::mutex> guard(points_lock);
+      p=points[i];
+      for(size_t j=0;(j<points.size()) && (p.state==p.Pending);j++) {
+        const design_point_t &q=points[j];
+        if (!same_but_interconnects(p.arch,q.arch)) continue;
+        if ((q.state==q.Infeasible) && 
+            (q.arch.plaInterconnects>=p.arch.plaInterconnects)) {
+          p.state=p.Infeasible;
+        } else if ((q.state==q.Feasible) &&
+            (q.arch.plaInterconnects<p.arch.plaInterconnects)) {
+          p.max_error=q.max_error;
+          p.mean_error=q.mean_error;
+          p.state=p.Pruned;
+        }
+      }
+      points[i]=p;
+      if (p.state!=p.Pending) return;
+    }
+
+    options_t job(options);
+    job.arch=p.arch;
+    LookupTable lut(job);
+    WeightsTable *weights=NULL;
+
+    if (build_lut(job,&lut,&weights_cache,&weights)!=0) {
+      p.state=p.Failed;
+    } else {
+      DesignSpace::Evaluate(lut,weights,p);
+      {
+        std::lock_guard<std::mutex> guard(points_lock);
+        for(size_t j=0;(j<points.size()) && (p.state==p.Pending);j++) {
+          if ((points[j].state==p.Feasible) && points[j].dominates(p))
+            p.state=p.Pruned;
+        }
+      }
+      if (p.state==p.Pending) {
+        try {
+          lut.translate();
+          p.state=p.Feasible;
+        } catch(HWResourceExceededError &e) {
+          p.state=p.Infeasible;
+        } catch(RuntimeError &e) {
+          fprintf(
+            stderr,"\x1b[31;1mError translating lut file %s: %s\x1b[30;0m\n",
+            job.fnInput.ptr,e.what());
+          p.state=p.Failed;
+        }
+      }
+    }
+
+    std::lock_guard<std::mutex> guard(points_lock);
+    points[i]=p;
+  };
+
+  // the cheapest architecture is compiled on its own first, so that the
+  // target function is compiled once and then shared by all workers 
+  // through the target cache, and so that broken inputs fail early
+  {
+    weights_cache_t weights;
+    explore_point(next++,weights);
+    for(weights_cache_t::iterator it=weights.begin();it!=weights.end();it++)
+      it->second->drop();
+    if (points[0].state==design_point_t::Failed) return 1;
+  }
+
+  auto worker=[&]() {
+    weights_cache_t weights;
+    for(;;) {
+      size_t i;
+      {
+        std::lock_guard<std::mutex> guard(points_lock);
+        if (next>=points.size()) break;
+        i=next++;
+      }
+      explore_point(i,weights);
+    }
+    for(weights_cache_t::iterator it=weights.begin();it!=weights.end();it++)
+      it->second->drop();
+  };
+
+  std::vector<std::thread> workers;
+  for(unsigned i=0;i<n_workers;i++) workers.push_back(std::thread(worker));
+  for(unsigned i=0;i<n_workers;i++) workers[i].join();
+
+  size_t n_state[design_point_t::Failed+1]={0};
+  for(size_t i=0;i<points.size();i++) n_state[points[i].state]++;
+
+  std::vector<size_t> front;
+  DesignSpace::ParetoFront(points,front);
+  try {
+    options.computeOutputName();
+    FILE *f=fopen(options.outputName.ptr,"w");
+    if (!f) throw FileIOException(options.outputName);
+    DesignSpace::SaveFront(f,options.fnInput.ptr,points);
+    fclose(f);
+  } catch(FileIOException &e) {
+    fprintf(
+      stderr,"\x1b[31;1mError writing Pareto front: %s\x1b[30;0m\n",
+      e.what());
+    return 1;
+  }
+
+  alp::logf(
+    "INFO: explored %lu architectures for %s: %lu feasible, %lu pruned, "
+    "%lu infeasible, %lu failed. Wrote %lu on the Pareto front to %s\n",
+    alp::LOGT_INFO,points.size(),options.fnInput.ptr,
+    n_state[design_point_t::Feasible],n_state[design_point_t::Pruned],
+    n_state[design_point_t::Infeasible],n_state[design_point_t::Failed],
+    front.size(),options.outputName.ptr);
+  return (n_state[design_point_t::Failed]>0) ? 1 : 0;
+}
+
+/** Main toolflow for design-space exploration, see explore_lut
+  */
+static int run_exploration(options_t &options) {
+  DesignSpace space;
+  alp::string error;
+  int res=0;
+
+  if (!space.parse(options.exploreSpec.ptr,error)) {
+    fprintf(
+      stderr,"\x1b[31;1mError parsing design space: %s\x1b[30;0m\n",
+      error.ptr);
+    return 1;
+  }
+  for(size_t i=0;i<options.fnInputs.size();i++) {
+    options_t job(options);
+    job.fnInput=options.fnInputs[i];
+    if (explore_lut(job,space)!=0) res=1;
+  }
+  return res;
+}
+
+/** Main toolflow for disassembling and validating bitstreams
+  */
+static int run_disassembly(options_t &options) {
+  alp::array_t<uint64_t> words;
+  BitstreamDisassembler dis(options.arch);
+
+  try {
+    BitstreamDisassembler::LoadDumpFile(options.fnInput.ptr,words);
+    dis.decode(words);
+  } catch(FileIOException &e) {
+    fprintf(
+      stderr,"\x1b[31;1mError loading bitstream: %s\x1b[30;0m\n",e.what());
+    return 1;
+  } catch(SyntaxError &e) {
+    fprintf(
+      stderr,"\x1b[31;1mError parsing bitstream %s: %s\x1b[30;0m\n",
+      options.fnInput.ptr,e.what());
+    return 1;
+  } catch(RuntimeError &e) {
+    fprintf(
+      stderr,"\x1b[31;1mError decoding bitstream %s: %s\x1b[30;0m\n",
+      options.fnInput.ptr,e.what());
+    return 1;
+  }
+
+  try {
+    options.computeOutputName();
+    OutputStream out(options.outputName.ptr);
+    dis.listing(out);
+    out.close();
+  } catch(FileIOException &e) {
+    fprintf(
+      stderr,"\x1b[31;1mError writing listing: %s\x1b[30;0m\n",e.what());
+    return 1;
+  }
+
+  if (options.fnValidate.len>0) {
+    LookupTable lut(options);
+    alp::string report;
+    try {
+      lut.parseIntermediateFile(options.fnValidate.ptr);
+    } catch(FileIOException &e) {
+      fprintf(
+        stderr,"\x1b[31;1mError loading lut file: %s\x1b[30;0m\n",
+        e.what());
+      return 1;
+    } catch(SyntaxError &e) {
+      fprintf(
+        stderr,"\x1b[31;1mError parsing lut file %s: %s\x1b[30;0m\n",
+        options.fnValidate.ptr,e.what());
+      return 1;
+    }
+    if (!dis.validate(lut,report)) {
+      fprintf(
+        stderr,"\x1b[31;1mBitstream %s does not match %s:\x1b[30;0m\n%s",
+        options.fnInput.ptr,options.fnValidate.ptr,report.ptr);
+      return 1;
+    }
+    alp::logf(
+      "INFO: bitstream %s matches %s\n",alp::LOGT_INFO,
+      options.fnInput.ptr,options.fnValidate.ptr);
+  }
+  return 0;
+}
+
+/** Main toolflow for serving compile jobs
+  */
+static int run_server(options_t &options) {
+  CompileServer server(options,run);
+  try {
+    server.serve();
+  } catch(RuntimeError &e) {
+    fprintf(stderr,"\x1b[31;1mError serving: %s\x1b[30;0m\n",e.what());
+    return 1;
+  }
+  return 0;
+}
+
+/** Calls the toolflow selected by options and reports its statistics if
+  * requested.
+  */
+static int run(options_t &options) {
+  int res;
+
+  Stats::Reset();
+  if (options.serveSocket.len>0) {
+    res=run_server(options);
+  } else if (options.fInputWeights) {
+    res=run_weights_test(options);
+  } else if (options.fDisassemble) {
+    res=run_disassembly(options);
+  } else if (options.fCombine) {
+    res=run_lut_combination(options);
+  } else if (options.fBatch) {
+    res=run_batch_compilation(options);
+  } else if (options.exploreSpec.len>0) {
+    res=run_exploration(options);
+  } else {
+    res=run_lut_compilation(options);
+  }
+
+  if (options.fStats && (options.fnStats.len>0)) {
+    try {
+      Stats::SaveJSON(options.fnStats.ptr);
+    } catch(FileIOException &e) {
+      fprintf(
+        stderr,"\x1b[31;1mError writing statistics: %s\x1b[30;0m\n",
+        e.what());
+      if (res==0) res=1;
+    }
+  } else if (options.fStats) {
+    Stats::Print(stderr);
+  }
+  return res;
+}
+
 /** Main entry point.
   *
   * Performs command-line argument parsing and calls the appropriate 
-  * toolflow (see above)
+  * toolflow (see above), unless the invocation is forwarded to a compile
+  * server.
   */
 int main(int argn, char **argv) {
   options_t options;
+  const char *server=getenv(ENV_SERVER);
+
+  if (server && *server) {
+    bool serving=false;
+    int code;
+    for(int i=1;i<argn;i++) 
+      if (strcmp(argv[i],"--serve")==0) serving=true;
+    if (!serving) {
+      if (CompileServer::Forward(server,argn-1,(const char**)(argv+1),code))
+        return code;
+      alp::logf(
+        "WARNING: compile server %s not reachable, compiling locally\n",
+        alp::LOGT_WARNING,server);
+    }
+  }
 
   try {
     int res;
@@ -350,11 +959,5 @@ int main(int argn, char **argv) {
     exit(1);
   }
 
-  if (options.fInputWeights) {
-    return run_weights_test(options);
-  } else {
-    return run_lut_compilation(options);
-  }
-
-  return 0;
+  return run(options);
 }
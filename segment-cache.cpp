@@ -0,0 +1,221 @@
+#include "segment-cache.h"
+#include "strategies.h"
+#include "util.h"
+#include <unordered_map>
+#include <vector>
+#include <mutex>
+#include <atomic>
+#include <stdio.h>
+#include <unistd.h>
+
+// bump whenever the meaning of cached entries changes
+#define SEGMENT_CACHE_VERSION 1
+
+/** Boundaries of a cached segment */
+struct _entry_segment_t {
+  uint32_t prefix;
+  uint32_t width;
+};
+
+static std::unordered_map<
+  SegmentCache::key_t,std::vector<_entry_segment_t> > _entries;
+static std::mutex _entries_lock;
+static std::atomic<unsigned> _n_tmp_files(0);
+
+static void _append(SegmentCache::key_t &key, uint32_t v) {
+  key.append((const char*)&v,sizeof(v));
+}
+
+static void _append(SegmentCache::key_t &key, uint64_t v) {
+  key.append((const char*)&v,sizeof(v));
+}
+
+static void _append(SegmentCache::key_t &key, const alp::string &s) {
+  _append(key,(uint32_t)s.len);
+  key.append(s.ptr,s.len);
+}
+
+static void _append(SegmentCache::key_t &key, const seg_data_t &v) {
+  _append(key,(uint32_t)v.kind);
+  _append(key,(uint64_t)v.data_i);
+}
+
+/** Returns the file name of the on-disk entry for key */
+static alp::string _file_name(
+  const SegmentCache::key_t &key, const alp::string &dir) {
+  uint64_t h=hash_fnv1a(key.data(),key.size());
+  return alp::string::Format("%s/%.16lx.seg",dir.ptr,(unsigned long)h);
+}
+
+bool SegmentCache::Key(
+  const LookupTable &lut, const options_t &options,
+  const alp::string &fn_weights, key_t &key) {
+  const arch_config_t &arch=lut.arch();
+
+  key.clear();
+  _append(key,(uint32_t)SEGMENT_CACHE_VERSION);
+  _append(key,(uint32_t)arch.numSegments);
+  _append(key,(uint32_t)arch.wordSize);
+  _append(key,(uint32_t)arch.inputWords);
+  _append(key,(uint32_t)arch.segmentBits);
+  _append(key,(uint32_t)arch.selectorBits);
+  _append(key,(uint32_t)arch.interpolationBits);
+  _append(key,lut.segment_space_offset());
+  _append(key,(uint32_t)lut.segment_space_width());
+
+  // the target function as compiled
+  _append(key,options.cmdCompileSO);
+  _append(key,lut.target_name());
+  _append(key,lut.c_code());
+
+  // all key-values steering segmentation, including those only known to
+  // the strategies themselves
+  for(size_t i=0;i<lut.keyvalues().len;i++) {
+    KeyValue *kv=lut.keyvalues()[i];
+    if ((kv->name()=="name") || (kv->name()=="approximation") ||
+        (kv->name()=="weights"))
+      continue;
+    _append(key,kv->name());
+    _append(key,(uint32_t)kv->kind());
+    if (kv->kind()==KeyValue::String) {
+      _append(key,kv->val_str());
+    } else {
+      _append(key,kv->val_num());
+    }
+  }
+
+  if (!segment_strategy::usesApproximation(lut.strategy1(),lut.strategy2()))
+    return true;
+
+  _append(key,(uint32_t)lut.approximation_strategy());
+  if (fn_weights.len>0) {
+    uint64_t h;
+    if (!hash_file(fn_weights.ptr,h)) return false;
+    _append(key,h);
+  } else {
+    _append(key,alp::string());
+  }
+  return true;
+}
+
+bool SegmentCache::Lookup(
+  const key_t &key, const alp::string &dir,
+  alp::array_t<segment_t> &res) {
+  std::vector<_entry_segment_t> e;
+
+  res.setlen(0);
+  {
+    std::lock_guard<std::mutex> lock(_entries_lock);
+    auto it=_entries.find(key);
+    if (it!=_entries.end()) e=it->second;
+  }
+  if (e.empty()) {
+    if (dir.len==0) return false;
+
+    FILE *f=fopen(_file_name(key,dir).ptr,"rb");
+    if (!f) return false;
+
+    // the file starts with the full key to rule out hash collisions
+    uint64_t cb_key=0, n=0;
+    std::string stored;
+    bool ok=
+      (fread(&cb_key,sizeof(cb_key),1,f)==1) && (cb_key==key.size());
+    if (ok) {
+      stored.resize(cb_key);
+      ok=(fread(&stored[0],1,cb_key,f)==cb_key) && (stored==key) &&
+        (fread(&n,sizeof(n),1,f)==1) && (n>0);
+    }
+    if (ok) {
+      e.resize(n);
+      ok=fread(e.data(),sizeof(_entry_segment_t),n,f)==n;
+    }
+    fclose(f);
+    if (!ok) return false;
+
+    std::lock_guard<std::mutex> lock(_entries_lock);
+    _entries[key]=e;
+  }
+
+  for(size_t i=0;i<e.size();i++)
+    res.insert(segment_t(e[i].prefix,e[i].width));
+  return true;
+}
+
+void SegmentCache::Store(
+  const key_t &key, const alp::string &dir,
+  const alp::array_t<segment_t> &segments) {
+  std::vector<_entry_segment_t> e;
+
+  // empty entries are indistinguishable from missing ones
+  if (segments.len==0) return;
+  for(size_t i=0;i<segments.len;i++)
+    e.push_back({ segments[i].prefix, segments[i].width });
+  {
+    std::lock_guard<std::mutex> lock(_entries_lock);
+    _entries[key]=e;
+  }
+  if (dir.len==0) return;
+
+  // write to a temporary file first so that concurrent readers never see a
+  // partial entry
+  alp::string fn=_file_name(key,dir);
+  alp::string fn_tmp=alp::string::Format(
+    "%s.%i.%u.tmp",fn.ptr,(int)getpid(),_n_tmp_files++);
+  FILE *f=fopen(fn_tmp.ptr,"wb");
+  if (!f) return;
+
+  uint64_t cb_key=key.size(), n=e.size();
+  bool ok=
+    (fwrite(&cb_key,sizeof(cb_key),1,f)==1) &&
+    (fwrite(key.data(),1,cb_key,f)==cb_key) &&
+    (fwrite(&n,sizeof(n),1,f)==1) &&
+    (fwrite(e.data(),sizeof(_entry_segment_t),n,f)==n);
+  ok=(fclose(f)==0) && ok;
+  if (!ok || (rename(fn_tmp.ptr,fn.ptr)!=0)) unlink(fn_tmp.ptr);
+}
+
+void SegmentCache::Clear() {
+  std::lock_guard<std::mutex> lock(_entries_lock);
+  _entries.clear();
+}
+
+unittest(
+  /*
+    testing:
+      SegmentCache::Lookup
+      SegmentCache::Store
+      segment_strategy::usesApproximation
+  */
+  Assertf(
+    !segment_strategy::usesApproximation(
+      segment_strategy::ID_UNIFORM,segment_strategy::INVALID),
+    "uniform segmentation does not approximate");
+  Assertf(
+    segment_strategy::usesApproximation(
+      segment_strategy::ID_UNIFORM,segment_strategy::ID_MIN_ERROR),
+    "min-error segmentation approximates");
+  Assertf(
+    segment_strategy::usesApproximation(
+      segment_strategy::ID_UNIFORM,segment_strategy::ID_UNIFORM),
+    "secondary subdivision distributes segments by approximation error");
+
+  alp::array_t<segment_t> segments;
+  segments.insert(segment_t(0,3));
+  segments.insert(segment_t(3,5));
+  SegmentCache::key_t key("key"), other("other");
+
+  TempDir tmp;
+  alp::array_t<segment_t> res;
+  Assertf(!SegmentCache::Lookup(key,tmp.path(),res), "unexpected cache hit");
+  SegmentCache::Store(key,tmp.path(),segments);
+  SegmentCache::Clear();
+  Assertf(!SegmentCache::Lookup(other,tmp.path(),res), "unexpected cache hit");
+  Assertf(SegmentCache::Lookup(key,tmp.path(),res), "expected on-disk entry");
+  Assertf(res.len==segments.len, "segment count mismatch");
+  for(size_t i=0;i<res.len;i++)
+    Assertf(
+      (res[i].prefix==segments[i].prefix) &&
+      (res[i].width==segments[i].width),
+      "segment %zu differs",i);
+  SegmentCache::Clear();
+);
@@ -0,0 +1,69 @@
+/** \file segment-cache.h
+  * \brief Memoization of segmentation results.
+  */
+#ifndef RISCV_LUT_COMPULER_SEGMENT_CACHE_H
+#define RISCV_LUT_COMPULER_SEGMENT_CACHE_H
+
+#include "error.h"
+#include "segment.h"
+#include "lut.h"
+#include "options.h"
+
+#include <alpha/alpha.h>
+#include <string>
+
+/** Cache of segment sets computed by segmentation strategies.
+  *
+  * The segments chosen for a LUT depend on its target function, its
+  * key-values and the architecture. The approximation strategy and the
+  * weights table only matter if the segmentation strategies evaluate them
+  * (see segment_strategy::usesApproximation), so that changing either of
+  * them resumes from the cached segments otherwise. These are encoded
+  * into a canonical key, which maps to the boundaries of the resulting
+  * segments. Their values are not stored as they are computed by
+  * approximation afterwards.
+  *
+  * Entries are kept in memory for the lifetime of the process. If a
+  * directory is given, they are also stored there, one file per key, so
+  * that they are available to later invocations. Failing to access the
+  * directory is not an error, the entry is then simply not cached on disk.
+  *
+  * All methods may be called concurrently.
+  */
+class SegmentCache {
+  public:
+    typedef std::string key_t;
+
+    /** Computes the key of segmenting lut, whose segment space needs to be
+      * computed already.
+      *
+      * \param fn_weights Located weights file of lut, none if empty.
+      * \return false if lut cannot be cached, e.g. since the weights file
+      * could not be read.
+      */
+    static bool Key(
+      const LookupTable &lut, const options_t &options,
+      const alp::string &fn_weights, key_t &key);
+
+    /** Looks up the segments stored for key.
+      *
+      * \param dir Directory of the on-disk cache, none if empty
+      * \return true iff an entry was found
+      */
+    static bool Lookup(
+      const key_t &key, const alp::string &dir,
+      alp::array_t<segment_t> &res);
+
+    /** Stores the segments for key.
+      *
+      * \param dir Directory of the on-disk cache, none if empty
+      */
+    static void Store(
+      const key_t &key, const alp::string &dir,
+      const alp::array_t<segment_t> &segments);
+
+    /** Drops all entries held in memory */
+    static void Clear();
+};
+
+#endif
@@ -0,0 +1,403 @@
+#include "server.h"
+#include "util.h"
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <thread>
+
+#if defined(__linux)
+
+#include <errno.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+
+#define SERVER_MAGIC 0x6a74756cu   // "lutj"
+#define SERVER_VERSION 2
+
+/** Fixed part of a job, sent together with the client's standard output
+  * and error descriptors. It is followed by size bytes of null-terminated
+  * strings: the working directory, the variables of _forwarded_env set by
+  * the client as name=value, an empty string and the command-line
+  * arguments.
+  */
+struct _job_header_t {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t size;
+};
+
+/** Environment variables providing defaults of options_t, which jobs
+  * take from the client rather than the server
+  */
+static const char *_forwarded_env[]={ ENV_CMD_SO, ENV_CMD_TARGET_O };
+
+static volatile sig_atomic_t _terminate=0;
+
+static void _on_terminate(int) {
+  _terminate=1;
+}
+
+static bool _write_all(int fd, const void *p, size_t n) {
+  while(n>0) {
+    ssize_t r=write(fd,p,n);
+    if ((r<0) && (errno==EINTR)) continue;
+    if (r<=0) return false;
+    p=(const char*)p+r;
+    n-=r;
+  }
+  return true;
+}
+
+static bool _read_all(int fd, void *p, size_t n) {
+  while(n>0) {
+    ssize_t r=read(fd,p,n);
+    if ((r<0) && (errno==EINTR)) continue;
+    if (r<=0) return false;
+    p=(char*)p+r;
+    n-=r;
+  }
+  return true;
+}
+
+/** Fills in the address of socket fn, false if the name is too long */
+static bool _address(const char *fn, struct sockaddr_un &addr) {
+  memset(&addr,0,sizeof(addr));
+  addr.sun_family=AF_UNIX;
+  if (strlen(fn)>=sizeof(addr.sun_path)) return false;
+  strcpy(addr.sun_path,fn);
+  return true;
+}
+
+/** Connects to the server listening on socket fn, -1 if there is none */
+static int _connect(const char *fn) {
+  struct sockaddr_un addr;
+  int fd;
+
+  if (!_address(fn,addr)) return -1;
+  if ((fd=socket(AF_UNIX,SOCK_STREAM,0))<0) return -1;
+  if (connect(fd,(struct sockaddr*)&addr,sizeof(addr))!=0) {
+    close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+CompileServer::CompileServer(const options_t &options, run_t run) :
+  _options(options), _run(run) {
+
+}
+
+int CompileServer::_job(
+  int c, const alp::string &pla_cache, const alp::string &target_cache,
+  const alp::string &segment_cache) {
+  _job_header_t hdr;
+  int fds[2];
+  char cmsg_buf[CMSG_SPACE(sizeof(fds))];
+  struct iovec iov={ &hdr, sizeof(hdr) };
+  struct msghdr msg;
+
+  memset(&msg,0,sizeof(msg));
+  msg.msg_iov=&iov;
+  msg.msg_iovlen=1;
+  msg.msg_control=cmsg_buf;
+  msg.msg_controllen=sizeof(cmsg_buf);
+
+  // the descriptors arrive with the first bytes of the header
+  ssize_t r=recvmsg(c,&msg,0);
+  struct cmsghdr *cmsg=CMSG_FIRSTHDR(&msg);
+  if ((r<=0) || !cmsg || (cmsg->cmsg_level!=SOL_SOCKET) ||
+      (cmsg->cmsg_type!=SCM_RIGHTS) ||
+      (cmsg->cmsg_len!=CMSG_LEN(sizeof(fds))))
+    return 1;
+  memcpy(fds,CMSG_DATA(cmsg),sizeof(fds));
+  if (!_read_all(c,(char*)&hdr+r,sizeof(hdr)-r) ||
+      (hdr.magic!=SERVER_MAGIC) || (hdr.version!=SERVER_VERSION))
+    return 1;
+
+  alp::array_t<char> payload;
+  payload.setlen(hdr.size+1);
+  if (!_read_all(c,payload.ptr,hdr.size)) return 1;
+  payload[hdr.size]=0;
+
+  // args holds the working directory followed by the arguments
+  alp::array_t<const char*> args, env;
+  enum { Cwd, Env, Args } part=Cwd;
+  for(size_t i=0;i<hdr.size;i+=strlen(payload.ptr+i)+1) {
+    const char *s=payload.ptr+i;
+    if (part==Env) {
+      if (*s) env.insert(s);
+      else part=Args;
+    } else {
+      args.insert(s);
+      if (part==Cwd) part=Env;
+    }
+  }
+  if (part!=Args) return 1;
+
+  // from now on, all output goes to the client
+  fflush(stdout);
+  fflush(stderr);
+  dup2(fds[0],STDOUT_FILENO);
+  dup2(fds[1],STDERR_FILENO);
+  close(fds[0]);
+  close(fds[1]);
+
+  if (chdir(args[0])!=0) {
+    fprintf(
+      stderr,"\x1b[31;1mERROR: unable to change to directory %s\x1b[30;0m\n",
+      args[0]);
+    return 1;
+  }
+
+  // the options of the job default to the client's environment, just as
+  // if it ran locally
+  for(size_t i=0;i<sizeof(_forwarded_env)/sizeof(_forwarded_env[0]);i++)
+    unsetenv(_forwarded_env[i]);
+  for(size_t i=0;i<env.len;i++) {
+    const char *e=strchr(env[i],'=');
+    if (!e) return 1;
+    alp::string name(env[i],(size_t)(e-env[i]));
+    for(size_t j=0;j<sizeof(_forwarded_env)/sizeof(_forwarded_env[0]);j++)
+      if (name==_forwarded_env[j]) setenv(name.ptr,e+1,1);
+  }
+
+  options_t options;
+  try {
+    if (options.parseCommandLine(args.len-1,args.ptr+1)==2) return 0;
+    if (options.serveSocket.len>0)
+      throw CommandLineError(
+        CommandLineError::Semantics,"cannot specify --serve in a job");
+  } catch(CommandLineError &e) {
+    options.print(stderr);
+    fprintf(stderr,"\x1b[31;1mERROR: %s\x1b[30;0m\n",e.what());
+    return 1;
+  }
+  if (options.plaCacheDir.len==0) options.plaCacheDir=pla_cache;
+  if (options.targetCacheDir.len==0) options.targetCacheDir=target_cache;
+  if (options.segmentCacheDir.len==0) options.segmentCacheDir=segment_cache;
+
+  return _run(options);
+}
+
+void CompileServer::serve() {
+  const char *fn=_options.serveSocket.ptr;
+  struct sockaddr_un addr;
+  int fd, c;
+
+  if (!_address(fn,addr))
+    throw RuntimeError(alp::string::Format("socket name %s too long",fn));
+  if ((c=_connect(fn))>=0) {
+    close(c);
+    throw RuntimeError(alp::string::Format(
+      "another server is listening on %s",fn));
+  }
+  unlink(fn);
+
+  if ((fd=socket(AF_UNIX,SOCK_STREAM,0))<0)
+    throw RuntimeError("unable to create socket");
+  if ((bind(fd,(struct sockaddr*)&addr,sizeof(addr))!=0) ||
+      (listen(fd,64)!=0)) {
+    close(fd);
+    throw RuntimeError(alp::string::Format("unable to listen on %s",fn));
+  }
+
+  // share caches between jobs, in a temporary directory unless given
+  TempDir tmpdir;
+  alp::string pla_cache=_options.plaCacheDir, target_cache=
+    _options.targetCacheDir, segment_cache=_options.segmentCacheDir;
+  if (pla_cache.len==0) pla_cache=tmpdir.path();
+  if (target_cache.len==0) target_cache=tmpdir.path();
+  if (segment_cache.len==0) segment_cache=tmpdir.path();
+
+  struct sigaction sa, sa_int, sa_term;
+  memset(&sa,0,sizeof(sa));
+  sa.sa_handler=_on_terminate;
+  // no SA_RESTART, so that accept returns on termination
+  sigaction(SIGINT,&sa,&sa_int);
+  sigaction(SIGTERM,&sa,&sa_term);
+  signal(SIGPIPE,SIG_IGN);
+
+  unsigned max_jobs=_options.jobs;
+  if (max_jobs==0) max_jobs=std::thread::hardware_concurrency();
+  if (max_jobs==0) max_jobs=1;
+  unsigned n_jobs=0;
+
+  alp::logf(
+    "INFO: serving on %s, running up to %u jobs\n",alp::LOGT_INFO,
+    fn,max_jobs);
+
+  while(!_terminate) {
+    while(waitpid(-1,NULL,(n_jobs<max_jobs) ? WNOHANG : 0)>0) n_jobs--;
+    if (n_jobs>=max_jobs) continue;
+
+    if ((c=accept(fd,NULL,NULL))<0) {
+      if (errno==EINTR) continue;
+      break;
+    }
+
+    pid_t pid=fork();
+    if (pid==0) {
+      close(fd);
+      sigaction(SIGINT,&sa_int,NULL);
+      sigaction(SIGTERM,&sa_term,NULL);
+      signal(SIGPIPE,SIG_DFL);
+
+      int32_t code=_job(c,pla_cache,target_cache,segment_cache);
+      fflush(stdout);
+      fflush(stderr);
+      _write_all(c,&code,sizeof(code));
+      _exit(code);
+    }
+    if (pid>0) n_jobs++;
+    close(c);
+  }
+
+  close(fd);
+  unlink(fn);
+  while(n_jobs>0) {
+    if (wait(NULL)>0) {
+      n_jobs--;
+    } else if (errno!=EINTR) {
+      break;
+    }
+  }
+  sigaction(SIGINT,&sa_int,NULL);
+  sigaction(SIGTERM,&sa_term,NULL);
+  alp::logf("INFO: server on %s terminated\n",alp::LOGT_INFO,fn);
+}
+
+bool CompileServer::Forward(
+  const char *socket, int argn, const char **argv, int &code) {
+  int fd=_connect(socket);
+  if (fd<0) return false;
+
+  alp::array_t<char> payload;
+  char *cwd=getcwd(NULL,0);
+  if (!cwd) {
+    close(fd);
+    return false;
+  }
+  payload.insert(cwd,strlen(cwd)+1);
+  free(cwd);
+  for(size_t i=0;i<sizeof(_forwarded_env)/sizeof(_forwarded_env[0]);i++) {
+    const char *v=getenv(_forwarded_env[i]);
+    if (!v) continue;
+    alp::string s=alp::string::Format("%s=%s",_forwarded_env[i],v);
+    payload.insert((char*)s.ptr,s.len+1);
+  }
+  payload.insert((char)0);
+  for(int i=0;i<argn;i++) payload.insert((char*)argv[i],strlen(argv[i])+1);
+
+  _job_header_t hdr={ SERVER_MAGIC, SERVER_VERSION, (uint32_t)payload.len };
+  int fds[2]={ STDOUT_FILENO, STDERR_FILENO };
+  char cmsg_buf[CMSG_SPACE(sizeof(fds))];
+  struct iovec iov={ &hdr, sizeof(hdr) };
+  struct msghdr msg;
+
+  memset(&msg,0,sizeof(msg));
+  memset(cmsg_buf,0,sizeof(cmsg_buf));
+  msg.msg_iov=&iov;
+  msg.msg_iovlen=1;
+  msg.msg_control=cmsg_buf;
+  msg.msg_controllen=sizeof(cmsg_buf);
+  struct cmsghdr *cmsg=CMSG_FIRSTHDR(&msg);
+  cmsg->cmsg_level=SOL_SOCKET;
+  cmsg->cmsg_type=SCM_RIGHTS;
+  cmsg->cmsg_len=CMSG_LEN(sizeof(fds));
+  memcpy(CMSG_DATA(cmsg),fds,sizeof(fds));
+
+  // flush before the server starts writing to our streams
+  fflush(stdout);
+  fflush(stderr);
+  ssize_t r;
+  do {
+    r=sendmsg(fd,&msg,MSG_NOSIGNAL);
+  } while((r<0) && (errno==EINTR));
+  if ((r<0) ||
+      !_write_all(fd,(char*)&hdr+r,sizeof(hdr)-r) ||
+      !_write_all(fd,payload.ptr,payload.len)) {
+    close(fd);
+    return false;
+  }
+
+  int32_t res;
+  if (_read_all(fd,&res,sizeof(res))) {
+    code=res;
+  } else {
+    fprintf(
+      stderr,
+      "\x1b[31;1mERROR: compile server terminated the job abnormally"
+      "\x1b[30;0m\n");
+    code=1;
+  }
+  close(fd);
+  return true;
+}
+
+/** Toolflow of the unittest, reporting the compile commands of the job by
+  * its exit code
+  */
+static int _test_run(options_t &options) {
+  if (options.cmdCompileTargetO!=options_t::Default_cmdCompileTargetO())
+    return 5;
+  if (options.cmdCompileSO=="client-cc") return 0;
+  if (options.cmdCompileSO=="cmdline-cc") return 4;
+  return 3;
+}
+
+unittest(
+  /*
+    testing:
+      CompileServer::Forward
+      CompileServer::_job
+  */
+  TempDir tmpdir;
+  options_t opts;
+  opts.serveSocket=tmpdir.path()+"server.sock";
+  opts.jobs=1;
+
+  // the server's environment must not leak into jobs
+  setenv(ENV_CMD_SO,"server-cc",1);
+  setenv(ENV_CMD_TARGET_O,"server-cc -c",1);
+  pid_t pid=fork();
+  if (pid==0) {
+    CompileServer server(opts,_test_run);
+    try {
+      server.serve();
+    } catch(RuntimeError &e) {
+      _exit(1);
+    }
+    _exit(0);
+  }
+  Assertf(pid>0, "unable to fork the server");
+
+  setenv(ENV_CMD_SO,"client-cc",1);
+  unsetenv(ENV_CMD_TARGET_O);
+  const char *args[]={ "test.input" };
+  const char *args_cmdline[]={ "--cmd-compile-so", "cmdline-cc", "test.input" };
+  int code=-1, code_cmdline=-1;
+  bool forwarded=false;
+  for(int i=0;(i<500) && !forwarded;i++) {
+    forwarded=CompileServer::Forward(opts.serveSocket.ptr,1,args,code);
+    if (!forwarded) usleep(10000);
+  }
+  bool forwarded_cmdline=
+    forwarded &&
+    CompileServer::Forward(opts.serveSocket.ptr,3,args_cmdline,code_cmdline);
+
+  kill(pid,SIGTERM);
+  waitpid(pid,NULL,0);
+  unsetenv(ENV_CMD_SO);
+
+  Assertf(forwarded && forwarded_cmdline, "unable to reach the server");
+  Assertf(code==0, "job did not use the client's commands (%i)",code);
+  Assertf(
+    code_cmdline==4, "job did not prefer the command line (%i)",code_cmdline);
+);
+
+#else
+#error "CompileServer not implemented for this OS"
+#endif
@@ -0,0 +1,75 @@
+/** \file server.h
+  * \brief Compile server running invocations forwarded over a Unix domain
+  * socket.
+  */
+#ifndef RISCV_LUT_COMPULER_SERVER_H
+#define RISCV_LUT_COMPULER_SERVER_H
+
+#include "error.h"
+#include "options.h"
+
+#include <alpha/alpha.h>
+
+/** Long-running compile server.
+  *
+  * Listens on a Unix domain socket for invocations forwarded by clients,
+  * see Forward. Each invocation consists of the command-line arguments,
+  * the working directory, the compile commands set in the environment
+  * (ENV_CMD_SO and ENV_CMD_TARGET_O) and the standard output and error
+  * streams of the client, and is run in a process forked off the server. Jobs thus start
+  * without loading and initializing the compiler, produce their output
+  * exactly as if run by the client and cannot affect each other or the
+  * server, even if a target function crashes. Up to options_t::jobs jobs
+  * run concurrently.
+  *
+  * Caches are shared between jobs through their on-disk directories: jobs
+  * not specifying a PLA, target or segment cache use those of the server.
+  * If the server was not given any, it uses a temporary directory for its
+  * lifetime. Compiled target functions are thus only compiled once.
+  *
+  * The server runs until it receives SIGINT or SIGTERM.
+  */
+class CompileServer {
+  public:
+    /** Runs the toolflow selected by a job's options, returning its exit
+      * code.
+      */
+    typedef int (*run_t)(options_t &options);
+
+  protected:
+    const options_t &_options;
+    run_t _run;
+
+    /** Runs the job received on connection c, in the forked process */
+    int _job(int c, const alp::string &pla_cache,
+      const alp::string &target_cache, const alp::string &segment_cache);
+
+  public:
+    /** Constructor.
+      *
+      * \param options Options of the server, options_t::serveSocket giving
+      * the socket to listen on.
+      */
+    CompileServer(const options_t &options, run_t run);
+
+    /** Serves jobs until terminated.
+      *
+      * \throw RuntimeError The socket could not be set up or another server
+      * is listening on it.
+      */
+    void serve();
+
+    /** Forwards an invocation to a server.
+      *
+      * \param socket Socket the server is listening on.
+      * \param argn Number of command-line arguments, as passed to
+      * options_t::parseCommandLine.
+      * \param code Receives the exit code of the job.
+      * \return false if no server could be reached, in which case the
+      * invocation needs to be run locally.
+      */
+    static bool Forward(
+      const char *socket, int argn, const char **argv, int &code);
+};
+
+#endif
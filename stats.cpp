@@ -0,0 +1,200 @@
+#include "stats.h"
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <mutex>
+
+thread_local Stats::_thread_record_t Stats::_local;
+
+/** Totals of all exited threads */
+static Stats::record_t _totals;
+static std::mutex _totals_lock;
+
+static const char *_phase_names[Stats::NUM_PHASES]={
+  "parse",
+  "target-compile",
+  "target-load",
+  "segment-space",
+  #define SEGMENT_STRATEGY(id,name) "segmentation:" name,
+  #include "strategy-decl.h"
+  #undef SEGMENT_STRATEGY
+  "approximation",
+  "qmc-minimize",
+  "translate",
+  "output",
+  "error-evaluation"
+};
+
+static const char *_counter_names[Stats::NUM_COUNTERS]={
+  "target-evaluations",
+  "weight-evaluations",
+  "qmc-rounds",
+  "implicants"
+};
+
+/** Returns the current time of clock in seconds */
+static double _now(clockid_t clock) {
+  struct timespec ts;
+  clock_gettime(clock,&ts);
+  return ts.tv_sec+ts.tv_nsec*1e-9;
+}
+
+Stats::record_t::record_t() {
+  memset(calls,0,sizeof(calls));
+  memset(wall,0,sizeof(wall));
+  memset(cpu,0,sizeof(cpu));
+  memset(counters,0,sizeof(counters));
+  error_sum=0;
+  error_weight=0;
+}
+
+void Stats::record_t::add(const record_t &r) {
+  for(int i=0;i<NUM_PHASES;i++) {
+    calls[i]+=r.calls[i];
+    wall[i]+=r.wall[i];
+    cpu[i]+=r.cpu[i];
+  }
+  for(int i=0;i<NUM_COUNTERS;i++) counters[i]+=r.counters[i];
+  error_sum+=r.error_sum;
+  error_weight+=r.error_weight;
+}
+
+Stats::_thread_record_t::~_thread_record_t() {
+  std::lock_guard<std::mutex> lock(_totals_lock);
+  _totals.add(*this);
+}
+
+Stats::Timer::Timer(phase_t phase) :
+  _phase(phase),
+  _wall(_now(CLOCK_MONOTONIC)), _cpu(_now(CLOCK_THREAD_CPUTIME_ID)) {
+
+}
+
+Stats::Timer::~Timer() {
+  _local.calls[_phase]++;
+  _local.wall[_phase]+=_now(CLOCK_MONOTONIC)-_wall;
+  _local.cpu[_phase]+=_now(CLOCK_THREAD_CPUTIME_ID)-_cpu;
+}
+
+Stats::Uncounted::Uncounted() {
+  memcpy(_counters,_local.counters,sizeof(_counters));
+}
+
+Stats::Uncounted::~Uncounted() {
+  memcpy(_local.counters,_counters,sizeof(_counters));
+}
+
+const char *Stats::PhaseName(phase_t p) {
+  return _phase_names[p];
+}
+
+const char *Stats::CounterName(counter_t c) {
+  return _counter_names[c];
+}
+
+void Stats::Get(record_t &res) {
+  res=record_t();
+  {
+    std::lock_guard<std::mutex> lock(_totals_lock);
+    res.add(_totals);
+  }
+  res.add(_local);
+}
+
+void Stats::Reset() {
+  std::lock_guard<std::mutex> lock(_totals_lock);
+  _totals=record_t();
+  (record_t&)_local=record_t();
+}
+
+void Stats::Print(FILE *f) {
+  record_t r;
+  Get(r);
+
+  fprintf(f,"%-32s %10s %12s %12s\n","phase","calls","wall [s]","cpu [s]");
+  for(int i=0;i<NUM_PHASES;i++) {
+    if (r.calls[i]==0) continue;
+    fprintf(
+      f,"%-32s %10lu %12.6f %12.6f\n",_phase_names[i],
+      (unsigned long)r.calls[i],r.wall[i],r.cpu[i]);
+  }
+  fprintf(f,"%-32s %10s\n","counter","count");
+  for(int i=0;i<NUM_COUNTERS;i++) {
+    fprintf(
+      f,"%-32s %10lu\n",_counter_names[i],(unsigned long)r.counters[i]);
+  }
+  if (r.error_weight>0) {
+    fprintf(
+      f,"%-32s %10g\n","rms approximation error",
+      sqrt(r.error_sum/r.error_weight));
+  }
+}
+
+void Stats::SaveJSON(const char *fn) {
+  record_t r;
+  Get(r);
+
+  FILE *f=fopen(fn,"w");
+  if (!f) throw FileIOException(fn);
+
+  fprintf(f,"{\n  \"phases\": {");
+  const char *sep="\n";
+  for(int i=0;i<NUM_PHASES;i++) {
+    fprintf(
+      f,"%s    \"%s\": { \"calls\": %lu, \"wall\": %.9f, \"cpu\": %.9f }",
+      sep,_phase_names[i],(unsigned long)r.calls[i],r.wall[i],r.cpu[i]);
+    sep=",\n";
+  }
+  fprintf(f,"\n  },\n  \"counters\": {");
+  sep="\n";
+  for(int i=0;i<NUM_COUNTERS;i++) {
+    fprintf(
+      f,"%s    \"%s\": %lu",sep,_counter_names[i],
+      (unsigned long)r.counters[i]);
+    sep=",\n";
+  }
+  fprintf(f,"\n  },\n  \"approximation-error\": {\n");
+  fprintf(
+    f,"    \"rms\": %.9g,\n    \"weight\": %.9g\n  }\n}\n",
+    (r.error_weight>0) ? sqrt(r.error_sum/r.error_weight) : 0.0,
+    r.error_weight);
+
+  if (ferror(f)) {
+    fclose(f);
+    throw FileIOException(fn);
+  }
+  if (fclose(f)!=0) throw FileIOException(fn);
+}
+
+unittest(
+  /*
+    testing:
+      Stats::Timer
+      Stats::Uncounted
+      Stats::Count
+      Stats::Get
+  */
+  Stats::record_t before, after;
+  Stats::Get(before);
+  {
+    Stats::Timer t(Stats::Output);
+    Stats::Count(Stats::Implicants,3);
+    Stats::Uncounted u;
+    Stats::Count(Stats::Implicants,5);
+  }
+  Stats::Get(after);
+  Assertf(
+    after.calls[Stats::Output]==before.calls[Stats::Output]+1,
+    "expected one more call of the timed phase");
+  Assertf(
+    after.counters[Stats::Implicants]==before.counters[Stats::Implicants]+3,
+    "expected the counter to advance by 3");
+  Assertf(
+    after.wall[Stats::Output]>=before.wall[Stats::Output],
+    "wall time decreased");
+  Assertf(
+    !strcmp(
+      Stats::PhaseName(Stats::SegmentationPhase(segment_strategy::ID_UNIFORM)),
+      "segmentation:uniform"),
+    "segmentation phases out of order");
+);
@@ -0,0 +1,149 @@
+/** \file stats.h
+  * \brief Timing and event counters of the compilation phases.
+  */
+#ifndef RISCV_LUT_COMPULER_STATS_H
+#define RISCV_LUT_COMPULER_STATS_H
+
+#include "error.h"
+#include "strategy-def.h"
+
+#include <alpha/alpha.h>
+#include <stdint.h>
+#include <stdio.h>
+
+/** Process-wide statistics of the compilation.
+  *
+  * Records the number of calls, the wall time and the CPU time of each
+  * phase, as well as counters of events such as target function
+  * evaluations. Phases may be nested, e.g. target compilation happens
+  * during parsing, and their times always include those of nested phases.
+  *
+  * Statistics are always collected. They are accumulated per thread
+  * without synchronization and added to the process-wide totals when the
+  * thread exits, so that counting an event costs a thread-local increment.
+  * Totals of multiple threads are summed, thus wall times of phases run
+  * concurrently may exceed the wall time of the process.
+  */
+class Stats {
+  public:
+    enum phase_t {
+      Parse=0,
+      TargetCompile,
+      TargetLoad,
+      SegmentSpace,
+      #define SEGMENT_STRATEGY(id,name) Segmentation_##id,
+      #include "strategy-decl.h"
+      #undef SEGMENT_STRATEGY
+      Approximation,
+      QMCMinimize,
+      Translate,
+      Output,
+      ErrorEvaluation,
+      NUM_PHASES
+    };
+
+    enum counter_t {
+      /** Evaluations of the target function */
+      TargetEvaluations=0,
+      /** Evaluations of weights tables */
+      WeightEvaluations,
+      /** Rounds of combining implicants during PLA minimization */
+      QMCRounds,
+      /** Implicants of minimized PLA configurations */
+      Implicants,
+      NUM_COUNTERS
+    };
+
+    /** Statistics of one thread or of the whole process */
+    struct record_t {
+      uint64_t calls[NUM_PHASES];
+      /** Wall time per phase in seconds */
+      double wall[NUM_PHASES];
+      /** CPU time per phase in seconds */
+      double cpu[NUM_PHASES];
+      uint64_t counters[NUM_COUNTERS];
+      /** Weighted sum of the mean squared approximation errors of all
+        * segments evaluated, see AddError.
+        */
+      double error_sum;
+      /** Sum of the weights of error_sum */
+      double error_weight;
+
+      record_t();
+
+      void add(const record_t &r);
+    };
+
+    /** Times a phase from construction to destruction */
+    class Timer {
+      protected:
+        phase_t _phase;
+        double _wall;
+        double _cpu;
+      public:
+        Timer(phase_t phase);
+        ~Timer();
+    };
+
+    /** Excludes the events of the calling thread from construction to
+      * destruction from the counters, e.g. those of evaluating the result
+      * of the compilation.
+      */
+    class Uncounted {
+      protected:
+        uint64_t _counters[NUM_COUNTERS];
+      public:
+        Uncounted();
+        ~Uncounted();
+    };
+
+  protected:
+    /** Statistics of a thread, added to the totals when it exits */
+    struct _thread_record_t : record_t {
+      ~_thread_record_t();
+    };
+
+    /** Statistics of the calling thread not yet added to the totals */
+    static thread_local _thread_record_t _local;
+
+  public:
+    /** Counts n events of kind c */
+    static void Count(counter_t c, uint64_t n=1) {
+      _local.counters[c]+=n;
+    }
+
+    /** Records the approximation error of a segment, its mean square 
+      * error being mean over points of total weight weight.
+      */
+    static void AddError(double mean, double weight) {
+      _local.error_sum+=mean*weight;
+      _local.error_weight+=weight;
+    }
+
+    /** Returns the phase of running the segmentation strategy id */
+    static phase_t SegmentationPhase(segment_strategy::id_t id) {
+      return (phase_t)(SegmentSpace+id);
+    }
+
+    /** Returns the name of phase p */
+    static const char *PhaseName(phase_t p);
+    /** Returns the name of counter c */
+    static const char *CounterName(counter_t c);
+
+    /** Returns the totals of all exited threads and the calling thread */
+    static void Get(record_t &res);
+
+    /** Discards the totals and the statistics of the calling thread */
+    static void Reset();
+
+    /** Prints a summary table of the totals to f */
+    static void Print(FILE *f);
+
+    /** Writes the totals as a JSON object.
+      *
+      * \throw FileIOException The file could not be written to.
+      */
+    static void SaveJSON(const char *fn);
+};
+
+#endif
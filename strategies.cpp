@@ -1,4 +1,7 @@
 #include "strategies.h"
+#include <math.h>
+#include <queue>
+#include <algorithm>
 
 namespace segment_strategy {
   const record_t *get(id_t id_in) {
@@ -11,6 +14,195 @@ namespace segment_strategy {
     return NULL;
   }
 
+  bool usesApproximation(id_t primary, id_t secondary) {
+    if ((primary!=INVALID) && get(primary)->handlesApproximation) 
+      return true;
+    if (secondary!=INVALID) {
+      const record_t *r=get(secondary);
+      return r->handlesApproximation || (r->optimize==NULL);
+    }
+    return false;
+  }
+
+  /** Candidate for receiving one more segment during secondary segmentation
+    * budget allocation.
+    */
+  struct _budget_candidate_t {
+    /** Index of the primary segment */
+    size_t index;
+    /** Error reduction achieved by granting one more segment */
+    double gain;
+
+    bool operator<(const _budget_candidate_t &c) const {
+      // ties are broken in favour of the lower index
+      if (gain!=c.gain) return gain<c.gain;
+      return index>c.index;
+    }
+  };
+
+  /** Distributes n_avail additional segments among the primary segments by
+    * greedily picking the one with the greatest marginal error reduction.
+    *
+    * The error of each primary segment is computed exactly once using the
+    * registered approximation strategy. The error resulting from k
+    * subsegments is then estimated as error/k^order, order being the
+    * approximation strategy's errorOrder. Without an approximation strategy,
+    * the segments are distributed evenly.
+    *
+    * Computing the errors is one approximation and error pass over the 
+    * domain, as the primary strategies subdividing the domain (uniform, 
+    * log) do not approximate. It costs about as much as the approximation 
+    * run after segmentation and less than the subdivision itself, which
+    * evaluates each primary segment at least once. The pass is skipped if 
+    * the errors cannot affect the allocation, i.e. if there are enough 
+    * segments to subdivide all primary segments down to principal ones, or
+    * if only one of them can be subdivided at all.
+    *
+    * \param budget Receives the number of segments for each primary segment,
+    * including the primary segment itself.
+    */
+  static void _allocate_budget(
+    LookupTable *lut, WeightsTable *weights, const options_t &options,
+    const alp::array_t<segment_t> &primary, uint32_t n_avail, 
+    alp::array_t<uint32_t> &budget) {
+    
+    budget.setlen(primary.len);
+    for(size_t i=0;i<primary.len;i++) budget[i]=1;
+    
+    if (lut->approximation_strategy()==approx_strategy::INVALID) {
+      for(size_t i=0;i<primary.len;i++) {
+        uint32_t n_each=n_avail/(primary.len-i);
+        // number of segments distributed evenly
+        // + 1 if there are still remainders
+        uint32_t n_this=n_each + (((n_avail-n_each*(primary.len-i))>0) ? 1 : 0);
+        budget[i]+=n_this;
+        n_avail-=n_this;
+      }
+      return;
+    }
+    
+    // primary segments can only be subdivided into principal segments
+    uint32_t n_capacity=0;
+    size_t n_divisible=0;
+    for(size_t i=0;i<primary.len;i++) {
+      n_capacity+=primary[i].width-1;
+      if (primary[i].width>1) n_divisible++;
+    }
+    if ((n_capacity<=n_avail) || (n_divisible<=1)) {
+      for(size_t i=0;i<primary.len;i++) {
+        uint32_t n_this=std::min(primary[i].width-1,n_avail);
+        budget[i]+=n_this;
+        n_avail-=n_this;
+      }
+      return;
+    }
+
+    const approx_strategy::record_t *approximation=
+      approx_strategy::get(lut->approximation_strategy());
+    double order=
+      (approximation->errorOrder>0) ? approximation->errorOrder : 2;
+
+    // restrict error computation to the domain, like min-error does
+    if (weights==NULL) weights=new WeightsTable(lut->bounds());
+    weights->grab();
+
+    alp::array_t<double> errors;
+    std::priority_queue<_budget_candidate_t> heap;
+    
+    errors.setlen(primary.len);
+    for(size_t i=0;i<primary.len;i++) {
+      segment_t seg=primary[i];
+      approximation->handle_segment(lut,weights,options,seg,seg.y0,seg.y1);
+      deviation_t e=lut->computeSegmentError(error_square,weights,seg);
+      errors[i]=e.mean*e.weight;
+
+      if (seg.width>1)
+        heap.push({i,errors[i]*(1-pow(2,-order))});
+    }
+    
+    weights->drop();
+
+    while((n_avail>0) && !heap.empty()) {
+      _budget_candidate_t c=heap.top();
+      heap.pop();
+
+      uint32_t k=++budget[c.index];
+      n_avail--;
+      
+      // a segment cannot be subdivided beyond principal segments
+      if (k>=primary[c.index].width) continue;
+      c.gain=
+        errors[c.index]*(pow((double)k,-order)-pow((double)(k+1),-order));
+      heap.push(c);
+    }
+  }
+
+#define TEST_BUDGET(target,approximation,n_avail,code) { \
+  LookupTable lut(opts); \
+  alp::array_t<uint32_t> budget; \
+  \
+  const char *input= \
+    "name=\"test\" bounds=\"(0,1023)\" " \
+    "segments=\"uniform\" " approximation \
+    "\n%%\n" \
+    "target int->int\n" \
+    "\n%%\n" \
+    "int target(int a) { return " target "; }\n" \
+    ; \
+  lut.parseInput(input,strlen(input),"test lut"); \
+  lut.computeSegmentSpace(); \
+  _allocate_budget(&lut,NULL,opts,primary,n_avail,budget); \
+  Assertf(budget.len==primary.len, "expected a budget per segment"); \
+  for(size_t i=0;i<budget.len;i++) \
+    Assertf( \
+      (budget[i]>=1) && (budget[i]<=primary[i].width), \
+      "budget %u of segment %zu exceeds its width %u", \
+      budget[i],i,primary[i].width); \
+  code \
+}
+
+  unittest(
+    /*
+      testing:
+        _allocate_budget
+    */
+    options_t opts;
+    opts.arch.selectorBits=4;
+    opts.arch.segmentBits=4;
+    opts.arch.interpolationBits=6;
+
+    alp::array_t<segment_t> primary;
+    primary.insert(segment_t(0,4));
+    primary.insert(segment_t(4,4));
+    primary.insert(segment_t(8,8));
+
+    // constant first, quadratic and thus of increasing error after
+    TEST_BUDGET("(a<256) ? 0 : (a*a)>>6","approximation=\"linear\" ",9,
+      Assertf(budget[0]==1, "expected no segments for the exact segment");
+      Assertf(
+        budget[2]>budget[1],
+        "expected more segments for the segment of greater error");
+      Assertf(
+        budget[0]+budget[1]+budget[2]==12, 
+        "expected all segments to be allocated");
+    )
+    // enough segments to subdivide everything
+    TEST_BUDGET("(a*a)>>6","approximation=\"linear\" ",20,
+      for(size_t i=0;i<budget.len;i++)
+        Assertf(
+          budget[i]==primary[i].width,
+          "expected segment %zu to be fully subdivided",i);
+    )
+    // no approximation strategy
+    TEST_BUDGET("(a*a)>>6","",6,
+      for(size_t i=0;i<budget.len;i++)
+        Assertf(
+          budget[i]==3, "expected an even split, got %u for segment %zu",
+          budget[i],i);
+    )
+  )
+#undef TEST_BUDGET
+
   void record_t::execute(
     LookupTable *lut, WeightsTable *weights, options_t &options) const {
     if (lut->segments().len>0) { // secondary strategy
@@ -34,15 +226,20 @@ namespace segment_strategy {
 
       uint32_t n_avail=n_total-primary.len;
 
+      // number of segments each primary segment is to be subdivided into,
+      // including the original one.
+      alp::array_t<uint32_t> budget;
+      _allocate_budget(lut,weights,options,primary,n_avail,budget);
+
       lut->clearSegments();
 
+      // segments that were granted to a primary segment but not consumed by
+      // its subdivision are handed on to the next one.
+      uint32_t n_carry=0;
+
       for(size_t i=0;i<primary.len;i++) {
         
-        uint32_t n_each=n_avail/(primary.len-i);
-        // number of segments distributed evenly
-        // + 1 if there are still remainders
-        // + 1 (original segment)
-        uint32_t n_this=n_each + (((n_avail-n_each*(primary.len-i))>0) ? 1 : 0) +1;
+        uint32_t n_this=budget[i]+n_carry;
 
         segment_t &seg=primary[i];
         
@@ -53,8 +250,7 @@ namespace segment_strategy {
         uint32_t count=subdivide(
           lut,weights,options,seg.prefix,seg.prefix+seg.width,n_this);
         
-        // we freed one segment (the original one) and consumed count ones.
-        n_avail=n_avail+1-count;
+        n_carry=(count<n_this) ? n_this-count : 0;
 
       }
 
@@ -81,6 +81,17 @@ namespace segment_strategy {
     * of the strategy as defined in strategy-def.h.
     */
   const record_t *get(id_t id_in); 
+
+  /** Checks whether segmenting with the primary and secondary strategies
+    * given evaluates the approximation strategy, and with it the weights 
+    * table, i.e. whether the resulting segments depend on them.
+    *
+    * This is the case for strategies handling approximation themselves and
+    * for secondary segmentation by subdivision, which distributes segments
+    * according to the approximation error. INVALID denotes an unused 
+    * strategy.
+    */
+  bool usesApproximation(id_t primary, id_t secondary);
 } // namespace segment_strategy
 
 namespace approx_strategy {
@@ -101,6 +112,15 @@ namespace approx_strategy {
       */
     handle_segment_t handle_segment;
 
+    /** Exponent at which the (square) approximation error of a segment 
+      * decreases when shrinking its width, i.e. halving a segment divides
+      * its error by roughly 2^errorOrder. 
+      *
+      * Used for estimating errors without evaluating the target function.
+      * Zero if unknown.
+      */
+    int errorOrder;
+
     /** Entry point to be called by the tool flow.
       *
       * Wraps around handle_segment in order to perform common tasks thus 
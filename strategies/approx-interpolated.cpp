@@ -11,7 +11,8 @@ static void _handle_segment(
 
 namespace approx_strategy {
   const record_t INTERPOLATED {
-    .handle_segment=_handle_segment
+    .handle_segment=_handle_segment,
+    .errorOrder=4
   };
 
 };
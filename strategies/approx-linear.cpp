@@ -105,7 +105,8 @@ unittest(
 
 namespace approx_strategy {
   const record_t LINEAR {
-    .handle_segment=_handle_segment
+    .handle_segment=_handle_segment,
+    .errorOrder=4
   };
 
 };
@@ -86,7 +86,8 @@ unittest(
 
 namespace approx_strategy {
   const record_t STEP {
-    .handle_segment=_handle_segment
+    .handle_segment=_handle_segment,
+    .errorOrder=2
   };
 
 };
@@ -1,5 +1,6 @@
 #include "../strategies.h"
 #include "../deviation.h"
+#include <math.h>
 
 /** Represents a candidate for a single optimization step.
   *
@@ -37,6 +38,39 @@ struct candidate_t {
   seg_data_t remove_end;
 };
 
+/** Returns the figure of merit of a candidate, larger being better.
+  *
+  * This is the reduction of the error by the replacement if use_gain is 
+  * set, the negated error of the replacement otherwise. Replacements 
+  * without error have infinite gain, those covering no weight at all (whose
+  * error is undefined) the least merit.
+  */
+static double _merit(const candidate_t &c, bool split, bool use_gain) {
+  double res;
+  if (!use_gain) {
+    res=-(split ? (c.error1+c.error2).mean : c.error1.mean);
+  } else {
+    double error1=split ? c.error1.mean+c.error2.mean : c.error1.mean;
+    res=(error1>0) ? c.error0.mean/error1 : INFINITY;
+  }
+  return isnan(res) ? -INFINITY : res;
+}
+
+/** Returns true iff candidate a is to be chosen over candidate b.
+  *
+  * Candidates of equal merit are ordered by the index of the segment they
+  * replace and then by the width of their first segment, so that the 
+  * choice does not depend on the order in which candidates are evaluated.
+  */
+static bool _better(
+  const candidate_t &a, const candidate_t &b, bool split, bool use_gain) {
+  if (b.index<0) return true;
+  double merit_a=_merit(a,split,use_gain), merit_b=_merit(b,split,use_gain);
+  if (merit_a!=merit_b) return merit_a>merit_b;
+  if (a.index!=b.index) return a.index<b.index;
+  return a.segment1.width<b.segment1.width;
+}
+
 
 static void _optimize(
   LookupTable *lut, WeightsTable *weights, 
@@ -123,17 +157,7 @@ static void _optimize(
 
       if (new_candidate.error1>new_candidate.error0) continue;
       
-      bool better=best_candidate.index<0;
-      
-      if (use_gain) {
-        better|= 
-          (best_candidate.error0.mean/best_candidate.error1.mean) <
-          (new_candidate.error0.mean/new_candidate.error1.mean);
-      } else {
-        better|=
-          (best_candidate.error1>new_candidate.error1);
-      }
-      if (better) 
+      if (_better(new_candidate,best_candidate,false,use_gain)) 
         best_candidate=new_candidate;
       
     }
@@ -191,23 +215,7 @@ static void _optimize(
         if (new_candidate.error1+new_candidate.error2>new_candidate.error0) 
           continue;
         
-        bool better=best_candidate.index<0;
-        
-        if (use_gain) {
-          better|= 
-            (
-              best_candidate.error0.mean/
-              (best_candidate.error1.mean+best_candidate.error2.mean)) <
-            (
-              new_candidate.error0.mean/
-              (new_candidate.error1.mean+new_candidate.error2.mean));
-        } else {
-          better|=
-            (
-              (best_candidate.error1+best_candidate.error1)>
-              (new_candidate.error1+new_candidate.error2));
-        }
-        if (better) 
+        if (_better(new_candidate,best_candidate,true,use_gain)) 
           best_candidate=new_candidate;
       }
     }
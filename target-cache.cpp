@@ -0,0 +1,140 @@
+#include "target-cache.h"
+#include "util.h"
+#include <unordered_map>
+#include <mutex>
+#include <atomic>
+#include <stdio.h>
+#include <unistd.h>
+
+struct _entry_t {
+  dynamic_library_t *lib;
+  void *func;
+};
+
+static std::unordered_map<TargetCache::key_t,_entry_t> _entries;
+static std::mutex _entries_lock;
+static std::atomic<unsigned> _n_tmp_files(0);
+
+/** Returns the common part of the file names of the on-disk entry for key,
+  * which consists of the shared object and a file holding the key.
+  */
+static alp::string _file_name(
+  const TargetCache::key_t &key, const alp::string &dir) {
+  uint64_t h=hash_fnv1a(key.data(),key.size());
+  return alp::string::Format("%s/%.16lx",dir.ptr,(unsigned long)h);
+}
+
+/** Copies the file src to dst via a temporary file, so that concurrent
+  * readers never see a partial file.
+  */
+static bool _copy_file(const alp::string &src, const alp::string &dst) {
+  alp::string fn_tmp=alp::string::Format(
+    "%s.%i.%u.tmp",dst.ptr,(int)getpid(),_n_tmp_files++);
+  FILE *fs=fopen(src.ptr,"rb"), *fd;
+  char buf[65536];
+  size_t n;
+  bool ok=true;
+
+  if (!fs) return false;
+  if (!(fd=fopen(fn_tmp.ptr,"wb"))) {
+    fclose(fs);
+    return false;
+  }
+  while(ok && ((n=fread(buf,1,sizeof(buf),fs))>0))
+    ok=fwrite(buf,1,n,fd)==n;
+  ok=!ferror(fs) && ok;
+  fclose(fs);
+  ok=(fclose(fd)==0) && ok;
+  if (!ok || (rename(fn_tmp.ptr,dst.ptr)!=0)) {
+    unlink(fn_tmp.ptr);
+    return false;
+  }
+  return true;
+}
+
+/** Loads the on-disk entry for key, NULL if there is none */
+static void *_load(
+  const TargetCache::key_t &key, const alp::string &dir, const char *symbol,
+  dynamic_library_t *&lib) {
+  alp::string fn=_file_name(key,dir);
+  FILE *f=fopen((fn+".key").ptr,"rb");
+  if (!f) return NULL;
+
+  // the full key rules out hash collisions
+  std::string stored;
+  char buf[4096];
+  size_t n;
+  while((n=fread(buf,1,sizeof(buf),f))>0) stored.append(buf,n);
+  fclose(f);
+  if (stored!=key) return NULL;
+
+  if (!(lib=dlib_open((fn+".so").ptr))) return NULL;
+  void *func=dlib_lookup(lib,symbol);
+  if (!func) dlib_close(lib);
+  return func;
+}
+
+TargetCache::key_t TargetCache::Key(
+  const alp::string &cmd, const alp::string &source) {
+  key_t key(cmd.ptr,cmd.len);
+  key.push_back('\0');
+  key.append(source.ptr,source.len);
+  return key;
+}
+
+void *TargetCache::Lookup(
+  const key_t &key, const alp::string &dir, const char *symbol) {
+  {
+    std::lock_guard<std::mutex> lock(_entries_lock);
+    auto it=_entries.find(key);
+    if (it!=_entries.end()) return it->second.func;
+  }
+  if (dir.len==0) return NULL;
+
+  dynamic_library_t *lib;
+  void *func=_load(key,dir,symbol,lib);
+  if (!func) return NULL;
+
+  std::lock_guard<std::mutex> lock(_entries_lock);
+  auto it=_entries.find(key);
+  if (it!=_entries.end()) {
+    dlib_close(lib);
+    return it->second.func;
+  }
+  _entry_t &e=_entries[key];
+  e.lib=lib;
+  e.func=func;
+  return func;
+}
+
+void *TargetCache::Store(
+  const key_t &key, const alp::string &dir, dynamic_library_t *lib,
+  void *func, const alp::string &fn_lib) {
+  {
+    std::lock_guard<std::mutex> lock(_entries_lock);
+    auto it=_entries.find(key);
+    if (it!=_entries.end()) {
+      // compiled concurrently, keep the library loaded first
+      dlib_close(lib);
+      return it->second.func;
+    }
+    _entry_t &e=_entries[key];
+    e.lib=lib;
+    e.func=func;
+  }
+  if (dir.len==0) return func;
+
+  // store the shared object before its key, so that a key found on disk
+  // always refers to a complete shared object
+  alp::string fn=_file_name(key,dir);
+  alp::string fn_key=alp::string::Format(
+    "%s.key.%i.%u.tmp",fn.ptr,(int)getpid(),_n_tmp_files++);
+  if (!_copy_file(fn_lib,fn+".so")) return func;
+  
+  FILE *f=fopen(fn_key.ptr,"wb");
+  if (!f) return func;
+  bool ok=fwrite(key.data(),1,key.size(),f)==key.size();
+  ok=(fclose(f)==0) && ok;
+  if (!ok || (rename(fn_key.ptr,(fn+".key").ptr)!=0)) unlink(fn_key.ptr);
+  return func;
+}
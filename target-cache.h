@@ -0,0 +1,58 @@
+/** \file target-cache.h
+  * \brief Memoization of compiled target functions.
+  */
+#ifndef RISCV_LUT_COMPULER_TARGET_CACHE_H
+#define RISCV_LUT_COMPULER_TARGET_CACHE_H
+
+#include "dlib.h"
+
+#include <alpha/alpha.h>
+#include <string>
+
+/** Cache of target functions compiled into shared objects.
+  *
+  * A compiled target function only depends on the source code generated
+  * for it and the command compiling it, which form the key of an entry. 
+  * Entries hold the loaded library, which stays loaded for the lifetime of
+  * the process, so that LUTs with the same target code are only compiled
+  * and loaded once.
+  *
+  * If a directory is given, the shared objects are also stored there, 
+  * together with their keys, so that later invocations only need to load
+  * them. Failing to access the directory is not an error, the entry is 
+  * then simply not cached on disk.
+  *
+  * All methods may be called concurrently.
+  */
+class TargetCache {
+  public:
+    typedef std::string key_t;
+
+    /** Computes the key of compiling source with the command cmd */
+    static key_t Key(const alp::string &cmd, const alp::string &source);
+
+    /** Looks up the target function stored for key.
+      *
+      * \param dir Directory of the on-disk cache, none if empty
+      * \param symbol Name of the target function in the shared object
+      * \return The function, NULL if there is no entry.
+      */
+    static void *Lookup(
+      const key_t &key, const alp::string &dir, const char *symbol);
+
+    /** Stores the target function func of the library lib for key, passing
+      * ownership of lib to the cache.
+      *
+      * If an entry was stored for key in the meantime, lib is closed and the
+      * function of that entry is used instead.
+      *
+      * \param dir Directory of the on-disk cache, none if empty
+      * \param fn_lib File the library was loaded from, copied to dir
+      * \return The function stored for key.
+      */
+    static void *Store(
+      const key_t &key, const alp::string &dir, dynamic_library_t *lib,
+      void *func, const alp::string &fn_lib);
+};
+
+#endif
@@ -0,0 +1,310 @@
+#!/usr/bin/env python3
+"""Runs the regression tests of the LUT compiler concurrently.
+
+A test case is a <name>.input file in a directory below tests/ together
+with <name>.arch. The case compiles the input to its intermediate
+representation, which must match <name>.lut.cmp. If there is a
+<name>.dump.cmp, the intermediate representation is then compiled to a
+bitstream dump which must match it.
+
+Cases sharing an architecture are compiled together with --batch, so that
+they share the weights tables and caches of one compiler process. The
+batches are run concurrently, one per job.
+
+Unless disabled, the inputs of each architecture are additionally compiled
+to bitstream dumps with --deterministic using one thread and using one
+thread per job, and the dumps must be identical.
+"""
+
+import argparse
+import concurrent.futures
+import difflib
+import glob
+import hashlib
+import json
+import os
+import shutil
+import subprocess as sp
+import sys
+import tempfile
+import time
+
+# lines of a diff printed per failing comparison
+MAX_DIFF_LINES = 40
+
+
+class Case:
+    def __init__(self, root, fn_input):
+        self.base = fn_input[:-len(".input")]
+        self.name = os.path.relpath(self.base, root)
+        self.fn_arch = self.base + ".arch"
+        self.has_dump = os.path.exists(self.base + ".dump.cmp")
+        self.ok = False
+        self.message = ""
+        self.time = 0.0
+        self.batch_size = 0
+
+    def outputs(self):
+        res = [self.base + ".lut"]
+        if self.has_dump:
+            res.append(self.base + ".dump")
+        return res
+
+
+def discover(root, patterns):
+    """Returns the cases below root whose names contain any of patterns."""
+    res = []
+    for fn in sorted(glob.glob(os.path.join(root, "*", "*.input"))):
+        case = Case(root, fn)
+        if patterns and not any(p in case.name for p in patterns):
+            continue
+        res.append(case)
+    return res
+
+
+class DeterminismCheck:
+    """Checks that the cases of one architecture compile to the same
+    bitstreams regardless of the number of threads.
+    """
+
+    def __init__(self, cases):
+        self.cases = cases
+        self.name = "determinism:%s" % cases[0].name
+        self.ok = False
+        self.message = ""
+        self.time = 0.0
+        self.batch_size = len(cases)
+
+
+def group_by_arch(cases):
+    """Returns lists of the cases sharing an architecture."""
+    by_arch = {}
+    for case in cases:
+        try:
+            with open(case.fn_arch, "rb") as f:
+                key = hashlib.sha1(f.read()).hexdigest()
+        except IOError:
+            key = case.fn_arch
+        by_arch.setdefault(key, []).append(case)
+    return list(by_arch.values())
+
+
+def group(cases, jobs):
+    """Splits the cases into batches of the same architecture, making sure
+    there are enough batches to keep all jobs busy.
+    """
+    max_size = max(1, (len(cases) + jobs - 1) // jobs)
+    batches = []
+    for arch_cases in group_by_arch(cases):
+        for i in range(0, len(arch_cases), max_size):
+            batches.append(arch_cases[i:i + max_size])
+    # longest batches first so that they do not end up last
+    batches.sort(key=len, reverse=True)
+    return batches
+
+
+def compare(case, fn_out, fn_cmp):
+    """Compares an output with its expected contents, recording the
+    difference in case. Returns True iff they match.
+    """
+    if not os.path.exists(fn_out):
+        case.message += "%s not generated\n" % os.path.basename(fn_out)
+        return False
+    with open(fn_out) as f:
+        out = f.readlines()
+    with open(fn_cmp) as f:
+        cmp = f.readlines()
+    if out == cmp:
+        return True
+    diff = list(difflib.unified_diff(cmp, out, fn_cmp, fn_out))
+    if len(diff) > MAX_DIFF_LINES:
+        diff = diff[:MAX_DIFF_LINES] + ["...\n"]
+    case.message += "".join(diff)
+    return False
+
+
+def run_compiler(args, cases, extra):
+    """Runs one batch of the compiler on cases, returning its output."""
+    cmd = [args.compiler, "--batch", "-j", "1", "--arch", cases[0].fn_arch]
+    cmd += args.compiler_args + extra
+    p = sp.run(cmd, stdout=sp.PIPE, stderr=sp.STDOUT)
+    return p.stdout.decode("utf8", "replace")
+
+
+def run_batch(args, cases):
+    for case in cases:
+        for fn in case.outputs():
+            if os.path.exists(fn):
+                os.unlink(fn)
+
+    t0 = time.monotonic()
+    log = run_compiler(
+        args, cases, ["-i"] + [case.base + ".input" for case in cases])
+    for case in cases:
+        case.ok = compare(case, case.base + ".lut", case.base + ".lut.cmp")
+
+    dump_cases = [case for case in cases if case.ok and case.has_dump]
+    if dump_cases:
+        log += run_compiler(
+            args, dump_cases,
+            ["-c", "-D"] + [case.base + ".lut" for case in dump_cases])
+        for case in dump_cases:
+            case.ok = compare(
+                case, case.base + ".dump", case.base + ".dump.cmp")
+
+    t = time.monotonic() - t0
+    for case in cases:
+        case.time = t
+        case.batch_size = len(cases)
+        if not case.ok:
+            case.message = log + case.message
+    return cases
+
+
+def run_determinism_check(args, check, jobs):
+    """Compiles the inputs of check with 1 and with jobs threads into
+    separate directories, comparing the resulting dumps bytewise.
+
+    Caches are not used, as they would let the second compilation reuse
+    the results of the first.
+    """
+    t0 = time.monotonic()
+    tmp = tempfile.mkdtemp(prefix="riscv-lut-determinism-")
+    try:
+        dumps = []
+        for n in (1, jobs):
+            d = os.path.join(tmp, "j%d" % n)
+            fn_inputs = []
+            for i, case in enumerate(check.cases):
+                fn = os.path.join(d, "%d.input" % i)
+                os.makedirs(d, exist_ok=True)
+                shutil.copyfile(case.base + ".input", fn)
+                fn_inputs.append(fn)
+            cmd = [
+                args.compiler, "--batch", "--deterministic", "-D",
+                "-j", str(n), "--arch", check.cases[0].fn_arch] + fn_inputs
+            p = sp.run(cmd, stdout=sp.PIPE, stderr=sp.STDOUT)
+            check.message += p.stdout.decode("utf8", "replace")
+            res = []
+            for fn in fn_inputs:
+                fn_dump = fn[:-len(".input")] + ".dump"
+                if os.path.exists(fn_dump):
+                    with open(fn_dump, "rb") as f:
+                        res.append(f.read())
+                else:
+                    res.append(None)
+            dumps.append(res)
+
+        check.ok = True
+        for case, single, multi in zip(check.cases, dumps[0], dumps[1]):
+            if single is None or multi is None:
+                check.message += "%s did not compile\n" % case.name
+                check.ok = False
+            elif single != multi:
+                check.message += (
+                    "%s differs between 1 and %d threads\n" % (case.name, jobs))
+                check.ok = False
+    finally:
+        shutil.rmtree(tmp, ignore_errors=True)
+    check.time = time.monotonic() - t0
+    return [check]
+
+
+def report(case):
+    if case.ok:
+        print("\x1b[32;1mPASS\x1b[30;0m %s (%.2f s, batch of %d)" % (
+            case.name, case.time, case.batch_size))
+    else:
+        print("\x1b[31;1mFAIL\x1b[30;0m %s (%.2f s, batch of %d)" % (
+            case.name, case.time, case.batch_size))
+        sys.stdout.write(case.message)
+    sys.stdout.flush()
+
+
+def main():
+    here = os.path.dirname(os.path.abspath(__file__))
+    p = argparse.ArgumentParser(description=__doc__.split("\n")[0])
+    p.add_argument(
+        "patterns", nargs="*",
+        help="only run cases named <directory>/<name> containing any of these")
+    p.add_argument(
+        "--compiler",
+        default=os.path.join(os.path.dirname(here), "riscv-lut-compiler"),
+        help="compiler executable to test (default: %(default)s)")
+    p.add_argument(
+        "-j", "--jobs", type=int, default=0,
+        help="number of batches run concurrently, 0 for one per hardware "
+             "thread (default: %(default)s)")
+    p.add_argument(
+        "-l", "--list", action="store_true",
+        help="list the names of the selected cases instead of running them")
+    p.add_argument(
+        "--cache-dir",
+        help="keep the PLA, target and segmentation caches shared by all "
+             "batches in this directory instead of a temporary one, reusing "
+             "them across runs")
+    p.add_argument(
+        "--no-determinism", action="store_true",
+        help="skip checking that outputs do not depend on the number of "
+             "threads")
+    p.add_argument("--json", help="write the results to this JSON file")
+    args = p.parse_args()
+
+    cases = discover(here, args.patterns)
+    if args.list:
+        for case in cases:
+            print(case.name)
+        return 0
+
+    jobs = args.jobs if args.jobs > 0 else (os.cpu_count() or 1)
+    args.compiler = os.path.abspath(args.compiler)
+    cache_dir = args.cache_dir or tempfile.mkdtemp(prefix="riscv-lut-tests-")
+    args.compiler_args = []
+    for kind in ("pla", "target", "segment"):
+        d = os.path.join(cache_dir, kind)
+        os.makedirs(d, exist_ok=True)
+        args.compiler_args += ["--%s-cache" % kind, d]
+
+    checks = []
+    if not args.no_determinism:
+        checks = [DeterminismCheck(c) for c in group_by_arch(cases)]
+
+    t0 = time.monotonic()
+    try:
+        with concurrent.futures.ThreadPoolExecutor(jobs) as pool:
+            futures = [
+                pool.submit(run_batch, args, batch)
+                for batch in group(cases, jobs)]
+            futures += [
+                pool.submit(run_determinism_check, args, check, max(jobs, 2))
+                for check in checks]
+            for future in concurrent.futures.as_completed(futures):
+                for case in future.result():
+                    report(case)
+    finally:
+        if not args.cache_dir:
+            shutil.rmtree(cache_dir, ignore_errors=True)
+    t = time.monotonic() - t0
+
+    cases += checks
+    n_passed = sum(1 for case in cases if case.ok)
+    print("%d of %d tests passed in %.2f s" % (n_passed, len(cases), t))
+
+    if args.json:
+        with open(args.json, "w") as f:
+            json.dump({
+                "time": t,
+                "cases": [{
+                    "name": case.name,
+                    "passed": case.ok,
+                    "time": case.time,
+                    "batch-size": case.batch_size,
+                    "message": case.message,
+                } for case in cases],
+            }, f, indent=2)
+            f.write("\n")
+    return 0 if n_passed == len(cases) else 1
+
+
+if __name__ == "__main__":
+    sys.exit(main())
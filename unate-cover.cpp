@@ -0,0 +1,276 @@
+#include "unate-cover.h"
+#include <string.h>
+#include <time.h>
+#include <algorithm>
+
+/** Returns a monotonic timestamp in seconds */
+static double _now() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC,&ts);
+  return ts.tv_sec+ts.tv_nsec*1e-9;
+}
+
+static size_t _popcount_and(const uint64_t *a, const uint64_t *b, size_t n) {
+  size_t res=0;
+  for(size_t i=0;i<n;i++) res+=__builtin_popcountll(a[i]&b[i]);
+  return res;
+}
+
+static bool _intersects(
+  const uint64_t *a, const uint64_t *b, const uint64_t *c, size_t n) {
+  for(size_t i=0;i<n;i++) if (a[i]&b[i]&c[i]) return true;
+  return false;
+}
+
+/** Returns true iff (a&m) is a subset of (b&m) */
+static bool _subset(
+  const uint64_t *a, const uint64_t *b, const uint64_t *m, size_t n) {
+  for(size_t i=0;i<n;i++) if (a[i]&m[i]&~b[i]) return false;
+  return true;
+}
+
+UnateCover::UnateCover(size_t n_rows, size_t n_cols) 
+  : _n_rows(n_rows), _n_cols(n_cols), 
+  _wc((n_cols+63)/64), _wr((n_rows+63)/64), 
+  _deadline(0), _nodes(0), _node_limit(0), _timed_out(false) {
+  _rows.setlen(_n_rows*_wc);
+  _cols.setlen(_n_cols*_wr);
+  _active_rows.setlen(_wr);
+  if (_rows.len) memset(_rows.ptr,0,_rows.len*sizeof(uint64_t));
+  if (_cols.len) memset(_cols.ptr,0,_cols.len*sizeof(uint64_t));
+}
+
+bool UnateCover::_expired() {
+  if (_timed_out) return true;
+  if (_node_limit>0) {
+    if (++_nodes>_node_limit) _timed_out=true;
+    return _timed_out;
+  }
+  // reading the clock is comparatively expensive, do so only every once in
+  // a while
+  if (((++_nodes)&0xff)==0 && _now()>_deadline) _timed_out=true;
+  return _timed_out;
+}
+
+bool UnateCover::_reduce(uint64_t *uncovered) {
+  bool changed=true;
+  
+  while(changed) {
+    changed=false;
+    
+    // essential rows
+    for(size_t c=0;c<_n_cols;c++) {
+      if (!(uncovered[c/64]&(1uL<<(c%64)))) continue;
+      size_t n=_popcount_and(_col(c),_active_rows.ptr,_wr);
+      if (n==0) return false;
+      if (n>1) continue;
+      
+      size_t r;
+      for(r=0;r<_n_rows;r++) 
+        if (_col(c)[r/64]&_active_rows[r/64]&(1uL<<(r%64))) break;
+      
+      _fixed.insert(r);
+      _active_rows[r/64]&=~(1uL<<(r%64));
+      for(size_t i=0;i<_wc;i++) uncovered[i]&=~_row(r)[i];
+      changed=true;
+    }
+    
+    // dominated rows: a row covering a subset of the columns of another
+    // row is never needed
+    for(size_t i=0;i<_n_rows;i++) {
+      if (_expired()) return true;
+      if (!(_active_rows[i/64]&(1uL<<(i%64)))) continue;
+      for(size_t j=0;j<_n_rows;j++) {
+        if (j==i || !(_active_rows[j/64]&(1uL<<(j%64)))) continue;
+        if (!_subset(_row(i),_row(j),uncovered,_wc)) continue;
+        if (j>i && _subset(_row(j),_row(i),uncovered,_wc)) continue;
+        _active_rows[i/64]&=~(1uL<<(i%64));
+        changed=true;
+        break;
+      }
+    }
+    
+    // dominating columns: a column covered by all rows covering another
+    // column is covered implicitly
+    for(size_t a=0;a<_n_cols;a++) {
+      if (_expired()) return true;
+      if (!(uncovered[a/64]&(1uL<<(a%64)))) continue;
+      for(size_t b=0;b<_n_cols;b++) {
+        if (b==a || !(uncovered[b/64]&(1uL<<(b%64)))) continue;
+        if (!_subset(_col(b),_col(a),_active_rows.ptr,_wr)) continue;
+        if (b>a && _subset(_col(a),_col(b),_active_rows.ptr,_wr)) continue;
+        uncovered[a/64]&=~(1uL<<(a%64));
+        changed=true;
+        break;
+      }
+    }
+  }
+  return true;
+}
+
+size_t UnateCover::_lower_bound(
+  const uint64_t *uncovered, const uint64_t *avail) {
+  // columns not sharing any row must all be covered by distinct rows
+  uint64_t *used=_work.ptr+(_stack.len*(_wc+_wr)+_wc);
+  size_t res=0;
+  
+  memset(used,0,_wr*sizeof(uint64_t));
+  for(size_t c=0;c<_n_cols;c++) {
+    if (!(uncovered[c/64]&(1uL<<(c%64)))) continue;
+    if (_intersects(_col(c),avail,used,_wr)) continue;
+    for(size_t i=0;i<_wr;i++) used[i]|=_col(c)[i]&avail[i];
+    res++;
+  }
+  return res;
+}
+
+struct _cover_candidate_t {
+  uint32_t row;
+  size_t gain;
+  bool operator<(const _cover_candidate_t &b) const {
+    return gain>b.gain || (gain==b.gain && row<b.row);
+  }
+};
+
+void UnateCover::_branch(const uint64_t *uncovered, const uint64_t *avail) {
+  size_t depth=_stack.len;
+  size_t c_min=_n_cols, n_min=_n_rows+1;
+  
+  if (_expired()) return;
+  
+  for(size_t c=0;c<_n_cols;c++) {
+    if (!(uncovered[c/64]&(1uL<<(c%64)))) continue;
+    size_t n=_popcount_and(_col(c),avail,_wr);
+    if (n==0) return;
+    if (n<n_min) { n_min=n; c_min=c; }
+  }
+  
+  if (c_min==_n_cols) {
+    // all columns covered
+    if (_fixed.len+depth<_best.len) {
+      _best.setlen(0);
+      _best.insert(_fixed.ptr,_fixed.len);
+      _best.insert(_stack.ptr,_stack.len);
+    }
+    return;
+  }
+  
+  if (_fixed.len+depth+_lower_bound(uncovered,avail)>=_best.len) return;
+  
+  alp::array_t<_cover_candidate_t> cand;
+  for(size_t r=0;r<_n_rows;r++) {
+    if (!(_col(c_min)[r/64]&avail[r/64]&(1uL<<(r%64)))) continue;
+    _cover_candidate_t e;
+    e.row=r;
+    e.gain=_popcount_and(_row(r),uncovered,_wc);
+    cand.insert(e);
+  }
+  std::sort(cand.ptr,cand.ptr+cand.len);
+  
+  uint64_t *next_uncovered=_work.ptr+(depth+1)*(_wc+_wr);
+  // rows already tried on this level need not be considered on the levels
+  // below, since all covers containing them have been searched already
+  alp::array_t<uint64_t> next_avail;
+  next_avail.insert((uint64_t*)avail,_wr);
+  
+  for(size_t k=0;k<cand.len;k++) {
+    uint32_t r=cand[k].row;
+    for(size_t i=0;i<_wc;i++) next_uncovered[i]=uncovered[i]&~_row(r)[i];
+    next_avail[r/64]&=~(1uL<<(r%64));
+    
+    _stack.insert(r);
+    _branch(next_uncovered,next_avail.ptr);
+    _stack.setlen(depth);
+    
+    if (_timed_out || _fixed.len+depth+1>=_best.len) break;
+  }
+}
+
+bool UnateCover::solve(
+  alp::array_t<uint32_t> &res, size_t bound, double time_limit,
+  size_t node_limit) {
+  
+  _deadline=_now()+time_limit;
+  _nodes=0;
+  _node_limit=node_limit;
+  _timed_out=false;
+  _fixed.setlen(0);
+  _stack.setlen(0);
+  _best.setlen(0);
+  
+  // level i of the search uses uncovered columns at offset i*(_wc+_wr),
+  // followed by scratch space for the bound
+  _work.setlen((std::min(bound,_n_rows)+2)*(_wc+_wr));
+  memset(_work.ptr,0,_work.len*sizeof(uint64_t));
+  
+  uint64_t *uncovered=_work.ptr;
+  for(size_t c=0;c<_n_cols;c++) uncovered[c/64]|=1uL<<(c%64);
+  for(size_t r=0;r<_n_rows;r++) _active_rows[r/64]|=1uL<<(r%64);
+  
+  if (!_reduce(uncovered) || _fixed.len>=bound) return false;
+  
+  // any set of bound rows acts as the initial upper bound
+  _best.setlen(bound);
+  _branch(uncovered,_active_rows.ptr);
+  
+  if (_best.len>=bound) return false;
+  res.setlen(0);
+  res.insert(_best.ptr,_best.len);
+  return true;
+}
+
+unittest(
+  // columns 0..5; rows {0,1,2}, {2,3}, {3,4,5}, {0,3}, {1,4}, {5}
+  // minimum cover is {0,1,2} + {3,4,5}
+  UnateCover uc(6,6);
+  uc.set(0,0); uc.set(0,1); uc.set(0,2);
+  uc.set(1,2); uc.set(1,3);
+  uc.set(2,3); uc.set(2,4); uc.set(2,5);
+  uc.set(3,0); uc.set(3,3);
+  uc.set(4,1); uc.set(4,4);
+  uc.set(5,5);
+  
+  alp::array_t<uint32_t> res;
+  Assertf(uc.solve(res,4,10), "expected to find a cover");
+  Assertf(res.len==2, "expected a cover of 2 rows, got %zu", res.len);
+  Assertf(!uc.timedOut(), "expected the search to complete");
+  Assertf(!uc.solve(res,2,10), "expected no cover with less than 2 rows");
+  Assertf(uc.solve(res,4,0,1000), "expected to find a cover in 1000 steps");
+  Assertf(res.len==2, "expected a cover of 2 rows, got %zu", res.len);
+  Assertf(!uc.timedOut(), "expected the search to complete");
+  uc.solve(res,4,0,1);
+  Assertf(uc.timedOut(), "expected the search to hit its node limit");
+  
+  // exhaustive check against all subsets of random matrices
+  uint32_t seed=1;
+  for(int k=0;k<200;k++) {
+    seed=seed*1103515245+12345;
+    size_t n_rows=1+(seed>>16)%10, n_cols=1+(seed>>8)%12;
+    UnateCover uc2(n_rows,n_cols);
+    alp::array_t<uint32_t> sets;
+    for(size_t r=0;r<n_rows;r++) {
+      seed=seed*1103515245+12345;
+      uint32_t s=(seed>>4)&((1u<<n_cols)-1);
+      sets.insert(s);
+      for(size_t c=0;c<n_cols;c++) if (s&(1u<<c)) uc2.set(r,c);
+    }
+    
+    size_t best=n_rows+1;
+    for(uint32_t sel=0;sel<(1u<<n_rows);sel++) {
+      uint32_t cov=0;
+      for(size_t r=0;r<n_rows;r++) if (sel&(1u<<r)) cov|=sets[r];
+      if (cov==(1u<<n_cols)-1) 
+        best=std::min(best,(size_t)__builtin_popcount(sel));
+    }
+    
+    bool found=uc2.solve(res,n_rows+1,10);
+    Assertf(found==(best<=n_rows), "cover existence mismatch");
+    if (!found) continue;
+    Assertf(res.len==best, "expected cover of %zu rows, got %zu", 
+      best, res.len);
+    
+    uint32_t cov=0;
+    for(size_t i=0;i<res.len;i++) cov|=sets[res[i]];
+    Assertf(cov==(1u<<n_cols)-1, "result is not a cover");
+  }
+);
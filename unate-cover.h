@@ -0,0 +1,102 @@
+/** \file unate-cover.h
+  * \brief Exact solver for the unate covering problem, used for selecting
+  * a minimum set of prime implicants for the PLA.
+  */
+#ifndef RISCV_LUT_COMPULER_UNATE_COVER_H
+#define RISCV_LUT_COMPULER_UNATE_COVER_H
+
+#include <alpha/alpha.h>
+#include <stdint.h>
+
+/** Branch-and-bound solver for the unate covering problem.
+  *
+  * The problem is given as a binary matrix of rows (candidates, e.g. prime
+  * implicants) and columns (elements to be covered, e.g. minterms). A cover 
+  * is a set of rows such that every column has a 1 in at least one of them.
+  * The solver looks for a cover with the least number of rows.
+  *
+  * Both rows and columns are stored as packed bit sets. Before branching, 
+  * the matrix is reduced by repeatedly selecting essential rows and removing
+  * dominated rows and columns. Branching always happens on the column with 
+  * the fewest remaining rows and is bounded by a maximal independent set of
+  * uncovered columns.
+  *
+  * Since the problem is NP-hard, the search is aborted once a deadline or
+  * a number of search steps is hit, in which case the best cover found so
+  * far is reported.
+  */
+class UnateCover {
+  protected:
+    size_t _n_rows;
+    size_t _n_cols;
+    /** Words per row bit set (one bit per column) */
+    size_t _wc;
+    /** Words per column bit set (one bit per row) */
+    size_t _wr;
+
+    alp::array_t<uint64_t> _rows;
+    alp::array_t<uint64_t> _cols;
+    
+    /** Rows still available after reduction */
+    alp::array_t<uint64_t> _active_rows;
+    /** Rows selected for the cover by reduction */
+    alp::array_t<uint32_t> _fixed;
+    
+    /** Rows of the current branch */
+    alp::array_t<uint32_t> _stack;
+    /** Best cover found, including _fixed */
+    alp::array_t<uint32_t> _best;
+    /** Per-level scratch space of the search */
+    alp::array_t<uint64_t> _work;
+    
+    double _deadline;
+    size_t _nodes;
+    size_t _node_limit;
+    bool _timed_out;
+
+    uint64_t *_row(size_t i) { return _rows.ptr+i*_wc; }
+    uint64_t *_col(size_t j) { return _cols.ptr+j*_wr; }
+
+    bool _expired();
+    bool _reduce(uint64_t *uncovered);
+    size_t _lower_bound(const uint64_t *uncovered, const uint64_t *avail);
+    void _branch(const uint64_t *uncovered, const uint64_t *avail);
+
+  public:
+    /** Constructor. Creates an empty matrix.
+      */
+    UnateCover(size_t n_rows, size_t n_cols);
+    
+    size_t n_rows() const { return _n_rows; }
+    size_t n_cols() const { return _n_cols; }
+
+    /** Marks column col as being covered by row row. */
+    void set(size_t row, size_t col) {
+      _rows[row*_wc+col/64]|=1uL<<(col%64);
+      _cols[col*_wr+row/64]|=1uL<<(row%64);
+    }
+
+    /** Searches for a cover of less than bound rows.
+      *
+      * \param res Receives the indices of the rows of the smallest cover 
+      * found.
+      * \param bound Number of rows of a known cover. Only strictly smaller
+      * covers are searched for.
+      * \param time_limit Time, in seconds, after which the search is aborted.
+      * Ignored if node_limit is given.
+      * \param node_limit Number of search steps after which the search is 
+      * aborted, 0 to limit its time instead. Unlike a time limit, this makes
+      * the result independent of the speed and load of the machine.
+      * \return true iff a cover smaller than bound was found.
+      */
+    bool solve(
+      alp::array_t<uint32_t> &res, size_t bound, double time_limit, 
+      size_t node_limit=0);
+
+    /** Returns true iff the last call to solve was aborted due to its time
+      * or node limit, i.e. the result is not proven minimal.
+      */
+    bool timedOut() const { return _timed_out; }
+};
+
+#endif
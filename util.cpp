@@ -1,4 +1,5 @@
 #include <util.h>
+#include <stdio.h>
 #if defined(__linux)
 
 #include <stdlib.h>
@@ -49,3 +50,16 @@ TempDir::~TempDir() {
 #error "TempDir not implemented for this OS"
 #endif
 
+bool hash_file(const char *fn, uint64_t &h) {
+  FILE *f=fopen(fn,"rb");
+  char buf[65536];
+  size_t n;
+
+  if (!f) return false;
+  h=hash_fnv1a(NULL,0);
+  while((n=fread(buf,1,sizeof(buf),f))>0) h=hash_fnv1a(buf,n,h);
+  bool ok=!ferror(f);
+  fclose(f);
+  return ok;
+}
+
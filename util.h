@@ -6,6 +6,7 @@
 #include <streambuf>
 #include <string>
 #include <alpha/alpha.h>
+#include <stdint.h>
 /** Helper struct for mapping char buffers onto c++ streams as expected by
   * flex-generated scanners.
   */
@@ -31,4 +32,20 @@ class TempDir {
     const alp::string &path() { return _path; }
 };
 
+/** Computes the FNV-1a hash of n bytes, continuing the hash h. */
+inline uint64_t hash_fnv1a(
+  const void *p, size_t n, uint64_t h=0xcbf29ce484222325uL) {
+  for(size_t i=0;i<n;i++) {
+    h^=((const uint8_t*)p)[i];
+    h*=0x100000001b3uL;
+  }
+  return h;
+}
+
+/** Computes the FNV-1a hash of the content of file fn.
+  *
+  * \return false if the file could not be read.
+  */
+bool hash_file(const char *fn, uint64_t &h);
+
 #endif
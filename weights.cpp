@@ -1,5 +1,6 @@
 #include "weights.h"
 #include "util.h"
+#include "stats.h"
 
 #undef yyFlexLexer
 #define yyFlexLexer BaseWeightsFlexLexer
@@ -233,6 +234,7 @@ seg_data_t WeightsTable::evaluate(const seg_data_t &p) {
 void WeightsTable::evaluate(const seg_data_t &p, seg_data_t &v) {
   ssize_t l,r,c;
   lua_Number lv;
+  Stats::Count(Stats::WeightEvaluations);
   for(l=0,r=(ssize_t)_ranges.len-1;l<=r;) {
     c=(l+r)/2;
     if (_ranges[c].contains(p)) {